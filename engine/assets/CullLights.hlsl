@@ -0,0 +1,81 @@
+// Bins the map lights into screen tiles for DrawMap.hlsl with MAP_LIGHTS. One thread group per
+// tile tests the light circles against the tile's rectangle on the map; cone lights are culled by
+// their circle too. A tile keeps the MAX_LIGHTS_PER_TILE lights of lowest index that reach it, the same
+// ones every frame.
+
+#include "Structures.fxh"
+
+cbuffer cbMapConstants
+{
+    MapConstants g_MapConstants;
+};
+
+cbuffer cbLightCulling
+{
+    LightCullingConstants g_LightCulling;
+};
+
+StructuredBuffer<MapLight> g_Lights;
+RWStructuredBuffer<uint>   g_TileLights;
+
+static const uint ThreadGroupSize = 64;
+
+groupshared uint s_NumTileLights;
+groupshared uint s_Hits[ThreadGroupSize]; // whether each thread's light of the current batch reaches the tile
+
+// Inverse of the map rect drawn by DrawMap.hlsl VSmain
+float2 ScreenToMap(float2 ScreenPos)
+{
+    const float2 NDC = ScreenPos / float2(g_LightCulling.ScreenSize) * float2(2.0, -2.0) + float2(-1.0, 1.0);
+    const float2 UV  = (NDC - float2(g_MapConstants.ScreenRectLR.x, g_MapConstants.ScreenRectTB.x)) /
+                       float2(g_MapConstants.ScreenRectLR.y - g_MapConstants.ScreenRectLR.x,
+                              g_MapConstants.ScreenRectTB.y - g_MapConstants.ScreenRectTB.x);
+    return g_MapConstants.MapOrigin + UV * g_MapConstants.UVToMap;
+}
+
+[numthreads(ThreadGroupSize, 1, 1)]
+void main(uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    if (GroupIndex == 0)
+        s_NumTileLights = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    const uint   Tile   = GroupID.y * g_LightCulling.NumTiles.x + GroupID.x;
+    const uint   Offset = Tile * (MAX_LIGHTS_PER_TILE + 1);
+    const float2 Corner0 = ScreenToMap(float2(GroupID.xy * LIGHT_TILE_SIZE));
+    const float2 Corner1 = ScreenToMap(float2((GroupID.xy + 1) * LIGHT_TILE_SIZE));
+    const float2 TileMin = min(Corner0, Corner1);
+    const float2 TileMax = max(Corner0, Corner1);
+
+    // Batches of ThreadGroupSize lights, each compacted in index order after the hits of the previous ones.
+    // s_NumTileLights only changes between barriers, so the loop condition is the same for the whole group.
+    for (uint Base = 0; Base < g_LightCulling.NumLights && s_NumTileLights < MAX_LIGHTS_PER_TILE;
+         Base += ThreadGroupSize)
+    {
+        const uint i   = Base + GroupIndex;
+        bool       Hit = false;
+        if (i < g_LightCulling.NumLights)
+        {
+            const MapLight Light   = g_Lights[i];
+            const float2   Closest = clamp(Light.Pos, TileMin, TileMax);
+            Hit = distance(Closest, Light.Pos) < Light.Radius;
+        }
+        s_Hits[GroupIndex] = Hit ? 1 : 0;
+        GroupMemoryBarrierWithGroupSync();
+
+        // hits of the lower threads of the batch
+        uint Slot = s_NumTileLights;
+        for (uint j = 0; j < GroupIndex; ++j)
+            Slot += s_Hits[j];
+        if (Hit && Slot < MAX_LIGHTS_PER_TILE)
+            g_TileLights[Offset + 1 + Slot] = i;
+        GroupMemoryBarrierWithGroupSync();
+
+        if (GroupIndex == ThreadGroupSize - 1)
+            s_NumTileLights = Slot + s_Hits[GroupIndex];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (GroupIndex == 0)
+        g_TileLights[Offset] = min(s_NumTileLights, MAX_LIGHTS_PER_TILE);
+}
@@ -25,13 +25,49 @@ void VSmain(in uint vid : SV_VertexID,
 #endif
 
 
-#ifdef PIXEL_SHADER
+#ifndef LIGHTING_DOWNSCALE
+#   define LIGHTING_DOWNSCALE 1 // 2 or 4 upsamples the shading of PSLighting instead of tracing every pixel
+#endif
+
+#ifndef SHADOW_METHOD
+#   define SHADOW_METHOD 0 // 0 - three rays per pixel, 1 - one ray with the penumbra estimated from the SDF
+#endif
+
+#ifndef MAP_LIGHTS
+#   define MAP_LIGHTS 0 // 1 adds the lights binned into screen tiles by CullLights.hlsl
+#endif
+
+#ifndef SDF_WORLD
+#   define SDF_WORLD 0 // 1 reads the chunked SDF of SDFWorld instead of g_SDFMap
+#endif
+
+#ifndef TEMPORAL_LIGHTING
+#   define TEMPORAL_LIGHTING 0 // 1 reads the lighting from a history that CSTemporalLighting refreshes in quarters
+#endif
+
+// CSTemporalLighting shares everything but the vertex shader
+#if defined(PIXEL_SHADER) || defined(COMPUTE_SHADER)
 cbuffer cbPlayerConstants
 {
     PlayerConstants g_PlayerConstants;
 };
-Texture2D<float4> g_SDFMap; // R16
+#if SDF_WORLD
+cbuffer cbSDFWorld
+{
+    SDFWorldConstants g_SDFWorld;
+};
+Texture2D<float> g_SDFAtlas;       // R16, fine chunks with a border texel on each side
+SamplerState     g_SDFAtlas_sampler;
+Texture2D<float> g_SDFCoarse;      // R16, coarse chunks of the window, wraps around
+SamplerState     g_SDFCoarse_sampler;
+Texture2D<uint>  g_SDFIndirection; // per window chunk: atlas slot | CoarseValidBit
+
+static const uint NoChunkSlot    = 0x7FFF;
+static const uint CoarseValidBit = 0x8000;
+#else
+Texture2D<float4> g_SDFMap; // R16F, or R8_UNORM with SDFEncoding::Unorm8
 SamplerState      g_SDFMap_sampler;
+#endif
 
 static const float3 WallColor         = float3(0.0, 0.0, 1.0);
 static const float3 PlayerColor       = float3(0.0, 2.0, 0.0);
@@ -40,6 +76,7 @@ static const float3 FlashLightColor   = float3(1.0, 1.0, 1.0) * 0.6;
 static const float3 AmbientLight      = float(0.001).xxx;
 static const float3 TeleportColor     = float3(0.4, 0.0, 0.0);
 static const float3 TeleportWaveColor = float3(0.5, 0.2, 0.0);
+static const float  ShadowSoftness    = 0.125; // half width of the penumbra at the lit pixel, in map pixels
 
 float3 Blend(float3 src, float3 dst, float factor)
 {
@@ -53,15 +90,51 @@ float BumpStep(float x, float edge0, float edge1)
     return 1.0 - abs(x - 0.5) * 2.0;
 }
 
+#if SDF_WORLD
+// fine chunk if resident, else coarse chunk, else empty space
+float SampleSDF(float2 pos)
+{
+    const float2 Texel = pos * g_SDFWorld.InvDistScale;
+    const int2   Chunk = int2(floor(Texel / g_SDFWorld.ChunkTexels));
+    if (any(Chunk < g_SDFWorld.Window.xy) || any(Chunk >= g_SDFWorld.Window.zw))
+        return g_SDFWorld.FarDistance;
+
+    const int2 Cell  = ((Chunk % g_SDFWorld.WindowChunks) + g_SDFWorld.WindowChunks) % g_SDFWorld.WindowChunks;
+    const uint Entry = g_SDFIndirection.Load(int3(Cell, 0));
+    const uint Slot  = Entry & NoChunkSlot;
+    if (Slot != NoChunkSlot)
+    {
+        const uint2  SlotPos  = uint2(Slot % g_SDFWorld.AtlasSlotsPerRow, Slot / g_SDFWorld.AtlasSlotsPerRow);
+        const float2 AtlasPos = float2(SlotPos) * (g_SDFWorld.ChunkTexels + 2.0) + 1.0 +
+                                (Texel - float2(Chunk) * g_SDFWorld.ChunkTexels);
+        return g_SDFAtlas.SampleLevel(g_SDFAtlas_sampler, AtlasPos * g_SDFWorld.AtlasTexelSize, 0);
+    }
+    if ((Entry & CoarseValidBit) != 0)
+        return g_SDFCoarse.SampleLevel(g_SDFCoarse_sampler, pos * g_SDFWorld.InvCoarseExtent, 0);
+    return g_SDFWorld.FarDistance;
+}
+#else
+// filtering is linear, so decoding the filtered value is the same as filtering decoded ones
+float SampleSDF(float2 pos)
+{
+    const float Value = g_SDFMap.SampleLevel(g_SDFMap_sampler, pos * g_MapConstants.MapToUV, 0).r;
+    return Value * g_MapConstants.SDFDecodeScale + g_MapConstants.SDFDecodeBias;
+}
+#endif
+
 // returns distance (sphere radius) in pixels
 float ReadSDF(float2 pos)
 {
     float SDFScale = 0.75; // calculated SDF may be a little bit inaccurate
-    return g_SDFMap.SampleLevel(g_SDFMap_sampler, pos * g_MapConstants.MapToUV, 0).r * SDFScale;
+    return SampleSDF(pos) * SDFScale;
 }
 
-// returns 1 if light is visible
-float TraceRay(float2 LightPos, float2 Origin, bool InsideWall)
+// returns 1 if light is visible, 0 if it is not.
+// With ConeRadius > 0 the ray stands for a cone of rays starting within ConeRadius of Origin and meeting at
+// the point light, and the result is the smallest ratio of the free distance to the cone radius along the
+// ray: a penumbra value from a single ray. Only SHADOW_METHOD 1 tracks the cone, the three ray method
+// keeps the plain march.
+float TraceRay(float2 LightPos, float2 Origin, bool InsideWall, float ConeRadius)
 {
     const float  TMax    = max(distance(LightPos, Origin) - 0.001, 0.001); // distance from current pixel to light source.
     const float  MinDist = 0.00625;                      // some minimal value.
@@ -69,6 +142,7 @@ float TraceRay(float2 LightPos, float2 Origin, bool InsideWall)
     const float2 Dir     = normalize(LightPos - Origin); // ray marching direction.
     float2       Pos     = Origin;                       // ray marching start position.
     float        t       = 0.0;                          // ray length
+    float        Visible = 1.0;                          // fraction of the cone free of walls
     int          i       = 0;
 
     // trace ray inside wall to highlight nearest walls
@@ -100,6 +174,11 @@ float TraceRay(float2 LightPos, float2 Origin, bool InsideWall)
         // stop ray marching on negative or too small distance
         if (d < MinDist)
             break;
+
+#if SHADOW_METHOD == 1
+        // MinDist keeps the ratio finite where the cone closes at the light
+        Visible = min(Visible, d / max(ConeRadius * (1.0 - t / TMax), MinDist));
+#endif
         
         // me can increase ray length to the sphere radius
         t += d;
@@ -110,28 +189,14 @@ float TraceRay(float2 LightPos, float2 Origin, bool InsideWall)
             break;
     }
 
-    return t > TMax ? 1.0 : 0.0;
+    return t > TMax ? saturate(Visible) : 0.0;
 }
 
-float4 PSmain(in PSInput PSIn) : SV_TARGET
+// returns color of the flash light and the ambient light around the player, TraceLight is false where both are off
+float3 ComputeLightColor(float2 PosOnMap, float DistToPlayer, float2 DirToPlayer, out bool TraceLight)
 {
-    const float2 PosOnMap       = PSIn.UV * g_MapConstants.UVToMap; // position on map in pixels
-    const float  DistToPlayer   = distance(PosOnMap, g_PlayerConstants.PlayerPos);
-    const float2 DirToPlayer    = normalize(g_PlayerConstants.PlayerPos - PosOnMap);
-    const float  DistToTeleport = distance(g_MapConstants.TeleportPos, PosOnMap);
-    float4       Color          = float4(0.2, 0.2, 0.2, 1.0);
-    float3       LightColor     = float3(0.0, 0.0, 0.0);
-    bool         TraceLight     = false;
-    const bool   InsideWall     = ReadSDF(PosOnMap) < 0.0;
-    
-    // draw walls
-    Color.rgb = Blend(Color.rgb, WallColor, (InsideWall ? 1.0 : 0.0));
-
-    // draw teleport
-    {
-        float Factor = saturate(1.0 - DistToTeleport / g_MapConstants.TeleportRadius);
-        Color.rgb    = Blend(Color.rgb, TeleportColor, Factor);
-    }
+    float3 LightColor = float3(0.0, 0.0, 0.0);
+    TraceLight = false;
 
     // calculate flash light color
     if (g_PlayerConstants.FlashLightPower > 0.0 &&
@@ -160,24 +225,258 @@ float4 PSmain(in PSInput PSIn) : SV_TARGET
         LightColor   = Blend(LightColor, AmbientLightColor, Factor);
         TraceLight   = TraceLight || Factor > 0.0;
     }
+    return LightColor;
+}
 
-    // ray marching from current pixel to player (light source) position
+// ray marching from current pixel to light source position
+// 0 - totally shaded, 1 - totally illuminated, other - penumbra
+float ComputeShading(float2 LightPos, float2 PosOnMap, bool InsideWall)
+{
+#if SHADOW_METHOD == 1
+    return TraceRay(LightPos, PosOnMap, InsideWall, ShadowSoftness);
+#else
+    float Shading = TraceRay(LightPos, PosOnMap, InsideWall, 0.0) * 0.5;
+
+    // for soft shadows
+    float2 DirToLight = normalize(LightPos - PosOnMap);
+    float2 Norm       = float2(-DirToLight.y, DirToLight.x); // left normal to the line
+    Shading += TraceRay(LightPos, PosOnMap + Norm * ShadowSoftness, InsideWall, 0.0) * 0.25;
+    Shading += TraceRay(LightPos, PosOnMap - Norm * ShadowSoftness, InsideWall, 0.0) * 0.25;
+    return Shading;
+#endif
+}
+
+// Lighting pass of reduced resolution lighting, rendered into an RG16F target with the same screen rect.
+// r - shading, g - SDF at the pixel, which guides the upsampling in PSmain.
+float2 PSLighting(in PSInput PSIn) : SV_TARGET
+{
+    const float2 PosOnMap    = g_MapConstants.MapOrigin + PSIn.UV * g_MapConstants.UVToMap;
+    const float  SDF         = ReadSDF(PosOnMap);
+    const float2 DirToPlayer = normalize(g_PlayerConstants.PlayerPos - PosOnMap);
+    bool         TraceLight;
+    ComputeLightColor(PosOnMap, distance(PosOnMap, g_PlayerConstants.PlayerPos), DirToPlayer, TraceLight);
+
+    // the ternary operator would evaluate both branches
+    float Shading = 0.0;
     if (TraceLight)
+        Shading = ComputeShading(g_PlayerConstants.PlayerPos, PosOnMap, SDF < 0.0);
+
+    return float2(Shading, SDF);
+}
+
+#if LIGHTING_DOWNSCALE > 1
+cbuffer cbLightingConstants
+{
+    LightingConstants g_LightingConstants;
+};
+Texture2D<float2> g_ShadingTex; // written by PSLighting
+
+// Joint bilateral upsampling: bilinear weights of the 4 nearest lighting pixels, scaled down by how much
+// their SDF differs from the one of this pixel. Shadow edges follow the walls, so pixels across a wall
+// border or at a very different distance from the walls do not bleed into each other.
+float UpsampleShading(float2 ScreenPos, float2 PosOnMap, float SDF, bool InsideWall)
+{
+    int2 Dim;
+    g_ShadingTex.GetDimensions(Dim.x, Dim.y);
+
+    const float2 LowResPos = ScreenPos * g_LightingConstants.FullToLowRes - 0.5;
+    const int2   Base      = int2(floor(LowResPos));
+    const float2 Frac      = LowResPos - float2(Base);
+
+    float Shading   = 0.0;
+    float WeightSum = 0.0;
+    [unroll] for (int i = 0; i < 4; ++i)
     {
-        // 0 - totally shaded, 1 - totally illuminated, other - penumbra
-        float Shading = TraceRay(g_PlayerConstants.PlayerPos, PosOnMap, InsideWall) * 0.5;
+        const int2   Offset   = int2(i & 1, i >> 1);
+        const float2 Sample   = g_ShadingTex.Load(int3(clamp(Base + Offset, int2(0, 0), Dim - 1), 0));
+        const float2 Bilinear = lerp(1.0 - Frac, Frac, float2(Offset));
 
-        // for soft shadows
-        float2 Norm = float2(-DirToPlayer.y, DirToPlayer.x); // left normal to the line
-        Shading += TraceRay(g_PlayerConstants.PlayerPos, PosOnMap + Norm * 0.125, InsideWall) * 0.25;
-        Shading += TraceRay(g_PlayerConstants.PlayerPos, PosOnMap - Norm * 0.125, InsideWall) * 0.25;
+        float Weight = Bilinear.x * Bilinear.y * exp(-abs(Sample.y - SDF) * g_LightingConstants.BilateralSharpness);
+        Weight      *= ((Sample.y < 0.0) == InsideWall) ? 1.0 : 0.0;
 
-        Color.rgb = (Color.rgb * LightColor * Shading) + (Color.rgb * AmbientLight);
+        Shading   += Sample.x * Weight;
+        WeightSum += Weight;
     }
-    else
+
+    // features thinner than a lighting pixel have no matching samples, trace them at full resolution
+    if (WeightSum < 1.0e-3)
+        return ComputeShading(g_PlayerConstants.PlayerPos, PosOnMap, InsideWall);
+
+    return Shading / WeightSum;
+}
+#endif
+
+#if MAP_LIGHTS
+cbuffer cbLightCulling
+{
+    LightCullingConstants g_LightCulling;
+};
+StructuredBuffer<MapLight> g_Lights;
+StructuredBuffer<uint>     g_TileLights; // written by CullLights.hlsl
+
+static const float ConeEdgeWidth = 0.05; // in cosine of the angle to the cone axis
+
+// returns the light of the map lights binned into the tile of this pixel
+float3 ComputeMapLights(float2 ScreenPos, float2 PosOnMap, bool InsideWall)
+{
+    const uint2 Tile      = min(uint2(ScreenPos) / LIGHT_TILE_SIZE, g_LightCulling.NumTiles - 1);
+    const uint  Offset    = (Tile.y * g_LightCulling.NumTiles.x + Tile.x) * (MAX_LIGHTS_PER_TILE + 1);
+    const uint  NumLights = g_TileLights[Offset];
+
+    float3 Light = float3(0.0, 0.0, 0.0);
+    [loop] for (uint i = 0; i < NumLights; ++i)
     {
-        Color.rgb *= AmbientLight;
+        const MapLight L    = g_Lights[g_TileLights[Offset + 1 + i]];
+        const float    Dist = distance(PosOnMap, L.Pos);
+
+        float Factor = saturate(1.0 - Dist / L.Radius);
+        Factor *= Factor;
+        if (L.CosHalfAngle > -1.0)
+        {
+            const float CosToAxis = dot((PosOnMap - L.Pos) / max(Dist, 0.001), L.Dir);
+            Factor *= smoothstep(L.CosHalfAngle, min(L.CosHalfAngle + ConeEdgeWidth, 1.0), CosToAxis);
+        }
+
+        if (Factor > 0.0)
+            Light += L.Color * Factor * ComputeShading(L.Pos, PosOnMap, InsideWall);
     }
+    return Light;
+}
+#endif
+
+#if TEMPORAL_LIGHTING
+cbuffer cbTemporalLighting
+{
+    TemporalLightingConstants g_TemporalLighting;
+};
+
+#ifdef COMPUTE_SHADER
+RWTexture2D<float4 /* format=rgba16f */> g_HistoryOut;
+
+// Inverse of the map rect drawn by VSmain, as in CullLights.hlsl
+float2 ScreenToMap(float2 ScreenPos)
+{
+    const float2 NDC = ScreenPos / float2(g_TemporalLighting.ScreenSize) * float2(2.0, -2.0) + float2(-1.0, 1.0);
+    const float2 UV  = (NDC - float2(g_MapConstants.ScreenRectLR.x, g_MapConstants.ScreenRectTB.x)) /
+                       float2(g_MapConstants.ScreenRectLR.y - g_MapConstants.ScreenRectLR.x,
+                              g_MapConstants.ScreenRectTB.y - g_MapConstants.ScreenRectTB.x);
+    return g_MapConstants.MapOrigin + UV * g_MapConstants.UVToMap;
+}
+
+// Traces the pixel at g_TemporalLighting.Phase of every 2x2 block into the history: rgb - light of the map
+// lights, a - shading of the player's lights. A thread per block rather than a pixel shader discarding three
+// pixels of four, which would keep the quads and waves of the skipped pixels busy.
+[numthreads(8, 8, 1)]
+void CSTemporalLighting(uint3 ThreadID : SV_DispatchThreadID)
+{
+    const uint2 Pixel = ThreadID.xy * 2 + g_TemporalLighting.Phase;
+    if (any(Pixel >= g_TemporalLighting.ScreenSize))
+        return;
+
+    const float2 ScreenPos   = float2(Pixel) + 0.5;
+    const float2 PosOnMap    = ScreenToMap(ScreenPos);
+    const bool   InsideWall  = ReadSDF(PosOnMap) < 0.0;
+    const float2 DirToPlayer = normalize(g_PlayerConstants.PlayerPos - PosOnMap);
+    bool         TraceLight;
+    ComputeLightColor(PosOnMap, distance(PosOnMap, g_PlayerConstants.PlayerPos), DirToPlayer, TraceLight);
+
+    float Shading = 0.0;
+    if (TraceLight)
+        Shading = ComputeShading(g_PlayerConstants.PlayerPos, PosOnMap, InsideWall);
+
+    float3 Light = float3(0.0, 0.0, 0.0);
+#if MAP_LIGHTS
+    Light = ComputeMapLights(ScreenPos, PosOnMap, InsideWall);
+#endif
+    g_HistoryOut[Pixel] = float4(Light, Shading);
+}
+#else
+Texture2D<float4> g_History; // written by CSTemporalLighting, alpha below 0 where not traced since it was cleared
+
+// Returns false where neither the pixel nor the rest of its 2x2 block has been traced since the history
+// was cleared. Right after that only some pixels of each block are, the others take their average until
+// their turn comes.
+bool ReadHistory(uint2 Pixel, out float4 History)
+{
+    History = g_History.Load(int3(Pixel, 0));
+    if (History.a >= 0.0)
+        return true;
+
+    uint2 Dim;
+    g_History.GetDimensions(Dim.x, Dim.y);
+
+    float4 Sum   = float4(0.0, 0.0, 0.0, 0.0);
+    float  Count = 0.0;
+    [unroll] for (uint i = 0; i < 4; ++i)
+    {
+        const uint2  Neighbor = min((Pixel & ~1u) + uint2(i & 1, i >> 1), Dim - 1);
+        const float4 Sample   = g_History.Load(int3(Neighbor, 0));
+        if (Sample.a >= 0.0)
+        {
+            Sum   += Sample;
+            Count += 1.0;
+        }
+    }
+    History = Sum / max(Count, 1.0);
+    return Count > 0.0;
+}
+#endif
+#endif
+
+#ifdef PIXEL_SHADER
+float4 PSmain(in PSInput PSIn) : SV_TARGET
+{
+    const float2 PosOnMap       = g_MapConstants.MapOrigin + PSIn.UV * g_MapConstants.UVToMap; // position on map in pixels
+    const float  DistToPlayer   = distance(PosOnMap, g_PlayerConstants.PlayerPos);
+    const float2 DirToPlayer    = normalize(g_PlayerConstants.PlayerPos - PosOnMap);
+    const float  DistToTeleport = distance(g_MapConstants.TeleportPos, PosOnMap);
+    float4       Color          = float4(0.2, 0.2, 0.2, 1.0);
+    bool         TraceLight     = false;
+    const float  SDF            = ReadSDF(PosOnMap);
+    const bool   InsideWall     = SDF < 0.0;
+    
+    // draw walls
+    Color.rgb = Blend(Color.rgb, WallColor, (InsideWall ? 1.0 : 0.0));
+
+    // draw teleport
+    {
+        float Factor = saturate(1.0 - DistToTeleport / g_MapConstants.TeleportRadius);
+        Color.rgb    = Blend(Color.rgb, TeleportColor, Factor);
+    }
+
+    const float3 LightColor = ComputeLightColor(PosOnMap, DistToPlayer, DirToPlayer, TraceLight);
+    float3       Light      = AmbientLight;
+
+#if TEMPORAL_LIGHTING
+    float4     History;
+    const bool HasHistory = ReadHistory(uint2(PSIn.Pos.xy), History);
+#endif
+
+    if (TraceLight)
+    {
+#if LIGHTING_DOWNSCALE > 1
+        float Shading = UpsampleShading(PSIn.Pos.xy, PosOnMap, SDF, InsideWall);
+#elif TEMPORAL_LIGHTING
+        // the ternary operator would evaluate both branches
+        float Shading = History.a;
+        if (!HasHistory)
+            Shading = ComputeShading(g_PlayerConstants.PlayerPos, PosOnMap, InsideWall);
+#else
+        float Shading = ComputeShading(g_PlayerConstants.PlayerPos, PosOnMap, InsideWall);
+#endif
+        Light += LightColor * Shading;
+    }
+
+#if MAP_LIGHTS && TEMPORAL_LIGHTING
+    if (HasHistory)
+        Light += History.rgb;
+    else
+        Light += ComputeMapLights(PSIn.Pos.xy, PosOnMap, InsideWall);
+#elif MAP_LIGHTS
+    // traced at full resolution, the lighting pass only covers the player's lights
+    Light += ComputeMapLights(PSIn.Pos.xy, PosOnMap, InsideWall);
+#endif
+    Color.rgb *= Light;
 
     // draw teleport wave
     {
@@ -196,3 +495,4 @@ float4 PSmain(in PSInput PSIn) : SV_TARGET
     return Color;
 }
 #endif
+#endif
@@ -1,6 +1,21 @@
+#include "Structures.fxh"
+
+#ifndef SDF_UNORM8
+#   define SDF_UNORM8 0 // 1 stores [-RADIUS, RADIUS] * DIST_SCALE as [0, 1] in an R8_UNORM texture
+#endif
+
+cbuffer cbSDFRegion
+{
+    SDFRegionConstants g_SDFRegion;
+};
+
 Texture2D<float>                     g_SrcTex; // R channel contains: 0 - empty, 1 - wall
 SamplerState                         g_SrcTex_sampler;
+#if SDF_UNORM8
+RWTexture2D<unorm float /* format=r8 */> g_DstTex;
+#else
 RWTexture2D<float /* format=r16f */> g_DstTex;
+#endif
 
 bool ReadWallFlag(float2 uv)
 {
@@ -12,10 +27,11 @@ void main(uint3 GlobalInvocationID : SV_DispatchThreadID)
 {
     uint2 Dim;
     g_DstTex.GetDimensions(Dim.x, Dim.y);
-    if (GlobalInvocationID.x >= Dim.x || GlobalInvocationID.y >= Dim.y)
+
+    const int2 center = g_SDFRegion.Region.xy + int2(GlobalInvocationID.xy);
+    if (any(center >= g_SDFRegion.Region.zw))
         return;
 
-    const int2   center     = int2(GlobalInvocationID.xy);
     const float2 scale      = 1.0 / float2(Dim);
     float        dist       = float(RADIUS * 2) * DIST_SCALE;
     bool         InsideWall = ReadWallFlag((float2(center) + 0.5) * scale);
@@ -37,5 +53,8 @@ void main(uint3 GlobalInvocationID : SV_DispatchThreadID)
     if (InsideWall)
         dist = -dist;
 
+#if SDF_UNORM8
+    dist = dist / (2.0 * float(RADIUS) * DIST_SCALE) + 0.5;
+#endif
     g_DstTex[center] = dist;
 }
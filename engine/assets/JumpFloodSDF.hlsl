@@ -0,0 +1,122 @@
+// Jump flooding alternative to GenerateSDF.hlsl with the same output. Every texel converges on
+// the nearest wall texel and the nearest empty texel in log2(RADIUS) passes, the signed distance
+// is then taken to whichever of the two is of the opposite type.
+// Seeds are texel coordinates, xy - nearest wall, zw - nearest empty space, NoSeed if not found yet.
+// Seeding and flooding cover the region being updated plus RADIUS around it, the resolve only
+// the region itself.
+
+#include "Structures.fxh"
+
+cbuffer cbSDFRegion
+{
+    SDFRegionConstants g_SDFRegion;
+};
+
+static const uint NoSeed = 0xFFFF;
+
+#ifndef SDF_UNORM8
+#   define SDF_UNORM8 0 // 1 stores [-RADIUS, RADIUS] * DIST_SCALE as [0, 1] in an R8_UNORM texture
+#endif
+
+#ifdef INIT_SEEDS
+Texture2D<float>                         g_SrcTex; // R channel contains: 0 - empty, 1 - wall
+RWTexture2D<uint4 /* format=rgba16ui */> g_SeedsOut;
+
+[numthreads(8, 8, 1)]
+void InitSeeds(uint3 GlobalInvocationID : SV_DispatchThreadID)
+{
+    const int2 pos = g_SDFRegion.Region.xy + int2(GlobalInvocationID.xy);
+    if (any(pos >= g_SDFRegion.Region.zw))
+        return;
+
+    const bool IsWall = g_SrcTex.Load(int3(pos, 0)).r > 0.5;
+
+    g_SeedsOut[pos] = IsWall ? uint4(uint2(pos), NoSeed, NoSeed) : uint4(NoSeed, NoSeed, uint2(pos));
+}
+#endif
+
+#ifdef JUMP_FLOOD
+Texture2D<uint4>                         g_SeedsIn;
+RWTexture2D<uint4 /* format=rgba16ui */> g_SeedsOut;
+
+void KeepNearest(inout uint2 Best, inout float BestDist, uint2 Seed, float2 pos)
+{
+    if (Seed.x == NoSeed)
+        return;
+
+    float2 d    = float2(Seed) - pos;
+    float  Dist = dot(d, d);
+    if (Dist < BestDist)
+    {
+        Best     = Seed;
+        BestDist = Dist;
+    }
+}
+
+[numthreads(8, 8, 1)]
+void JumpFlood(uint3 GlobalInvocationID : SV_DispatchThreadID)
+{
+    const int2 center = g_SDFRegion.Region.xy + int2(GlobalInvocationID.xy);
+    if (any(center >= g_SDFRegion.Region.zw))
+        return;
+
+    const float2 pos       = float2(center);
+    uint2        Wall      = uint2(NoSeed, NoSeed);
+    uint2        Empty     = uint2(NoSeed, NoSeed);
+    float        WallDist  = 1e30;
+    float        EmptyDist = 1e30;
+
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            int2 p = center + int2(x, y) * g_SDFRegion.Step;
+            if (any(p < g_SDFRegion.Region.xy) || any(p >= g_SDFRegion.Region.zw))
+                continue;
+
+            uint4 Seeds = g_SeedsIn.Load(int3(p, 0));
+            KeepNearest(Wall, WallDist, Seeds.xy, pos);
+            KeepNearest(Empty, EmptyDist, Seeds.zw, pos);
+        }
+    }
+
+    g_SeedsOut[center] = uint4(Wall, Empty);
+}
+#endif
+
+#ifdef RESOLVE
+Texture2D<uint4> g_SeedsIn;
+#if SDF_UNORM8
+RWTexture2D<unorm float /* format=r8 */> g_DstTex;
+#else
+RWTexture2D<float /* format=r16f */> g_DstTex;
+#endif
+
+[numthreads(8, 8, 1)]
+void Resolve(uint3 GlobalInvocationID : SV_DispatchThreadID)
+{
+    const int2 pos = g_SDFRegion.Region.xy + int2(GlobalInvocationID.xy);
+    if (any(pos >= g_SDFRegion.Region.zw))
+        return;
+
+    const uint2 center     = uint2(pos);
+    const uint4 Seeds      = g_SeedsIn.Load(int3(center, 0));
+    const bool  InsideWall = all(Seeds.xy == center);
+    const uint2 Nearest    = InsideWall ? Seeds.zw : Seeds.xy;
+
+    // same clamping as the brute force search, which never looks further than RADIUS
+    float dist = float(RADIUS);
+    if (Nearest.x != NoSeed)
+        dist = min(dist, distance(float2(Nearest), float2(center)));
+
+    dist *= DIST_SCALE;
+
+    if (InsideWall)
+        dist = -dist;
+
+#if SDF_UNORM8
+    dist = dist / (2.0 * float(RADIUS) * DIST_SCALE) + 0.5;
+#endif
+    g_DstTex[center] = dist;
+}
+#endif
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "render/FrustumCulling.h"
+
+using namespace bt;
+
+// Culls a field of random boxes around the camera with every compiled kernel and
+// reports throughput. Usage: bench_culling [NumBoxes] [Iterations]
+int main(int argc, char **argv) {
+    const Uint32 NumBoxes = argc > 1 ? static_cast<Uint32>(std::atoi(argv[1])) : 4u * 1024u * 1024u;
+    const Uint32 Iterations = argc > 2 ? static_cast<Uint32>(std::atoi(argv[2])) : 50u;
+
+    const Matrix View = glm::lookAt(Vector(0.0, 0.0, 0.0), Vector(0.0, 0.0, 1.0), Vector(0.0, 1.0, 0.0));
+    const Matrix Proj = glm::perspective(glm::radians(70.0), 16.0 / 9.0, 0.1, 1000.0);
+    const Frustum ViewFrustum = ExtractFrustum(Proj * View);
+
+    std::mt19937 Rng(723);
+    std::uniform_real_distribution<double> Pos(-500.0, 500.0);
+    std::uniform_real_distribution<double> Size(0.1, 4.0);
+
+    BoundingBoxesSoA Boxes;
+    BoundingSpheresSoA Spheres;
+    Boxes.Reserve(NumBoxes);
+    Spheres.Reserve(NumBoxes);
+    for (Uint32 i = 0; i < NumBoxes; ++i) {
+        const Vector Center(Pos(Rng), Pos(Rng), Pos(Rng));
+        const Vector Extent(Size(Rng), Size(Rng), Size(Rng));
+        Boxes.Add(Center, Extent);
+        Spheres.Add(Center, static_cast<float>(glm::length(Extent)));
+    }
+
+    std::printf("%u objects, %u iterations, best kernel: %s\n", NumBoxes, Iterations,
+                GetCullingKernelName(GetCullingKernel()));
+
+    std::vector<Uint32> Visible;
+    Visible.reserve(NumBoxes);
+
+    auto Run = [&](const char *Name, CullingKernel Kernel, auto &&CullFn) {
+        if (static_cast<Uint8>(Kernel) > static_cast<Uint8>(GetCullingKernel()))
+            return;
+
+        Uint32 NumVisible = CullFn(Kernel); // warm up caches and the output buffer
+        const auto Start = std::chrono::high_resolution_clock::now();
+        for (Uint32 i = 0; i < Iterations; ++i) {
+            NumVisible = CullFn(Kernel);
+        }
+        const auto End = std::chrono::high_resolution_clock::now();
+
+        const double Ms = std::chrono::duration<double, std::milli>(End - Start).count() / Iterations;
+        std::printf("  %-8s %-6s %8.3f ms/pass  %8.2f M objects/ms  visible %u\n", Name,
+                    GetCullingKernelName(Kernel), Ms, NumBoxes / Ms / 1.0e6, NumVisible);
+    };
+
+    for (auto Kernel: {CullingKernel::Scalar, CullingKernel::SSE, CullingKernel::AVX2}) {
+        Run("boxes", Kernel, [&](CullingKernel K) { return CullBoxes(K, ViewFrustum, Boxes, Visible); });
+        Run("spheres", Kernel, [&](CullingKernel K) { return CullSpheres(K, ViewFrustum, Spheres, Visible); });
+    }
+
+    // Every thread culls its own slice into its own region of the output
+    const Uint32 NumThreads = std::max(1u, std::thread::hardware_concurrency());
+    const Uint32 SliceSize = (NumBoxes + NumThreads - 1) / NumThreads;
+    std::vector<Uint32> SliceOutput(NumBoxes);
+    std::vector<Uint32> SliceVisible(NumThreads);
+    Run("boxes-mt", GetCullingKernel(), [&](CullingKernel K) {
+        std::vector<std::thread> Threads;
+        for (Uint32 t = 0; t < NumThreads; ++t) {
+            Threads.emplace_back([&, t]() {
+                const Uint32 First = std::min(t * SliceSize, NumBoxes);
+                const Uint32 Count = std::min(SliceSize, NumBoxes - First);
+                SliceVisible[t] = CullBoxes(K, ViewFrustum, Boxes, First, Count, SliceOutput.data() + First);
+            });
+        }
+        Uint32 NumVisible = 0;
+        for (Uint32 t = 0; t < NumThreads; ++t) {
+            Threads[t].join();
+            NumVisible += SliceVisible[t];
+        }
+        return NumVisible;
+    });
+    std::printf("  (%u threads)\n", NumThreads);
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "core/ThreadPool.h"
+#include "render/SDFBaker.h"
+#include "render/SDFDirtyRegions.h"
+
+using namespace bt;
+
+namespace {
+
+// Rooms carved out of solid rock plus scattered pillars
+std::vector<Uint8> MakeWallMap(Uint32 Size) {
+    std::vector<Uint8> Map(static_cast<size_t>(Size) * Size, 255);
+    std::mt19937 Rng(Size);
+    auto Fill = [&](Uint32 NumRects, Uint32 MinSize, Uint32 MaxSize, Uint8 Value) {
+        std::uniform_int_distribution<Uint32> Extent(MinSize, MaxSize);
+        std::uniform_int_distribution<Uint32> Pos(0, Size - 1);
+        for (Uint32 i = 0; i < NumRects; ++i) {
+            const Uint32 X0 = Pos(Rng), Y0 = Pos(Rng);
+            const Uint32 X1 = std::min(Size, X0 + Extent(Rng)), Y1 = std::min(Size, Y0 + Extent(Rng));
+            for (Uint32 y = Y0; y < Y1; ++y) {
+                std::fill(Map.begin() + y * Size + X0, Map.begin() + y * Size + X1, Value);
+            }
+        }
+    };
+    Fill(Size / 4, std::max(Size / 32, 1u), Size / 6, 0);
+    Fill(Size / 2, 2, 8, 255);
+    return Map;
+}
+
+// Same search as GenerateSDF.hlsl, including its clamp-to-edge reads
+float BruteForceTexel(const std::vector<Uint8> &Map, Uint32 Size, const SDFParams &Params, int X, int Y) {
+    const int R = static_cast<int>(Params.Radius);
+    const int Last = static_cast<int>(Size) - 1;
+    auto IsWall = [&](int x, int y) {
+        return Map[static_cast<size_t>(std::clamp(y, 0, Last)) * Size + std::clamp(x, 0, Last)] > 127;
+    };
+    const bool InsideWall = IsWall(X, Y);
+    float Dist = static_cast<float>(R);
+    for (int y = -R; y <= R; ++y) {
+        for (int x = -R; x <= R; ++x) {
+            if (IsWall(X + x, Y + y) != InsideWall) {
+                Dist = std::min(Dist, std::sqrt(static_cast<float>(x * x + y * y)));
+            }
+        }
+    }
+    Dist *= Params.DistScale;
+    return InsideWall ? -Dist : Dist;
+}
+
+}
+
+// Bakes random maps on one thread and on all of them, and checks the result against the brute
+// force search of the GPU shader. Then times an update after a small edit of the map against
+// a full bake. Usage: bench_sdf_bake [MaxSize] [Iterations]
+int main(int argc, char **argv) {
+    const Uint32 MaxSize = argc > 1 ? static_cast<Uint32>(std::atoi(argv[1])) : 4096u;
+    const Uint32 Iterations = argc > 2 ? static_cast<Uint32>(std::atoi(argv[2])) : 10u;
+
+    ThreadPool Workers;
+    std::printf("kernel %s, %u worker threads, %u iterations\n", SDFBaker::GetKernelName(), Workers.GetNumThreads(),
+                Iterations);
+
+    int Result = 0;
+    for (Uint32 Size = 256; Size <= MaxSize; Size *= 2) {
+        const auto Map = MakeWallMap(Size);
+        std::vector<float> SDF(Map.size());
+
+        for (const Uint32 Radius: {8u, 32u, 128u}) {
+            const SDFParams Params{Radius};
+
+            auto Time = [&](SDFBaker &Baker) {
+                Baker.Bake(Map.data(), Size, Size, SDF.data()); // warm up the scratch buffers
+                const auto Start = std::chrono::high_resolution_clock::now();
+                for (Uint32 i = 0; i < Iterations; ++i) {
+                    Baker.Bake(Map.data(), Size, Size, SDF.data());
+                }
+                const auto End = std::chrono::high_resolution_clock::now();
+                return std::chrono::duration<double, std::milli>(End - Start).count() / Iterations;
+            };
+            SDFBaker SingleThreaded(Params);
+            SDFBaker MultiThreaded(Params, &Workers);
+            const double SingleMs = Time(SingleThreaded);
+            const double MultiMs = Time(MultiThreaded);
+
+            // The reference is O(R^2) per texel, check a sample of texels on big maps
+            const Uint32 Step = std::max(1u, Size * Radius / 2048);
+            float MaxError = 0.f;
+            for (Uint32 y = 0; y < Size; y += Step) {
+                for (Uint32 x = 0; x < Size; x += Step) {
+                    const float Expected = BruteForceTexel(Map, Size, Params, static_cast<int>(x), static_cast<int>(y));
+                    MaxError = std::max(MaxError, std::abs(SDF[static_cast<size_t>(y) * Size + x] - Expected));
+                }
+            }
+            if (MaxError > 1e-4f) {
+                Result = 1;
+            }
+
+            std::printf("  %4ux%-4u radius %3u  1 thread %8.3f ms  %2u threads %8.3f ms  %7.1f Mtexels/s",
+                        Size, Size, Radius, SingleMs, Workers.GetNumThreads() + 1, MultiMs,
+                        static_cast<double>(Map.size()) / MultiMs / 1000.0);
+            std::printf("  max error %g\n", MaxError);
+
+            // Knock an 8x8 hole into the map, as a destroyed wall would
+            auto Edited = Map;
+            const SDFRect Edit{Size / 3, Size / 3, Size / 3 + 8, Size / 3 + 8};
+            for (Uint32 y = Edit.Y0; y < Edit.Y1; ++y) {
+                std::fill(Edited.begin() + y * Size + Edit.X0, Edited.begin() + y * Size + Edit.X1, Uint8(0));
+            }
+            std::vector<float> Expected(Map.size());
+            MultiThreaded.Bake(Edited.data(), Size, Size, Expected.data());
+
+            const auto Start = std::chrono::high_resolution_clock::now();
+            SDFDirtyRegions Dirty;
+            Dirty.Add(Edit);
+            for (const auto &Rect: Dirty.Take(Radius, Size, Size)) {
+                MultiThreaded.BakeRegion(Edited.data(), Size, Size, Rect, SDF.data());
+            }
+            const auto End = std::chrono::high_resolution_clock::now();
+
+            const bool Same = std::equal(SDF.begin(), SDF.end(), Expected.begin());
+            if (!Same) {
+                Result = 1;
+            }
+            std::printf("    8x8 edit update %8.3f ms, %s the full bake\n",
+                        std::chrono::duration<double, std::milli>(End - Start).count(),
+                        Same ? "matches" : "DIFFERS from");
+        }
+    }
+    return Result;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "core/ThreadPool.h"
+#include "render/SDFBaker.h"
+#include "render/SDFQuery.h"
+
+using namespace bt;
+
+namespace {
+
+// Rooms carved out of solid rock plus scattered pillars, as in bench_sdf_bake
+std::vector<Uint8> MakeWallMap(Uint32 Size) {
+    std::vector<Uint8> Map(static_cast<size_t>(Size) * Size, 255);
+    std::mt19937 Rng(Size);
+    auto Fill = [&](Uint32 NumRects, Uint32 MinSize, Uint32 MaxSize, Uint8 Value) {
+        std::uniform_int_distribution<Uint32> Extent(MinSize, MaxSize);
+        std::uniform_int_distribution<Uint32> Pos(0, Size - 1);
+        for (Uint32 i = 0; i < NumRects; ++i) {
+            const Uint32 X0 = Pos(Rng), Y0 = Pos(Rng);
+            const Uint32 X1 = std::min(Size, X0 + Extent(Rng)), Y1 = std::min(Size, Y0 + Extent(Rng));
+            for (Uint32 y = Y0; y < Y1; ++y) {
+                std::fill(Map.begin() + y * Size + X0, Map.begin() + y * Size + X1, Value);
+            }
+        }
+    };
+    Fill(Size / 4, std::max(Size / 32, 1u), Size / 6, 0);
+    Fill(Size / 2, 2, 8, 255);
+    return Map;
+}
+
+// Walks the segment a tenth of a texel at a time over the wall map itself
+bool DenseLineOfSight(const std::vector<Uint8> &Map, Uint32 Size, float DistScale, float AX, float AY, float BX,
+                      float BY) {
+    const float Length = std::hypot(BX - AX, BY - AY) / DistScale;
+    const auto NumSteps = static_cast<Uint32>(std::ceil(Length * 10.f)) + 1;
+    for (Uint32 i = 0; i <= NumSteps; ++i) {
+        const float t = static_cast<float>(i) / static_cast<float>(NumSteps);
+        const auto X = static_cast<Uint32>(std::clamp((AX + (BX - AX) * t) / DistScale, 0.f, Size - 1.f));
+        const auto Y = static_cast<Uint32>(std::clamp((AY + (BY - AY) * t) / DistScale, 0.f, Size - 1.f));
+        if (Map[static_cast<size_t>(Y) * Size + X] > 127) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double TimeMs(Uint32 Iterations, const std::function<void()> &Fn) {
+    Fn(); // warm up caches
+    const auto Start = std::chrono::high_resolution_clock::now();
+    for (Uint32 i = 0; i < Iterations; ++i) {
+        Fn();
+    }
+    const auto End = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(End - Start).count() / Iterations;
+}
+
+}
+
+// Point samples, sphere casts and line of sight checks against a baked map with every compiled
+// kernel, on one thread and on all of them. Checks that the kernels agree and compares line of
+// sight with a dense walk of the wall map. Usage: bench_sdf_query [MapSize] [NumQueries] [Iterations]
+int main(int argc, char **argv) {
+    const Uint32 Size = argc > 1 ? static_cast<Uint32>(std::atoi(argv[1])) : 2048u;
+    const Uint32 NumQueries = argc > 2 ? static_cast<Uint32>(std::atoi(argv[2])) : 64u * 1024u;
+    const Uint32 Iterations = argc > 3 ? static_cast<Uint32>(std::atoi(argv[3])) : 10u;
+
+    ThreadPool Workers;
+    const SDFParams Params;
+    const auto Map = MakeWallMap(Size);
+    std::vector<float> SDF(Map.size());
+    SDFBaker(Params, &Workers).Bake(Map.data(), Size, Size, SDF.data());
+    const SDFQuery Query(SDF.data(), Size, Size, Params);
+
+    // Queries between empty texels, as AI agents standing in rooms would make them
+    const float MapExtent = static_cast<float>(Size) * Params.DistScale;
+    std::mt19937 Rng(NumQueries);
+    std::uniform_real_distribution<float> Pos(0.f, MapExtent);
+    std::uniform_real_distribution<float> Offset(-MapExtent / 16.f, MapExtent / 16.f);
+    auto RandomEmptyPoint = [&](float &X, float &Y) {
+        do {
+            X = Pos(Rng);
+            Y = Pos(Rng);
+        } while (Query.IsInsideWall(X, Y));
+    };
+    SDFPointsSoA Points;
+    SDFRaysSoA Casts;
+    SDFRaysSoA Sights;
+    Points.Reserve(NumQueries);
+    Casts.Reserve(NumQueries);
+    Sights.Reserve(NumQueries);
+    for (Uint32 i = 0; i < NumQueries; ++i) {
+        Points.Add(Pos(Rng), Pos(Rng));
+        float AX, AY, BX, BY;
+        RandomEmptyPoint(AX, AY);
+        BX = std::clamp(AX + Offset(Rng), 0.f, MapExtent);
+        BY = std::clamp(AY + Offset(Rng), 0.f, MapExtent);
+        // A player sized circle
+        Casts.AddSegment(AX, AY, BX, BY, Params.DistScale * 4.f);
+        Sights.AddSegment(AX, AY, BX, BY);
+    }
+
+    std::printf("%ux%u map, %u queries, %u iterations, %u worker threads, best kernel: %s\n", Size, Size, NumQueries,
+                Iterations, Workers.GetNumThreads(), GetSDFQueryKernelName(GetSDFQueryKernel()));
+
+    std::vector<float> Dist(NumQueries);
+    std::vector<float> T(NumQueries);
+    std::vector<Uint8> Visible(NumQueries);
+    std::vector<float> ScalarDist, ScalarT;
+    std::vector<Uint8> ScalarVisible;
+    int Result = 0;
+
+    for (auto Kernel: {SDFQueryKernel::Scalar, SDFQueryKernel::AVX2}) {
+        if (static_cast<Uint8>(Kernel) > static_cast<Uint8>(GetSDFQueryKernel())) {
+            continue;
+        }
+        const double SampleMs = TimeMs(Iterations, [&] { Query.Sample(Kernel, Points, 0, NumQueries, Dist.data()); });
+        const double CastMs = TimeMs(Iterations, [&] { Query.SphereCast(Kernel, Casts, 0, NumQueries, T.data()); });
+        Uint32 NumVisible = 0;
+        const double SightMs = TimeMs(Iterations, [&] {
+            NumVisible = Query.LineOfSight(Kernel, Sights, 0, NumQueries, Visible.data());
+        });
+        std::printf("  %-6s 1 thread   samples %8.3f ms  sphere casts %8.3f ms  line of sight %8.3f ms (%u visible)\n",
+                    GetSDFQueryKernelName(Kernel), SampleMs, CastMs, SightMs, NumVisible);
+
+        // Split into slices like gameplay code spreading its checks over the workers would
+        const Uint32 NumSlices = Workers.GetNumThreads() + 1;
+        const Uint32 SliceSize = (NumQueries + NumSlices - 1) / NumSlices;
+        auto Slices = [&](const std::function<void(Uint32, Uint32)> &Fn) {
+            Workers.ParallelFor(NumSlices, [&](Uint32 Slice) {
+                const Uint32 First = std::min(Slice * SliceSize, NumQueries);
+                Fn(First, std::min(SliceSize, NumQueries - First));
+            });
+        };
+        const double ParallelSightMs = TimeMs(Iterations, [&] {
+            Slices([&](Uint32 First, Uint32 Count) {
+                Query.LineOfSight(Kernel, Sights, First, Count, Visible.data() + First);
+            });
+        });
+        std::printf("  %-6s %2u threads line of sight %8.3f ms, %.1f M checks/s\n", GetSDFQueryKernelName(Kernel),
+                    NumSlices, ParallelSightMs, NumQueries / ParallelSightMs / 1000.0);
+
+        if (Kernel == SDFQueryKernel::Scalar) {
+            ScalarDist = Dist;
+            ScalarT = T;
+            ScalarVisible = Visible;
+            continue;
+        }
+        // FMA rounding may move a march by a step where it grazes a wall, the samples must match
+        float MaxSampleError = 0.f;
+        Uint32 NumCastsDiffering = 0, NumSightsDiffering = 0;
+        for (Uint32 i = 0; i < NumQueries; ++i) {
+            MaxSampleError = std::max(MaxSampleError, std::abs(Dist[i] - ScalarDist[i]));
+            NumCastsDiffering += std::abs(T[i] - ScalarT[i]) > Params.DistScale ? 1 : 0;
+            NumSightsDiffering += Visible[i] != ScalarVisible[i] ? 1 : 0;
+        }
+        if (MaxSampleError > 1e-4f) {
+            Result = 1;
+        }
+        std::printf("    against scalar: max sample error %g, %u sphere casts and %u line of sight results differ\n",
+                    MaxSampleError, NumCastsDiffering, NumSightsDiffering);
+    }
+
+    // The SDF is bilinear and stops a quarter texel short of walls, so corners grazed by the dense walk
+    // may disagree
+    const Uint32 NumChecked = std::min(NumQueries, 4096u);
+    Uint32 NumAgreeing = 0;
+    for (Uint32 i = 0; i < NumChecked; ++i) {
+        const float AX = Sights.OriginX[i], AY = Sights.OriginY[i];
+        const float BX = AX + Sights.DirX[i] * Sights.Length[i], BY = AY + Sights.DirY[i] * Sights.Length[i];
+        NumAgreeing += DenseLineOfSight(Map, Size, Params.DistScale, AX, AY, BX, BY) == (ScalarVisible[i] != 0);
+    }
+    std::printf("  line of sight agrees with a dense walk of the wall map on %.2f%% of %u segments\n",
+                100.0 * NumAgreeing / NumChecked, NumChecked);
+    return Result;
+}
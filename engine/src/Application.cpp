@@ -1,14 +1,30 @@
 ﻿#include <memory>
+#include <algorithm>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "Application.h"
 
-#include "ImGuiImplWin32.hpp"
+#if PLATFORM_WIN32
+#    include "ImGuiImplWin32.hpp"
+#endif
+#include "platform/Platform.h"
 #include "Timer.hpp"
 #include "BasicMath.hpp"
 #include "input/InputManager.h"
 #include "core/Logging.h"
 #include "editor/TestCube.h"
+#include "editor/CubeField.h"
+#include "render/InstancedRenderer.h"
+#include "render/UploadRing.h"
+#include "render/RenderGraph.h"
+#include "render/FrameSync.h"
+#include "render/DynamicResolution.h"
+#include "render/GpuProfiler.h"
+#include "render/TextureReadback.h"
+#include "render/PipelineCache.h"
+#include "core/ThreadPool.h"
 #include "core/Logging.h"
 #include "imgui.h"
 
@@ -18,6 +34,32 @@ namespace bt {
 
     std::unique_ptr<Application> gTheApp;
 
+    namespace {
+
+#ifdef BT_FRAMES_IN_FLIGHT
+        constexpr Uint32 NumFramesInFlight = BT_FRAMES_IN_FLIGHT;
+#else
+        constexpr Uint32 NumFramesInFlight = 2;
+#endif
+
+        // Per-pass GPU timings are written here from the profiler panel
+        constexpr const char *GpuProfileCSV = "gpu_profile.csv";
+
+        // GPU timing drives dynamic resolution and the profiler, it is used where the adapter has it
+        void RequestOptionalFeatures(EngineCreateInfo &EngineCI) {
+            EngineCI.Features.TimestampQueries = DEVICE_FEATURE_STATE_OPTIONAL;
+            EngineCI.Features.DurationQueries = DEVICE_FEATURE_STATE_OPTIONAL;
+        }
+
+        // Deferred contexts for parallel scene recording, one per hardware thread up to a limit.
+        // Fewer than two are not worth the submission overhead.
+        Uint32 GetNumRecordingContexts() {
+            const auto NumContexts = std::min(std::thread::hardware_concurrency(), 8u);
+            return NumContexts >= 2 ? NumContexts : 0;
+        }
+
+    }
+
     Application::Application() {
         m_log = new EditorLog();
         log::GLogger->RegisterDelegate(m_log);
@@ -26,7 +68,12 @@ namespace bt {
     Application::~Application() {
     }
 
-    bool Application::Init(HWND hWnd) {
+    bool Application::Init(Platform &Plat) {
+        NativeWindow Window;
+        if (!Plat.GetNativeWindow(Window)) {
+            log::Error("The platform has no window to render to");
+            return false;
+        }
 
         auto msg = fmt::format("===== BorschTech initialized!!! ====== {}", 723);
         bt::log::Debug(msg);
@@ -36,6 +83,7 @@ namespace bt {
 #if D3D11_SUPPORTED
             case RENDER_DEVICE_TYPE_D3D11: {
                 EngineD3D11CreateInfo EngineCI;
+                RequestOptionalFeatures(EngineCI);
 #    if ENGINE_DLL
                 // Load the dll and import GetEngineFactoryD3D11() function
                 auto *GetEngineFactoryD3D11 = LoadGraphicsEngineD3D11();
@@ -56,12 +104,16 @@ namespace bt {
                 auto GetEngineFactoryD3D12 = LoadGraphicsEngineD3D12();
 #    endif
                 EngineD3D12CreateInfo EngineCI;
+                RequestOptionalFeatures(EngineCI);
+                EngineCI.NumDeferredContexts = GetNumRecordingContexts();
 
                 auto *pFactoryD3D12 = GetEngineFactoryD3D12();
 
                 m_pEngineFactory = pFactoryD3D12;
 
-                pFactoryD3D12->CreateDeviceAndContextsD3D12(EngineCI, &m_pDevice, &m_pImmediateContext);
+                std::vector<IDeviceContext *> ppContexts(1 + EngineCI.NumDeferredContexts);
+                pFactoryD3D12->CreateDeviceAndContextsD3D12(EngineCI, &m_pDevice, ppContexts.data());
+                AttachContexts(ppContexts);
             }
                 break;
 #endif
@@ -78,7 +130,8 @@ namespace bt {
                 m_pEngineFactory = pFactoryOpenGL;
 
                 EngineGLCreateInfo EngineCI;
-                EngineCI.Window.hWnd = hWnd;
+                EngineCI.Window = Window;
+                RequestOptionalFeatures(EngineCI);
 
                 pFactoryOpenGL->CreateDeviceAndSwapChainGL(EngineCI, &m_pDevice, &m_pImmediateContext, SCDesc,
                                                            &m_pSwapChain);
@@ -94,9 +147,15 @@ namespace bt {
                 auto GetEngineFactoryVk = LoadGraphicsEngineVk();
 #    endif
                 EngineVkCreateInfo EngineCI;
+                RequestOptionalFeatures(EngineCI);
+                // The upload ring maps through the dynamic heap when there is no unified memory
+                EngineCI.DynamicHeapSize = 64 << 20;
+                EngineCI.NumDeferredContexts = GetNumRecordingContexts();
 
                 auto *pFactoryVk = GetEngineFactoryVk();
-                pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &m_pDevice, &m_pImmediateContext);
+                std::vector<IDeviceContext *> ppContexts(1 + EngineCI.NumDeferredContexts);
+                pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &m_pDevice, ppContexts.data());
+                AttachContexts(ppContexts);
 
                 m_pEngineFactory = pFactoryVk;
             }
@@ -109,24 +168,133 @@ namespace bt {
                 break;
         }
 
-        CreateSwapChain(m_pSwapChain, hWnd, false);
+        CreateSwapChain(m_pSwapChain, Window, false);
+        CreateRenderer();
 
         // Initialize Dear ImGUI
         const auto &SC = m_pSwapChain->GetDesc();
-        m_pImGui = std::make_unique<ImGuiImplWin32>(hWnd, m_pDevice, SC.ColorBufferFormat, SC.DepthBufferFormat);
+        m_pImGui = Plat.CreateImGui(m_pDevice, SC.ColorBufferFormat, SC.DepthBufferFormat);
+
+        mGameView->ViewCamera.SetViewPortSize(SC.Width, SC.Height);
+
+        return true;
+    }
+
+    bool Application::InitHeadless(Uint32 Width, Uint32 Height, bool PreferSoftwareAdapter) {
+#if VULKAN_SUPPORTED
+#    if EXPLICITLY_LOAD_ENGINE_VK_DLL
+        auto GetEngineFactoryVk = LoadGraphicsEngineVk();
+#    endif
+        m_DeviceType = RENDER_DEVICE_TYPE_VULKAN;
+
+        EngineVkCreateInfo EngineCI;
+        RequestOptionalFeatures(EngineCI);
+        EngineCI.DynamicHeapSize = 64 << 20;
+        EngineCI.NumDeferredContexts = GetNumRecordingContexts();
+
+        auto *pFactoryVk = GetEngineFactoryVk();
+        if (PreferSoftwareAdapter) {
+            // E.g. lavapipe on build machines without a GPU
+            Uint32 NumAdapters = 0;
+            pFactoryVk->EnumerateAdapters(EngineCI.GraphicsAPIVersion, NumAdapters, nullptr);
+            std::vector<GraphicsAdapterInfo> Adapters(NumAdapters);
+            pFactoryVk->EnumerateAdapters(EngineCI.GraphicsAPIVersion, NumAdapters, Adapters.data());
+            for (Uint32 i = 0; i < NumAdapters; ++i) {
+                if (Adapters[i].Type == ADAPTER_TYPE_SOFTWARE) {
+                    EngineCI.AdapterId = i;
+                    break;
+                }
+            }
+        }
 
-        mCube = std::make_unique<TestCube>();
-        mCube2 = std::make_unique<TestCube>();
+        std::vector<IDeviceContext *> ppContexts(1 + EngineCI.NumDeferredContexts);
+        pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &m_pDevice, ppContexts.data());
+        if (!m_pDevice) {
+            log::Error("Failed to create a Vulkan device for headless rendering");
+            return false;
+        }
+        AttachContexts(ppContexts);
+        m_pEngineFactory = pFactoryVk;
+        log::Info(fmt::format("Headless rendering on {}", m_pDevice->GetAdapterInfo().Description));
+
+        CreateRenderer();
+
+        // Only the offscreen viewport is rendered, at a fixed resolution
+        mGameView->Enabled = false;
+        mEditorView->ViewCamera.SetViewPortSize(Width, Height);
+        mTestRenderTarget->SetSize(Width, Height);
+        mDynamicResolution->GetSettings().Enabled = false;
+        mReadback = std::make_unique<TextureReadback>(m_pDevice);
+        return true;
+#else
+        log::Error("Headless rendering needs the Vulkan backend");
+        return false;
+#endif
+    }
+
+    void Application::CreateRenderer() {
+        std::string ShaderPackPath;
+#ifdef BT_SHADER_PACK_PATH
+        ShaderPackPath = BT_SHADER_PACK_PATH;
+#endif
+        mThreadPool = std::make_unique<ThreadPool>();
+        mPipelineCache = std::make_unique<PipelineCache>(m_pDevice, m_pEngineFactory, mThreadPool.get(), BT_ASSETS_DIR,
+                                                         BT_SHADER_CACHE_DIR, ShaderPackPath);
+
+        mFrameSync = std::make_unique<FrameSync>(m_pDevice, m_pImmediateContext, NumFramesInFlight);
+        mUploadRing = std::make_unique<UploadRing>(m_pDevice, m_pImmediateContext, *mFrameSync, "Geometry upload ring",
+                                                   BIND_VERTEX_BUFFER | BIND_INDEX_BUFFER, 16 << 20);
+
+        mRenderGraph = std::make_unique<RenderGraph>(m_pDevice, *mFrameSync);
+        mDynamicResolution = std::make_unique<DynamicResolution>(m_pDevice);
+        mGpuProfiler = std::make_unique<GpuProfiler>(m_pDevice, mFrameSync->GetNumFramesInFlight());
+        mRenderGraph->SetProfiler(mGpuProfiler.get());
+        mInstancedRenderer = std::make_unique<InstancedRenderer>(m_pDevice, mUploadRing.get());
+        if (m_pDeferredContexts.size() >= 2) {
+            // The main thread records one slice itself
+            mRecordingThreads = std::make_unique<ThreadPool>(static_cast<uint32_t>(m_pDeferredContexts.size() - 1));
+
+            std::vector<IDeviceContext *> Contexts;
+            for (auto &pContext: m_pDeferredContexts) {
+                Contexts.push_back(pContext);
+            }
+            mInstancedRenderer->SetRecordingContexts(mRecordingThreads.get(), std::move(Contexts));
+        }
+
+        mCubeMesh = TestCube::CreateMesh();
+        mCube = std::make_unique<TestCube>(mCubeMesh);
+        mCube2 = std::make_unique<TestCube>(mCubeMesh);
 
         mCube->SetLocation(Vector(1.f, 0.f, 0.f));
         mCube2->SetLocation(Vector(-1.f, 0.f, 0.f));
 
-        mTestRenderTarget = std::make_unique<RenderTarget>(m_pDevice);
+        mCubeBounds = mScene.AddBounds(mCube->GetLocation(), TestCube::GetBoundsExtent());
+        mCube2Bounds = mScene.AddBounds(mCube2->GetLocation(), TestCube::GetBoundsExtent());
 
-        return true;
+        mCubeField = std::make_unique<CubeField>(mScene, mCubeMesh);
+
+        mTestRenderTarget = std::make_unique<RenderTarget>();
+
+        mEditorView = &mViews.AddView("Editor viewport", RenderViewType::EditorViewport, mTestRenderTarget.get());
+        mEditorView->ViewCamera.LookAt(Vector(0.f, 2.0f, -5.0f), Vector(0.f, 0.f, 0.f), Vector(0.0f, 1.f, 0.f));
+
+        mGameView = &mViews.AddView("Game view", RenderViewType::Game);
+        mGameView->ViewCamera.LookAt(Vector(0.f, 2.0f, -5.0f), Vector(0.f, 0.f, 0.f), Vector(0.0f, 1.f, 0.f));
+    }
+
+    void Application::AttachContexts(const std::vector<IDeviceContext *> &ppContexts) {
+        // The immediate context comes first, the deferred ones follow
+        m_pImmediateContext.Attach(ppContexts[0]);
+        for (size_t i = 1; i < ppContexts.size(); ++i) {
+            if (ppContexts[i] != nullptr) {
+                m_pDeferredContexts.emplace_back();
+                m_pDeferredContexts.back().Attach(ppContexts[i]);
+            }
+        }
     }
 
-    bool Application::CreateSwapChain(RefCntAutoPtr<ISwapChain> &result, HWND hWnd, bool isAdditional) {
+    bool Application::CreateSwapChain(RefCntAutoPtr<ISwapChain> &result, const NativeWindow &Window,
+                                      bool isAdditional) {
         SwapChainDesc SCDesc;
 
         if (isAdditional) {
@@ -136,7 +304,6 @@ namespace bt {
         switch (m_DeviceType) {
 #if D3D11_SUPPORTED
             case RENDER_DEVICE_TYPE_D3D11: {
-                Win32NativeWindow Window{hWnd};
                 ((IEngineFactoryD3D11 *) m_pEngineFactory.RawPtr())->CreateSwapChainD3D11(m_pDevice,
                                                                                           m_pImmediateContext,
                                                                                           SCDesc,
@@ -150,7 +317,6 @@ namespace bt {
 
 #if D3D12_SUPPORTED
             case RENDER_DEVICE_TYPE_D3D12: {
-                Win32NativeWindow Window{hWnd};
                 ((IEngineFactoryD3D12 *) m_pEngineFactory.RawPtr())->CreateSwapChainD3D12(m_pDevice,
                                                                                           m_pImmediateContext,
                                                                                           SCDesc,
@@ -173,7 +339,7 @@ namespace bt {
                 m_pEngineFactory = pFactoryOpenGL;
 
                 EngineGLCreateInfo EngineCI;
-                EngineCI.Window.hWnd = hWnd;
+                EngineCI.Window = Window;
 
                 pFactoryOpenGL->CreateDeviceAndSwapChainGL(EngineCI, &m_pDevice, &m_pImmediateContext, SCDesc,
                                                            &m_pSwapChain);
@@ -184,7 +350,6 @@ namespace bt {
 
 #if VULKAN_SUPPORTED
             case RENDER_DEVICE_TYPE_VULKAN: {
-                Win32NativeWindow Window{hWnd};
                 ((IEngineFactoryVk *) m_pEngineFactory.RawPtr())->CreateSwapChainVk(m_pDevice,
                                                                                     m_pImmediateContext,
                                                                                     SCDesc,
@@ -204,6 +369,9 @@ namespace bt {
     }
 
     void Application::Shutdown() {
+        if (mFrameSync) {
+            mFrameSync->WaitIdle();
+        }
     }
 
     void Application::Tick(double CurrTime, double ElapsedTime) {
@@ -213,33 +381,161 @@ namespace bt {
     }
 
     void Application::Render() {
-        mTestRenderTarget->Activate(m_pImmediateContext);
+        mFrameSync->BeginFrame();
+        mPipelineCache->Update();
+        mUploadRing->BeginFrame();
+        mInstancedRenderer->BeginFrame();
+        mViews.PrepareViews(mScene);
+
+        // The scale picked from earlier frames' timings applies to this frame's viewport target
+        mDynamicResolution->Update();
+        mTestRenderTarget->SetResolutionScale(mDynamicResolution->GetScale());
+
+        mRenderGraph->Reset();
+        // Headless mode has no swap chain, only views with their own target are enabled then
+        auto BackBuffer = InvalidRGTexture;
+        auto DepthBuffer = InvalidRGTexture;
+        if (m_pSwapChain) {
+            BackBuffer = mRenderGraph->ImportTexture(m_pSwapChain->GetCurrentBackBufferRTV()->GetTexture());
+            DepthBuffer = mRenderGraph->ImportTexture(m_pSwapChain->GetDepthBufferDSV()->GetTexture());
+        }
 
-        mCube->DrawCube(mCamera.GetProjView());
+        mViews.ForEachView([&](RenderView &View) {
+            mRenderGraph->AddPass(
+                View.Name.c_str(),
+                [&](RenderGraphBuilder &Builder) {
+                    if (View.Target != nullptr) {
+                        View.Target->DeclareOutputs(Builder);
+                    } else {
+                        Builder.Write(BackBuffer, RESOURCE_STATE_RENDER_TARGET);
+                        Builder.Write(DepthBuffer, RESOURCE_STATE_DEPTH_WRITE);
+                    }
+                },
+                [this, &View](IDeviceContext *pCtx) {
+                    const bool Measured = View.Target == mTestRenderTarget.get();
+                    if (Measured) {
+                        mDynamicResolution->BeginMeasure(pCtx);
+                    }
+                    if (View.Target != nullptr) {
+                        View.Target->Activate(pCtx, *mRenderGraph);
+                        DrawView(View, mRenderGraph->GetTextureView(View.Target->GetColor(), TEXTURE_VIEW_RENDER_TARGET),
+                                 mRenderGraph->GetTextureView(View.Target->GetDepth(), TEXTURE_VIEW_DEPTH_STENCIL),
+                                 View.Target->GetViewport());
+                    } else {
+                        PrepareRender();
+                        const auto &SCDesc = m_pSwapChain->GetDesc();
+                        Viewport VP;
+                        VP.Width = static_cast<float>(SCDesc.Width);
+                        VP.Height = static_cast<float>(SCDesc.Height);
+                        DrawView(View, m_pSwapChain->GetCurrentBackBufferRTV(), m_pSwapChain->GetDepthBufferDSV(), VP);
+                    }
+                    if (Measured) {
+                        mDynamicResolution->EndMeasure(pCtx);
+                    }
+                });
+        });
+
+        if (mReadback) {
+            // Keeps the viewport pass alive in headless mode, copies only when a capture was asked for
+            mRenderGraph->AddPass(
+                "Readback",
+                [&](RenderGraphBuilder &Builder) {
+                    Builder.Read(mTestRenderTarget->GetColor(), RESOURCE_STATE_COPY_SOURCE);
+                    Builder.SetSideEffects();
+                },
+                [this](IDeviceContext *pCtx) {
+                    if (mCaptureRequested) {
+                        const auto VP = mTestRenderTarget->GetViewport();
+                        mReadback->Copy(pCtx, mRenderGraph->GetTexture(mTestRenderTarget->GetColor()),
+                                        static_cast<Uint32>(VP.Width), static_cast<Uint32>(VP.Height));
+                        mCaptureRequested = false;
+                    }
+                });
+        }
 
-        PrepareRender();
-        mCube2->DrawCube(mCamera.GetProjView());
+        if (m_pImGui) {
+            // The UI is built inside its pass so it can show this frame's offscreen targets
+            mRenderGraph->AddPass(
+                "ImGui",
+                [&](RenderGraphBuilder &Builder) {
+                    if (mEditorView->Enabled) {
+                        Builder.Read(mTestRenderTarget->GetColor(), RESOURCE_STATE_SHADER_RESOURCE);
+                    }
+                    Builder.Write(BackBuffer, RESOURCE_STATE_RENDER_TARGET);
+                    Builder.Write(DepthBuffer, RESOURCE_STATE_DEPTH_WRITE);
+                    // Platform windows are drawn into swap chains the graph does not know about
+                    Builder.SetSideEffects();
+                },
+                [this](IDeviceContext *) { DrawImGui(); });
+        }
 
-        DrawImGui();
+        mRenderGraph->Compile();
+        mRenderGraph->Execute(m_pImmediateContext);
+        mGpuProfiler->EndFrame();
 
         Present();
     }
 
+    void Application::RequestCapture() {
+        mCaptureRequested = mReadback != nullptr;
+    }
+
+    bool Application::ReadCapture(Image &OutImage) {
+        std::vector<Uint8> Data;
+        if (!mReadback || !mReadback->Read(m_pImmediateContext, Data)) {
+            return false;
+        }
+
+        OutImage.Width = mReadback->GetWidth();
+        OutImage.Height = mReadback->GetHeight();
+        OutImage.Pixels = std::move(Data);
+        const auto Format = mReadback->GetFormat();
+        if (Format == TEX_FORMAT_BGRA8_UNORM || Format == TEX_FORMAT_BGRA8_UNORM_SRGB) {
+            for (size_t i = 0; i < OutImage.Pixels.size(); i += 4) {
+                std::swap(OutImage.Pixels[i], OutImage.Pixels[i + 2]);
+            }
+        }
+        return true;
+    }
+
+    TEXTURE_FORMAT Application::GetColorBufferFormat() const {
+        return m_pSwapChain ? m_pSwapChain->GetDesc().ColorBufferFormat : RenderTarget::RenderTargetFormat;
+    }
+
+    TEXTURE_FORMAT Application::GetDepthBufferFormat() const {
+        return m_pSwapChain ? m_pSwapChain->GetDesc().DepthBufferFormat : RenderTarget::DepthBufferFormat;
+    }
+
+    void Application::DrawView(RenderView &View, ITextureView *pRTV, ITextureView *pDSV, const Viewport &VP) {
+        const auto &ProjView = View.ViewCamera.GetProjView();
+
+        if (View.IsVisible(mCubeBounds)) {
+            mCube->Submit(*mInstancedRenderer);
+        }
+        if (View.IsVisible(mCube2Bounds)) {
+            mCube2->Submit(*mInstancedRenderer);
+        }
+        mCubeField->Submit(View, *mInstancedRenderer);
+
+        mInstancedRenderer->Flush(m_pImmediateContext, ProjView, pRTV, pDSV, VP);
+    }
+
     void Application::PrepareRender() {
         // Set render targets before issuing any draw command.
         // Note that Present() unbinds the back buffer if it is set as render target.
         auto *pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
         auto *pDSV = m_pSwapChain->GetDepthBufferDSV();
-        m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        // The render graph has already transitioned both buffers
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
         // Clear the back buffer
         const float ClearColor[] = {0.350f, 0.350f, 0.350f, 1.0f};
-        // Let the engine perform required state transitions
-        m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
         m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0,
-                                               RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+                                               RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
+#if PLATFORM_WIN32
     LRESULT Application::HandleWin32Message(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
 
         if (m_pImGui) {
@@ -257,11 +553,14 @@ namespace bt {
 
         return 0l;
     }
+#endif
 
     void Application::Update(double CurrTime, double ElapsedTime) {
-        mCamera.LookAt(Vector(0.f, 2.0f, -5.0f), Vector(0.f, 0.f, 0.f), Vector(0.0f, 1.f, 0.f));
         mCube->Update(CurrTime, ElapsedTime);
         mCube2->Update(CurrTime, ElapsedTime);
+
+        mScene.SetBounds(mCubeBounds, mCube->GetLocation(), TestCube::GetBoundsExtent());
+        mScene.SetBounds(mCube2Bounds, mCube2->GetLocation(), TestCube::GetBoundsExtent());
     }
 
     void Application::DrawImGui() {
@@ -276,7 +575,7 @@ namespace bt {
         ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
         ImGui::Begin("Test");
         auto Size = ImGui::GetContentRegionAvail();
-        mCamera.SetViewPortSize(Size.x, Size.y);
+        mEditorView->ViewCamera.SetViewPortSize(Size.x, Size.y);
         mTestRenderTarget->SetSize(Size.x, Size.y);
         ImGui::PopStyleVar();
 
@@ -286,10 +585,72 @@ namespace bt {
             }
         }
 
-        ImGui::Image(gTheApp->mTestRenderTarget->GetTexture(), Size);
+        if (mEditorView->Enabled) {
+            // Only the viewport part of the oversized target holds the image
+            const auto UVScale = mTestRenderTarget->GetUVScale();
+            ImGui::Image(mRenderGraph->GetTextureView(mTestRenderTarget->GetColor(), TEXTURE_VIEW_SHADER_RESOURCE),
+                         Size, ImVec2(0.f, 0.f), ImVec2(UVScale.x, UVScale.y));
+        }
         ImGui::End();
 
 
+        ImGui::Begin("Stats");
+        ImGui::Text("Draw calls: %u", mInstancedRenderer->GetNumDrawCalls());
+        ImGui::Text("Instances: %u (waiting for pipelines: %u)", mInstancedRenderer->GetNumInstances(),
+                    mInstancedRenderer->GetNumSkippedInstances());
+        ImGui::Text("Recording contexts: %zu, parallel flushes: %u", m_pDeferredContexts.size(),
+                    mInstancedRenderer->GetNumParallelFlushes());
+        ImGui::Text("Render graph: %u passes (%u culled), %u transient textures in %u, %u barriers",
+                    mRenderGraph->GetNumPasses(), mRenderGraph->GetNumCulledPasses(),
+                    mRenderGraph->GetNumTransientTextures(), mRenderGraph->GetNumPooledTextures(),
+                    mRenderGraph->GetNumBarriers());
+        ImGui::Text("Frames in flight: %u, GPU waits: %u, pending releases: %u", mFrameSync->GetNumFramesInFlight(),
+                    mFrameSync->GetNumWaits(), mFrameSync->GetNumPendingReleases());
+        const auto ViewportVP = mTestRenderTarget->GetViewport();
+        ImGui::Text("Viewport target: %ux%u, rendered at %.0fx%.0f, reallocations: %u", mTestRenderTarget->GetWidth(),
+                    mTestRenderTarget->GetHeight(), ViewportVP.Width, ViewportVP.Height,
+                    mTestRenderTarget->GetNumReallocations());
+        if (mDynamicResolution->IsTimingSupported()) {
+            auto &DRS = mDynamicResolution->GetSettings();
+            ImGui::Checkbox("Dynamic resolution", &DRS.Enabled);
+            ImGui::Text("Scene pass: %.2f ms, scale %.2f", mDynamicResolution->GetGPUTimeMs(),
+                        mDynamicResolution->GetScale());
+            ImGui::SliderFloat("Target ms", &DRS.TargetTimeMs, 1.f, 33.f);
+            ImGui::SliderFloat("Min scale", &DRS.MinScale, 0.25f, 1.f);
+            ImGui::SliderFloat("Max scale", &DRS.MaxScale, 0.25f, 1.f);
+        } else {
+            ImGui::Text("Dynamic resolution: no GPU timing on this device");
+        }
+        ImGui::Text("Upload ring: %llu / %llu KB%s", mUploadRing->GetUsedSize() >> 10, mUploadRing->GetFrameSize() >> 10,
+                    mUploadRing->IsPersistent() ? " (persistent)" : "");
+        ImGui::Text("Field cubes: %u", mCubeField->GetNumCubes());
+        ImGui::Text("Pipelines: %u, shaders: %u (compiled %u, from disk %u)", mPipelineCache->GetNumPipelines(),
+                    mPipelineCache->GetNumShaders(), mPipelineCache->GetNumCompiledShaders(),
+                    mPipelineCache->GetNumLoadedShaders());
+        const auto NumRequested = mPipelineCache->GetNumRequestedPipelines();
+        const auto NumFinished = mPipelineCache->GetNumFinishedPipelines();
+        if (NumFinished < NumRequested) {
+            const auto Progress = static_cast<float>(NumFinished) / static_cast<float>(NumRequested);
+            ImGui::ProgressBar(Progress, ImVec2(-1.f, 0.f),
+                               fmt::format("Compiling pipelines {}/{}", NumFinished, NumRequested).c_str());
+        }
+        if (ImGui::Button("Add 10000 cubes")) {
+            mCubeField->AddCubes(10000);
+        }
+        ImGui::End();
+
+        ImGui::Begin("GPU profiler");
+        bool Capturing = mGpuProfiler->IsCapturing();
+        if (ImGui::Checkbox(fmt::format("Write {}", GpuProfileCSV).c_str(), &Capturing)) {
+            if (Capturing) {
+                mGpuProfiler->StartCapture(GpuProfileCSV);
+            } else {
+                mGpuProfiler->StopCapture();
+            }
+        }
+        mGpuProfiler->DrawImGui();
+        ImGui::End();
+
         ImGui::SetNextWindowSize(ImVec2(500, 400), ImGuiCond_FirstUseEver);
         bool p_open = true;
         ImGui::Begin("Log", &p_open);
@@ -303,14 +664,42 @@ namespace bt {
     }
 
     void Application::Present() {
-        m_pSwapChain->Present();
+        mUploadRing->EndFrame();
+        // Signalled before Present() so the fence goes out with this frame's commands
+        mFrameSync->EndFrame();
+        if (m_pSwapChain) {
+            m_pSwapChain->Present();
+        } else {
+            // Present() submits the frame and finishes it on the immediate context otherwise
+            m_pImmediateContext->Flush();
+            m_pImmediateContext->FinishFrame();
+        }
+
+        // Releases what the deferred contexts allocated for this frame's command lists
+        for (auto &pContext: m_pDeferredContexts) {
+            pContext->FinishFrame();
+        }
     }
 
     void Application::WindowResize(Uint32 Width, Uint32 Height) {
-
+        if (mGameView != nullptr) {
+            mGameView->ViewCamera.SetViewPortSize(Width, Height);
+        }
     }
 }
 
 void EditorLog::Append(bt::log::LogLevel level, const string &msg) {
-    AddLog("%s\n", msg.c_str());
+    std::lock_guard<std::mutex> Lock(PendingMutex);
+    PendingLines.push_back(msg);
+}
+
+void EditorLog::AddPendingLines() {
+    std::vector<std::string> Lines;
+    {
+        std::lock_guard<std::mutex> Lock(PendingMutex);
+        Lines.swap(PendingLines);
+    }
+    for (const auto &Line: Lines) {
+        AddLog("%s\n", Line.c_str());
+    }
 }
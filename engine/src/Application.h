@@ -1,43 +1,56 @@
 ﻿#pragma once
 
-#ifndef NOMINMAX
-#    define NOMINMAX
-#endif
-
-#include <Windows.h>
-
-#ifndef PLATFORM_WIN32
-#    define PLATFORM_WIN32 1
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+
+#    include <Windows.h>
+
+#    ifndef PLATFORM_WIN32
+#        define PLATFORM_WIN32 1
+#    endif
+
+#    ifndef D3D11_SUPPORTED
+#        define D3D11_SUPPORTED 1
+#    endif
+
+#    ifndef D3D12_SUPPORTED
+#        define D3D12_SUPPORTED 1
+#    endif
+
+#    ifndef GL_SUPPORTED
+#        define GL_SUPPORTED 1
+#    endif
+#elif !defined(PLATFORM_LINUX)
+#    define PLATFORM_LINUX 1
 #endif
 
 #ifndef ENGINE_DLL
 #    define ENGINE_DLL 1
 #endif
 
-#ifndef D3D11_SUPPORTED
-#    define D3D11_SUPPORTED 1
+#ifndef VULKAN_SUPPORTED
+#    define VULKAN_SUPPORTED 1
 #endif
 
-#ifndef D3D12_SUPPORTED
-#    define D3D12_SUPPORTED 1
+#if D3D11_SUPPORTED
+#    include "Graphics/GraphicsEngineD3D11/interface/EngineFactoryD3D11.h"
 #endif
-
-#ifndef GL_SUPPORTED
-#    define GL_SUPPORTED 1
+#if D3D12_SUPPORTED
+#    include "Graphics/GraphicsEngineD3D12/interface/EngineFactoryD3D12.h"
 #endif
-
-#ifndef VULKAN_SUPPORTED
-#    define VULKAN_SUPPORTED 1
+#if GL_SUPPORTED
+#    include "Graphics/GraphicsEngineOpenGL/interface/EngineFactoryOpenGL.h"
+#endif
+#if VULKAN_SUPPORTED
+#    include "Graphics/GraphicsEngineVulkan/interface/EngineFactoryVk.h"
 #endif
-
-#include "Graphics/GraphicsEngineD3D11/interface/EngineFactoryD3D11.h"
-#include "Graphics/GraphicsEngineD3D12/interface/EngineFactoryD3D12.h"
-#include "Graphics/GraphicsEngineOpenGL/interface/EngineFactoryOpenGL.h"
-#include "Graphics/GraphicsEngineVulkan/interface/EngineFactoryVk.h"
 
 #include "RenderDevice.h"
 #include "DeviceContext.h"
 #include "SwapChain.h"
+#include "NativeWindow.h"
 
 #include "Common/interface/RefCntAutoPtr.hpp"
 #include "ImGuiImpl.hpp"
@@ -45,8 +58,11 @@
 #include "Engine.h"
 #include "core/Math.h"
 #include "Camera.h"
+#include "Scene.h"
+#include "render/RenderViews.h"
 #include "input/InputManager.h"
 #include "editor/RenderTarget.h"
+#include "render/ImageCompare.h"
 #include "core/Logging.h"
 #include "imgui.h"
 
@@ -59,6 +75,9 @@ public:
     ImGuiTextFilter     Filter;
     ImVector<int>       LineOffsets; // Index to lines offset. We maintain this with AddLog() calls.
     bool                AutoScroll;  // Keep scrolling if already at the bottom.
+    // Lines from Append(), which pipeline compile workers call too. Draw() moves them into Buf.
+    std::mutex               PendingMutex;
+    std::vector<std::string> PendingLines;
 
     explicit EditorLog()
     {
@@ -68,6 +87,8 @@ public:
 
     void Append(bt::log::LogLevel level, const string &msg) override;
 
+    void AddPendingLines();
+
     void Clear()
     {
         Buf.clear();
@@ -89,6 +110,8 @@ public:
 
     void    Draw(const char* title, bool* p_open = NULL)
     {
+        AddPendingLines();
+
         if (!ImGui::Begin(title, p_open))
         {
             ImGui::End();
@@ -180,6 +203,18 @@ namespace bt {
     extern std::unique_ptr<class Application> gTheApp;
 
     class TestCube;
+    class CubeField;
+    struct Mesh;
+    class InstancedRenderer;
+    class UploadRing;
+    class RenderGraph;
+    class FrameSync;
+    class DynamicResolution;
+    class GpuProfiler;
+    class TextureReadback;
+    class Platform;
+    class PipelineCache;
+    class ThreadPool;
 
     class Application {
     public:
@@ -191,13 +226,27 @@ namespace bt {
 
         IDeviceContext *GetImmediateContext() { return m_pImmediateContext.RawPtr(); }
 
-        bool CreateSwapChain(RefCntAutoPtr<ISwapChain> &result, HWND hWnd, bool isAdditional);
+        InstancedRenderer *GetInstancedRenderer() { return mInstancedRenderer.get(); }
+
+        // Per-frame vertex, index and instance data
+        UploadRing *GetUploadRing() { return mUploadRing.get(); }
+
+        PipelineCache *GetPipelineCache() { return mPipelineCache.get(); }
+
+        ThreadPool *GetThreadPool() { return mThreadPool.get(); }
+
+        bool CreateSwapChain(RefCntAutoPtr<ISwapChain> &result, const NativeWindow &Window, bool isAdditional);
 
         Application();
 
         virtual ~Application();
 
-        bool Init(HWND hWnd);
+        // Renders into the platform's main window
+        bool Init(Platform &Plat);
+
+        // Vulkan device without a window or swap chain. Only the viewport target is rendered, at
+        // Width x Height, and can be read back with RequestCapture()/ReadCapture().
+        bool InitHeadless(Uint32 Width, Uint32 Height, bool PreferSoftwareAdapter);
 
         void Shutdown();
 
@@ -205,9 +254,26 @@ namespace bt {
 
         void WindowResize(Uint32 Width, Uint32 Height);
 
+        // The viewport image of the next rendered frame is copied for ReadCapture(), headless mode only
+        void RequestCapture();
+
+        // Waits for the GPU
+        bool ReadCapture(Image &OutImage);
+
+        // Formats scene pipelines render to
+        TEXTURE_FORMAT GetColorBufferFormat() const;
+        TEXTURE_FORMAT GetDepthBufferFormat() const;
+
+        GpuProfiler *GetGpuProfiler() { return mGpuProfiler.get(); }
+
+#if PLATFORM_WIN32
         virtual LRESULT HandleWin32Message(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+#endif
 
     private:
+        // Everything that does not depend on the window, shared by both init paths
+        void CreateRenderer();
+
         void Update(double CurrTime, double ElapsedTime);
 
         void PrepareRender();
@@ -218,26 +284,53 @@ namespace bt {
 
         void DrawImGui();
 
+        void DrawView(RenderView &View, ITextureView *pRTV, ITextureView *pDSV, const Viewport &VP);
+
+        void AttachContexts(const std::vector<IDeviceContext *> &ppContexts);
+
     private:
 
         RefCntAutoPtr<IEngineFactory> m_pEngineFactory;
         RefCntAutoPtr<IRenderDevice> m_pDevice;
         RefCntAutoPtr<IDeviceContext> m_pImmediateContext;
-        //std::vector<RefCntAutoPtr<IDeviceContext>> m_pDeviceContexts;
+        // Deferred contexts for parallel command recording, empty on backends without them
+        std::vector<RefCntAutoPtr<IDeviceContext>> m_pDeferredContexts;
         RefCntAutoPtr<ISwapChain> m_pSwapChain;
         RENDER_DEVICE_TYPE m_DeviceType = Diligent::RENDER_DEVICE_TYPE_VULKAN;
 
         std::unique_ptr<ImGuiImpl> m_pImGui;
 
-        Camera mCamera;
+        std::unique_ptr<ThreadPool> mThreadPool;
+        std::unique_ptr<ThreadPool> mRecordingThreads;
+        std::unique_ptr<PipelineCache> mPipelineCache;
+        std::unique_ptr<FrameSync> mFrameSync;
+        std::unique_ptr<UploadRing> mUploadRing;
+        std::unique_ptr<RenderGraph> mRenderGraph;
+        std::unique_ptr<DynamicResolution> mDynamicResolution;
+        std::unique_ptr<GpuProfiler> mGpuProfiler;
+        std::unique_ptr<InstancedRenderer> mInstancedRenderer;
+        std::unique_ptr<TextureReadback> mReadback;
+        bool mCaptureRequested = false;
+
+        RenderViewRegistry mViews;
+        RenderView *mEditorView = nullptr;
+        RenderView *mGameView = nullptr;
+
+        Scene mScene;
+        Uint32 mCubeBounds = 0;
+        Uint32 mCube2Bounds = 0;
 
         EditorLog* m_log;
 
     public:
         std::unique_ptr<RenderTarget> mTestRenderTarget;
 
+        // Geometry shared by the test cubes and the cube field
+        std::shared_ptr<Mesh> mCubeMesh;
         std::unique_ptr<TestCube> mCube;
         std::unique_ptr<TestCube> mCube2;
+
+        std::unique_ptr<CubeField> mCubeField;
     };
 
 }
@@ -5,3 +5,78 @@
 #include "Camera.h"
 
 using namespace bt;
+
+void Camera::LookAt(const Vector &Position, const Vector &Target, const Vector &Up) {
+    const Vector Direction = Target - Position;
+    if (Position == mPosition && Direction == mDirection && Up == mUp) {
+        return;
+    }
+
+    mPosition = Position;
+    mDirection = Direction;
+    mUp = Up;
+    mViewDirty = true;
+}
+
+void Camera::SetPerspective(float Fov, float ZNear, float ZFar) {
+    if (!mOrthographic && Fov == mFov && ZNear == mZNear && ZFar == mZFar) {
+        return;
+    }
+
+    mOrthographic = false;
+    mFov = Fov;
+    mZNear = ZNear;
+    mZFar = ZFar;
+    mProjDirty = true;
+}
+
+void Camera::SetOrthographic(float Height, float ZNear, float ZFar) {
+    if (mOrthographic && Height == mOrthoHeight && ZNear == mZNear && ZFar == mZFar) {
+        return;
+    }
+
+    mOrthographic = true;
+    mOrthoHeight = Height;
+    mZNear = ZNear;
+    mZFar = ZFar;
+    mProjDirty = true;
+}
+
+void Camera::SetViewPortSize(Uint32 Width, Uint32 Height) {
+    if (Width == 0 || Height == 0) {
+        return;
+    }
+
+    const auto AspectRatio = static_cast<Float32>(Width) / static_cast<Float32>(Height);
+    if (AspectRatio == mAspectRatio) {
+        return;
+    }
+
+    mAspectRatio = AspectRatio;
+    mProjDirty = true;
+}
+
+void Camera::Rebuild() {
+    if (mViewDirty) {
+        mView = glm::lookAt(mPosition, mPosition + mDirection, mUp);
+    }
+
+    if (mProjDirty) {
+        if (mOrthographic) {
+            const double HalfH = mOrthoHeight * 0.5;
+            const double HalfW = HalfH * mAspectRatio;
+            mProj = glm::ortho(-HalfW, HalfW, -HalfH, HalfH, static_cast<double>(mZNear), static_cast<double>(mZFar));
+        } else {
+            mProj = glm::perspective(glm::radians(static_cast<double>(mFov)), static_cast<double>(mAspectRatio),
+                                     static_cast<double>(mZNear), static_cast<double>(mZFar));
+        }
+    }
+
+    mProjView = mProj * mView;
+    mInvProjView = glm::inverse(mProjView);
+    mFrustum = ExtractFrustum(mProjView);
+
+    mViewDirty = false;
+    mProjDirty = false;
+    ++mVersion;
+}
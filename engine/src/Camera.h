@@ -2,40 +2,72 @@
 
 #include "core/Math.h"
 #include "BasicTypes.h"
+#include "render/FrustumCulling.h"
 
 using namespace Diligent;
 
 namespace bt {
 
+    // Matrices and frustum planes are cached and only rebuilt when one of the inputs actually changes,
+    // so the getters can be called any number of times per frame.
     class Camera {
         Vector mPosition;
         Vector mDirection;
         Vector mUp;
 
+        bool mOrthographic;
         float mFov;
+        float mOrthoHeight;
         float mAspectRatio;
         float mZNear;
         float mZFar;
         Matrix mView;
         Matrix mProj;
         Matrix mProjView;
+        Matrix mInvProjView;
+        Frustum mFrustum;
+
+        bool mViewDirty;
+        bool mProjDirty;
+        Uint64 mVersion;
     public:
         Camera() : mPosition(Vector(0.f)),
                    mDirection(Vector(0.f, 0.f, 1.f)),
                    mUp(Vector(0.f, 1.f, 0.f)),
+                   mOrthographic(false),
                    mFov(70.f),
+                   mOrthoHeight(10.f),
                    mAspectRatio(1.f),
                    mZNear(0.1f),
                    mZFar(1000.0f),
                    mView(Matrix(1.f)),
                    mProj(Matrix(1.f)),
-                   mProjView(Matrix(1.f))
+                   mProjView(Matrix(1.f)),
+                   mInvProjView(Matrix(1.f)),
+                   mViewDirty(true),
+                   mProjDirty(true),
+                   mVersion(0)
                    {}
 
-        void LookAt(const Vector &Position, const Vector &Target, const Vector &Up) {
-            mPosition = Position;
-            mDirection = Target - Position;
-            mUp = Up;
+        void LookAt(const Vector &Position, const Vector &Target, const Vector &Up);
+
+        void SetPerspective(float Fov, float ZNear, float ZFar);
+
+        // Height of the view volume in world units, used for shadow views
+        void SetOrthographic(float Height, float ZNear, float ZFar);
+
+        void SetViewPortSize(Uint32 Width, Uint32 Height);
+
+        [[nodiscard]] const Vector &GetPosition() const { return mPosition; }
+
+        [[nodiscard]] const Matrix &GetView() {
+            Update();
+            return mView;
+        }
+
+        [[nodiscard]] const Matrix &GetProj() {
+            Update();
+            return mProj;
         }
 
         [[nodiscard]] const Matrix & GetProjView() {
@@ -43,16 +75,31 @@ namespace bt {
             return mProjView;
         }
 
-        void SetViewPortSize(Uint32 Width, Uint32 Height) {
-            mAspectRatio = static_cast<Float32>(Width) / static_cast<Float32>(Height);
+        [[nodiscard]] const Matrix &GetInvProjView() {
+            Update();
+            return mInvProjView;
+        }
+
+        [[nodiscard]] const Frustum &GetFrustum() {
+            Update();
+            return mFrustum;
+        }
+
+        // Incremented every time the cached matrices are rebuilt, lets other systems
+        // cache data derived from this camera and detect when it became stale
+        [[nodiscard]] Uint64 GetVersion() {
+            Update();
+            return mVersion;
         }
 
     private:
         void Update() {
-            mView = glm::lookAt(mPosition, mPosition + mDirection, mUp);
-            mProj = glm::perspective(glm::radians(mFov), mAspectRatio, mZNear, mZFar);
-            mProjView = mProj * mView;
+            if (mViewDirty || mProjDirty) {
+                Rebuild();
+            }
         }
+
+        void Rebuild();
     };
 
 }
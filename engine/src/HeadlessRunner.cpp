@@ -0,0 +1,186 @@
+#include "HeadlessRunner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Application.h"
+#include "core/Logging.h"
+#include "render/GpuProfiler.h"
+#include "render/ImageCompare.h"
+#include "render/PipelineCache.h"
+#include "render/SDFBenchmark.h"
+#include "platform/Platform.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+namespace {
+
+// Simulation time per frame, fixed so every run renders the same images
+constexpr double FixedTimeStep = 1.0 / 60.0;
+
+}
+
+bool ParseHeadlessOptions(int argc, char **argv, HeadlessOptions &Options) {
+    bool Headless = false;
+    for (int i = 1; i < argc; ++i) {
+        const char *Arg = argv[i];
+        const char *Value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(Arg, "--headless") == 0) {
+            Headless = true;
+        } else if (std::strcmp(Arg, "--check-sdf") == 0) {
+            Headless = true;
+            Options.CheckSDFRegions = true;
+        } else if (std::strcmp(Arg, "--software") == 0) {
+            Options.PreferSoftwareAdapter = true;
+        } else if (std::strcmp(Arg, "--update-golden") == 0) {
+            Options.UpdateGolden = true;
+        } else if (Value == nullptr) {
+            continue;
+        } else if (std::strcmp(Arg, "--bench") == 0) {
+            Headless = true;
+            Options.Benchmark = Value;
+            ++i;
+        } else if (std::strcmp(Arg, "--size") == 0) {
+            std::sscanf(Value, "%ux%u", &Options.Width, &Options.Height);
+            ++i;
+        } else if (std::strcmp(Arg, "--frames") == 0) {
+            Options.NumFrames = static_cast<Uint32>(std::strtoul(Value, nullptr, 10));
+            ++i;
+        } else if (std::strcmp(Arg, "--out") == 0) {
+            Options.OutputDir = Value;
+            ++i;
+        } else if (std::strcmp(Arg, "--golden") == 0) {
+            Options.GoldenPath = Value;
+            ++i;
+        } else if (std::strcmp(Arg, "--tolerance") == 0) {
+            Options.Tolerance = static_cast<Uint32>(std::strtoul(Value, nullptr, 10));
+            ++i;
+        } else if (std::strcmp(Arg, "--max-diff") == 0) {
+            Options.MaxDifferingFraction = std::strtod(Value, nullptr);
+            ++i;
+        }
+    }
+
+    Options.Width = std::max(Options.Width, 1u);
+    Options.Height = std::max(Options.Height, 1u);
+    Options.NumFrames = std::max(Options.NumFrames, 1u);
+    return Headless;
+}
+
+int RunHeadless(const HeadlessOptions &Options) {
+    gTheApp = std::make_unique<Application>();
+    if (!gTheApp->InitHeadless(Options.Width, Options.Height, Options.PreferSoftwareAdapter)) {
+        gTheApp.reset();
+        return 2;
+    }
+
+    if (!Options.Benchmark.empty() || Options.CheckSDFRegions) {
+        auto *pDevice = gTheApp->GetRenderDevice();
+        auto *pCtx = gTheApp->GetImmediateContext();
+        auto &Cache = *gTheApp->GetPipelineCache();
+        int Result = 2;
+        if (Options.CheckSDFRegions) {
+            Result = RunSDFRegionCheck(pDevice, pCtx, Cache);
+        } else if (Options.Benchmark == "sdf") {
+            Result = RunSDFBenchmark(pDevice, pCtx, Cache, Options.OutputDir);
+        } else if (Options.Benchmark == "lighting") {
+            Result = RunLightingBenchmark(pDevice, pCtx, Cache, Options.Width, Options.Height, Options.OutputDir);
+        } else if (Options.Benchmark == "world") {
+            Result = RunSDFWorldBenchmark(pDevice, pCtx, Cache, Options.Width, Options.Height, Options.OutputDir);
+        } else {
+            log::Error(fmt::format("Unknown benchmark '{}'", Options.Benchmark));
+        }
+        gTheApp->Shutdown();
+        gTheApp.reset();
+        return Result;
+    }
+
+    // Frames rendered while pipelines are missing would not match the golden image
+    auto *pPipelineCache = gTheApp->GetPipelineCache();
+    Uint32 NumWarmupFrames = 0;
+    while (pPipelineCache->GetNumFinishedPipelines() < pPipelineCache->GetNumRequestedPipelines() &&
+           NumWarmupFrames < Options.MaxWarmupFrames) {
+        gTheApp->Tick(0.0, 0.0);
+        ++NumWarmupFrames;
+    }
+    if (pPipelineCache->GetNumFinishedPipelines() < pPipelineCache->GetNumRequestedPipelines()) {
+        log::Error(fmt::format("Pipelines still compiling after {} frames", NumWarmupFrames));
+        gTheApp->Shutdown();
+        gTheApp.reset();
+        return 2;
+    }
+
+    std::error_code Error;
+    std::filesystem::create_directories(Options.OutputDir, Error);
+    const std::filesystem::path OutputDir(Options.OutputDir);
+
+    auto *pProfiler = gTheApp->GetGpuProfiler();
+    pProfiler->StartCapture((OutputDir / "gpu_times.csv").string());
+    std::ofstream CpuTimes(OutputDir / "cpu_times.csv", std::ios::trunc);
+    CpuTimes << "frame,cpu_ms\n";
+
+    // Frame numbers continue the profiler's, which counted the warm-up frames too
+    auto Plat = CreatePlatform(PlatformType::Null);
+    for (Uint32 i = 0; i < Options.NumFrames && Plat->PumpEvents(); ++i) {
+        if (i + 1 == Options.NumFrames) {
+            gTheApp->RequestCapture();
+        }
+        const auto StartTime = Plat->GetTime();
+        gTheApp->Tick(i * FixedTimeStep, FixedTimeStep);
+        const auto FrameMs = (Plat->GetTime() - StartTime) * 1000.0;
+        CpuTimes << NumWarmupFrames + i << ',' << FrameMs << '\n';
+    }
+
+    Image Result;
+    const bool Captured = gTheApp->ReadCapture(Result);
+    // The GPU is idle after the capture, collect the last frames' timings
+    pProfiler->EndFrame();
+    pProfiler->StopCapture();
+    gTheApp->Shutdown();
+    gTheApp.reset();
+
+    if (!Captured) {
+        log::Error("Failed to read back the last frame");
+        return 2;
+    }
+    SaveImagePPM((OutputDir / "frame.ppm").string(), Result);
+
+    if (Options.GoldenPath.empty()) {
+        return 0;
+    }
+    if (Options.UpdateGolden) {
+        log::Info(fmt::format("Updating golden image {}", Options.GoldenPath));
+        return SaveImagePPM(Options.GoldenPath, Result) ? 0 : 2;
+    }
+
+    Image Golden;
+    if (!LoadImagePPM(Options.GoldenPath, Golden)) {
+        return 1;
+    }
+
+    const auto Diff = CompareImages(Result, Golden, Options.Tolerance);
+    if (Diff.SizeMismatch) {
+        log::Error(fmt::format("Frame is {}x{}, golden image {}x{}", Result.Width, Result.Height, Golden.Width,
+                               Golden.Height));
+        return 1;
+    }
+
+    const auto NumPixels = static_cast<double>(Result.Width) * Result.Height;
+    const bool Passed = static_cast<double>(Diff.NumDifferingPixels) <= NumPixels * Options.MaxDifferingFraction;
+    const auto Summary = fmt::format("{} pixels differ by more than {} (max {}, rms {:.3f}) from {}",
+                                     Diff.NumDifferingPixels, Options.Tolerance, Diff.MaxDifference,
+                                     Diff.RootMeanSquare, Options.GoldenPath);
+    if (Passed) {
+        log::Info(Summary);
+    } else {
+        log::Error(Summary);
+    }
+    return Passed ? 0 : 1;
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+#include "BasicTypes.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+struct HeadlessOptions {
+    Uint32 Width = 640;
+    Uint32 Height = 480;
+    // Measured frames, the last one is captured
+    Uint32 NumFrames = 120;
+    // Upper bound on the frames rendered while pipelines compile before measuring starts
+    Uint32 MaxWarmupFrames = 2000;
+    bool PreferSoftwareAdapter = false;
+    // Receives frame.ppm, cpu_times.csv and gpu_times.csv
+    std::string OutputDir = ".";
+    // Captured frame is compared against this image when set
+    std::string GoldenPath;
+    // Writes the captured frame as the new golden image instead of comparing
+    bool UpdateGolden = false;
+    // Per-channel difference a pixel may have without counting as different
+    Uint32 Tolerance = 8;
+    // Fraction of pixels allowed to exceed the tolerance
+    double MaxDifferingFraction = 0.001;
+    // Runs a benchmark instead of rendering frames: "sdf" for SDF generation, "lighting" for the
+    // SDF map lighting resolutions at Width x Height, "world" for SDFWorld streaming
+    std::string Benchmark;
+    // Checks that SDF region updates match full updates instead of rendering frames
+    bool CheckSDFRegions = false;
+};
+
+// True when the arguments contain --headless, --bench NAME or --check-sdf, the other options are read into Options:
+//   --size WxH  --frames N  --software  --out DIR  --golden FILE  --update-golden
+//   --tolerance N  --max-diff FRACTION
+bool ParseHeadlessOptions(int argc, char **argv, HeadlessOptions &Options);
+
+// Renders the viewport with a fixed time step, writes per-frame CPU and GPU times and the last
+// frame, and compares it against the golden image. Returns the process exit code: 0 on success,
+// 1 when the image does not match, 2 when rendering could not run.
+int RunHeadless(const HeadlessOptions &Options);
+
+}
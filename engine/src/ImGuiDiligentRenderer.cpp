@@ -6,7 +6,9 @@
 #include "DeviceContext.h"
 #include "MapHelper.hpp"
 
-#include "Core/Logging.h"
+#include "core/Logging.h"
+#include "render/PipelineCache.h"
+#include "fmt/core.h"
 
 using namespace Diligent;
 
@@ -284,7 +286,7 @@ ImGuiDiligentRenderer::~ImGuiDiligentRenderer() {
 }
 
 void ImGuiDiligentRenderer::NewFrame(SURFACE_TRANSFORM SurfacePreTransform) {
-    if (!m_pPSO) {
+    if (!m_Pipeline) {
         CreateDeviceObjects();
     }
     m_SurfacePreTransform = SurfacePreTransform;
@@ -298,20 +300,18 @@ void ImGuiDiligentRenderer::EndFrame() {
 }
 
 void ImGuiDiligentRenderer::InvalidateDeviceObjects() {
-    m_pVertexConstantBuffer.Release();
-    m_pPSO.Release();
+    m_Pipeline.reset();
+    m_pTextureVar = nullptr;
     m_pFontSRV.Release();
-    m_pSRB.Release();
 }
 
-void ImGuiDiligentRenderer::CreateDeviceObjects() {
-    InvalidateDeviceObjects();
-
+static RefCntAutoPtr<IPipelineState> CreateImGuiPipeline(IRenderDevice *pDevice, TEXTURE_FORMAT BackBufferFmt,
+                                                         TEXTURE_FORMAT DepthBufferFmt, IBuffer *pConstants) {
     ShaderCreateInfo ShaderCI;
     ShaderCI.UseCombinedTextureSamplers = true;
     ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_DEFAULT;
 
-    const auto DeviceType = m_pDevice->GetDeviceInfo().Type;
+    const auto DeviceType = pDevice->GetDeviceInfo().Type;
 
     RefCntAutoPtr<IShader> pVS;
     {
@@ -341,7 +341,7 @@ void ImGuiDiligentRenderer::CreateDeviceObjects() {
             default:
                     UNEXPECTED("Unknown render device type");
         }
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+        pDevice->CreateShader(ShaderCI, &pVS);
     }
 
     RefCntAutoPtr<IShader> pPS;
@@ -372,7 +372,7 @@ void ImGuiDiligentRenderer::CreateDeviceObjects() {
             default:
                     UNEXPECTED("Unknown render device type");
         }
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        pDevice->CreateShader(ShaderCI, &pPS);
     }
 
     GraphicsPipelineStateCreateInfo PSOCreateInfo;
@@ -381,8 +381,8 @@ void ImGuiDiligentRenderer::CreateDeviceObjects() {
     auto &GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
 
     GraphicsPipeline.NumRenderTargets = 1;
-    GraphicsPipeline.RTVFormats[0] = m_BackBufferFmt;
-    GraphicsPipeline.DSVFormat = m_DepthBufferFmt;
+    GraphicsPipeline.RTVFormats[0] = BackBufferFmt;
+    GraphicsPipeline.DSVFormat = DepthBufferFmt;
     GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
     PSOCreateInfo.pVS = pVS;
@@ -429,9 +429,19 @@ void ImGuiDiligentRenderer::CreateDeviceObjects() {
     PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers = ImtblSamplers;
     PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
 
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO);
+    RefCntAutoPtr<IPipelineState> pPSO;
+    pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &pPSO);
+    if (pPSO) {
+        pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(pConstants);
+    }
+    return pPSO;
+}
+
+void ImGuiDiligentRenderer::CreateDeviceObjects() {
+    InvalidateDeviceObjects();
 
-    {
+    // The cached pipeline keeps this buffer bound, so it is created once and survives InvalidateDeviceObjects()
+    if (!m_pVertexConstantBuffer) {
         BufferDesc BuffDesc;
         BuffDesc.Size = sizeof(float4x4);
         BuffDesc.Usage = USAGE_DYNAMIC;
@@ -439,7 +449,16 @@ void ImGuiDiligentRenderer::CreateDeviceObjects() {
         BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
         m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pVertexConstantBuffer);
     }
-    m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_pVertexConstantBuffer);
+
+    RefCntAutoPtr<IRenderDevice> pDevice = m_pDevice;
+    RefCntAutoPtr<IBuffer> pConstants = m_pVertexConstantBuffer;
+    const auto BackBufferFmt = m_BackBufferFmt;
+    const auto DepthBufferFmt = m_DepthBufferFmt;
+    const auto Key =
+        fmt::format("ImGui {} {}", static_cast<Uint32>(BackBufferFmt), static_cast<Uint32>(DepthBufferFmt));
+    m_Pipeline = gTheApp->GetPipelineCache()->RequestPipeline(Key, [=](PipelineCache &) {
+        return CreateImGuiPipeline(pDevice, BackBufferFmt, DepthBufferFmt, pConstants);
+    });
 
     CreateFontsTexture();
 }
@@ -473,11 +492,6 @@ void ImGuiDiligentRenderer::CreateFontsTexture() {
     m_pDevice->CreateTexture(FontTexDesc, &InitData, &pFontTex);
     m_pFontSRV = pFontTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
 
-    m_pSRB.Release();
-    m_pPSO->CreateShaderResourceBinding(&m_pSRB, true);
-    m_pTextureVar = m_pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "Texture");
-    VERIFY_EXPR(m_pTextureVar != nullptr);
-
     // Store our identifier
     IO.Fonts->TexID = (ImTextureID) m_pFontSRV;
 }
@@ -593,11 +607,16 @@ float4 ImGuiDiligentRenderer::TransformClipRect(const ImVec2 &DisplaySize, const
 void ImGuiDiligentRenderer::RenderDrawData(BorschDiligentViewportData *viewportData,
                                            ImDrawData *pDrawData) {
 
-    auto pCtx = gTheApp->GetImmediateContext();
+    // UI is not drawn until its pipeline has been compiled
+    if (!m_Pipeline || !m_Pipeline->IsReady())
+        return;
 
-    ITextureView *pRTV = viewportData->pSwapChain->GetCurrentBackBufferRTV();
-    ITextureView *pDSV = viewportData->pSwapChain->GetDepthBufferDSV();
-    pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    if (m_pTextureVar == nullptr) {
+        m_pTextureVar = m_Pipeline->SRB->GetVariableByName(SHADER_TYPE_PIXEL, "Texture");
+        VERIFY_EXPR(m_pTextureVar != nullptr);
+    }
+
+    auto pCtx = gTheApp->GetImmediateContext();
 
     Int32 ViewportWidth = pDrawData->DisplaySize.x;
     Int32 ViewportHeight = pDrawData->DisplaySize.y;
@@ -606,41 +625,16 @@ void ImGuiDiligentRenderer::RenderDrawData(BorschDiligentViewportData *viewportD
     if (pDrawData->DisplaySize.x <= 0.0f || pDrawData->DisplaySize.y <= 0.0f)
         return;
 
-    // Create and grow vertex/index buffers if needed
-    if (!viewportData->m_pVB || static_cast<int>(viewportData->m_VertexBufferSize) < pDrawData->TotalVtxCount) {
-        viewportData->m_pVB.Release();
-        while (static_cast<int>(viewportData->m_VertexBufferSize) < pDrawData->TotalVtxCount)
-            viewportData->m_VertexBufferSize *= 2;
-
-        BufferDesc VBDesc;
-        VBDesc.Name = "Imgui vertex buffer";
-        VBDesc.BindFlags = BIND_VERTEX_BUFFER;
-        VBDesc.Size = viewportData->m_VertexBufferSize * sizeof(ImDrawVert);
-        VBDesc.Usage = USAGE_DYNAMIC;
-        VBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        m_pDevice->CreateBuffer(VBDesc, nullptr, &viewportData->m_pVB);
-    }
-
-    if (!viewportData->m_pIB || static_cast<int>(viewportData->m_IndexBufferSize) < pDrawData->TotalIdxCount) {
-        viewportData->m_pIB.Release();
-        while (static_cast<int>(viewportData->m_IndexBufferSize) < pDrawData->TotalIdxCount)
-            viewportData->m_IndexBufferSize *= 2;
-
-        BufferDesc IBDesc;
-        IBDesc.Name = "Imgui index buffer";
-        IBDesc.BindFlags = BIND_INDEX_BUFFER;
-        IBDesc.Size = viewportData->m_IndexBufferSize * sizeof(ImDrawIdx);
-        IBDesc.Usage = USAGE_DYNAMIC;
-        IBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        m_pDevice->CreateBuffer(IBDesc, nullptr, &viewportData->m_pIB);
-    }
+    auto *pRing = gTheApp->GetUploadRing();
 
+    // Indices follow the vertices in one allocation; sizeof(ImDrawVert) keeps them aligned
+    const Uint64 VtxSize = pDrawData->TotalVtxCount * sizeof(ImDrawVert);
+    const Uint64 IdxSize = pDrawData->TotalIdxCount * sizeof(ImDrawIdx);
+    Uint64 VtxBase = 0;
     {
-        MapHelper<ImDrawVert> Verices(pCtx, viewportData->m_pVB, MAP_WRITE, MAP_FLAG_DISCARD);
-        MapHelper<ImDrawIdx> Indices(pCtx, viewportData->m_pIB, MAP_WRITE, MAP_FLAG_DISCARD);
-
-        ImDrawVert *pVtxDst = Verices;
-        ImDrawIdx *pIdxDst = Indices;
+        auto *pData = static_cast<Uint8 *>(pRing->Allocate(VtxSize + IdxSize, sizeof(ImDrawVert), VtxBase));
+        auto *pVtxDst = reinterpret_cast<ImDrawVert *>(pData);
+        auto *pIdxDst = reinterpret_cast<ImDrawIdx *>(pData + VtxSize);
         for (Int32 CmdListID = 0; CmdListID < pDrawData->CmdListsCount; CmdListID++) {
             const ImDrawList *pCmdList = pDrawData->CmdLists[CmdListID];
             memcpy(pVtxDst, pCmdList->VtxBuffer.Data, pCmdList->VtxBuffer.Size * sizeof(ImDrawVert));
@@ -648,7 +642,31 @@ void ImGuiDiligentRenderer::RenderDrawData(BorschDiligentViewportData *viewportD
             pVtxDst += pCmdList->VtxBuffer.Size;
             pIdxDst += pCmdList->IdxBuffer.Size;
         }
+        pRing->Unmap();
+    }
+    const Uint64 IdxBase = VtxBase + VtxSize;
+    // Only valid after the allocation, which may have grown the ring
+    IBuffer *pRingBuffer = pRing->GetBuffer();
+
+    // Everything the draws below touch is transitioned in one batch, they only verify states.
+    // Secondary viewports render into swap chains the render graph does not know about.
+    ITextureView *pRTV = viewportData->pSwapChain->GetCurrentBackBufferRTV();
+    ITextureView *pDSV = viewportData->pSwapChain->GetDepthBufferDSV();
+    m_Barriers.Add(pRTV->GetTexture(), RESOURCE_STATE_RENDER_TARGET);
+    if (pDSV != nullptr)
+        m_Barriers.Add(pDSV->GetTexture(), RESOURCE_STATE_DEPTH_WRITE);
+    m_Barriers.Add(pRingBuffer, static_cast<RESOURCE_STATE>(RESOURCE_STATE_VERTEX_BUFFER | RESOURCE_STATE_INDEX_BUFFER));
+    for (Int32 CmdListID = 0; CmdListID < pDrawData->CmdListsCount; CmdListID++) {
+        for (const auto &Cmd: pDrawData->CmdLists[CmdListID]->CmdBuffer) {
+            if (Cmd.UserCallback == NULL && Cmd.TextureId != NULL) {
+                m_Barriers.Add(reinterpret_cast<ITextureView *>(Cmd.TextureId)->GetTexture(),
+                               RESOURCE_STATE_SHADER_RESOURCE);
+            }
+        }
     }
+    m_Barriers.Flush(pCtx);
+
+    pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
     // Setup orthographic projection matrix into our constant buffer
     // Our visible imgui space lies from pDrawData->DisplayPos (top left) to pDrawData->DisplayPos+data_data->DisplaySize (bottom right).
@@ -715,11 +733,12 @@ void ImGuiDiligentRenderer::RenderDrawData(BorschDiligentViewportData *viewportD
     auto SetupRenderState = [&]() //
     {
       // Setup shader and vertex buffers
-      IBuffer *pVBs[] = {viewportData->m_pVB};
-      pCtx->SetVertexBuffers(0, 1, pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+      IBuffer *pVBs[] = {pRingBuffer};
+      Uint64 VtxOffsets[] = {VtxBase};
+      pCtx->SetVertexBuffers(0, 1, pVBs, VtxOffsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY,
                              SET_VERTEX_BUFFERS_FLAG_RESET);
-      pCtx->SetIndexBuffer(viewportData->m_pIB, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-      pCtx->SetPipelineState(m_pPSO);
+      pCtx->SetIndexBuffer(pRingBuffer, IdxBase, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+      pCtx->SetPipelineState(m_Pipeline->PSO);
 
       const float blend_factor[4] = {0.f, 0.f, 0.f, 0.f};
       pCtx->SetBlendFactors(blend_factor);
@@ -785,7 +804,7 @@ void ImGuiDiligentRenderer::RenderDrawData(BorschDiligentViewportData *viewportD
                 if (pTextureView != pLastTextureView) {
                     pLastTextureView = pTextureView;
                     m_pTextureVar->Set(pTextureView);
-                    pCtx->CommitShaderResources(m_pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+                    pCtx->CommitShaderResources(m_Pipeline->SRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
                 }
 
                 DrawIndexedAttribs DrawAttrs{
@@ -796,9 +815,9 @@ void ImGuiDiligentRenderer::RenderDrawData(BorschDiligentViewportData *viewportD
                 if (m_BaseVertexSupported) {
                     DrawAttrs.BaseVertex = pCmd->VtxOffset + GlobalVtxOffset;
                 } else {
-                    IBuffer *pVBs[] = {viewportData->m_pVB};
-                    Uint64 VtxOffsets[] = {sizeof(ImDrawVert) * (pCmd->VtxOffset + GlobalVtxOffset)};
-                    pCtx->SetVertexBuffers(0, 1, pVBs, VtxOffsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                    IBuffer *pVBs[] = {pRingBuffer};
+                    Uint64 VtxOffsets[] = {VtxBase + sizeof(ImDrawVert) * (pCmd->VtxOffset + GlobalVtxOffset)};
+                    pCtx->SetVertexBuffers(0, 1, pVBs, VtxOffsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY,
                                            SET_VERTEX_BUFFERS_FLAG_NONE);
                 }
                 pCtx->DrawIndexed(DrawAttrs);
@@ -815,15 +834,17 @@ static bt::BorschDiligentRenderData *ImGui_ImplDX12_GetBackendData() {
 }
 
 static void Diligent_CreateWindow(ImGuiViewport *viewport) {
-    HWND hwnd = viewport->PlatformHandleRaw ? (HWND) viewport->PlatformHandleRaw : (HWND) viewport->PlatformHandle;
-
-    IM_ASSERT(hwnd != 0);
-
     bt::BorschDiligentRenderData *bd = ImGui_ImplDX12_GetBackendData();
     auto *vd = IM_NEW(bt::BorschDiligentViewportData)(/*bd->numFramesInFlight*/);
     viewport->RendererUserData = vd;
 
-    bt::gTheApp->CreateSwapChain(vd->pSwapChain, hwnd, true);
+#if PLATFORM_WIN32
+    HWND hwnd = viewport->PlatformHandleRaw ? (HWND) viewport->PlatformHandleRaw : (HWND) viewport->PlatformHandle;
+
+    IM_ASSERT(hwnd != 0);
+
+    bt::gTheApp->CreateSwapChain(vd->pSwapChain, Win32NativeWindow{hwnd}, true);
+#endif
 
     IM_ASSERT(vd->pSwapChain.RawPtr() != nullptr);
 }
@@ -35,6 +35,8 @@
 #include "imgui.h"
 
 #include "SwapChain.h"
+#include "render/PipelineCache.h"
+#include "render/BarrierBatch.h"
 
 struct ImDrawData;
 
@@ -61,17 +63,9 @@ struct BorschDiligentRenderData {
   bt::ImGuiDiligentRenderer* Renderer;
 };
 
+// Vertices and indices of every viewport come from the application's upload ring
 struct BorschDiligentViewportData {
   RefCntAutoPtr<ISwapChain> pSwapChain;
-  RefCntAutoPtr<IBuffer> m_pVB;
-  RefCntAutoPtr<IBuffer> m_pIB;
-  Uint32 m_VertexBufferSize = 0;
-  Uint32 m_IndexBufferSize = 0;
-
-  BorschDiligentViewportData() :
-      m_VertexBufferSize{1024},
-      m_IndexBufferSize{1024} {}
-
 };
 
 class ImGuiDiligentRenderer {
@@ -108,12 +102,13 @@ class ImGuiDiligentRenderer {
   private:
 
     RefCntAutoPtr<IRenderDevice> m_pDevice;
-    RefCntAutoPtr<IShaderResourceBinding> m_pSRB;
     IShaderResourceVariable *m_pTextureVar = nullptr;
     bool m_BaseVertexSupported = false;
+    BarrierBatch m_Barriers;
     RefCntAutoPtr<IBuffer> m_pVertexConstantBuffer;
 
-    RefCntAutoPtr<IPipelineState> m_pPSO;
+    // Compiled in the background, its shared SRB is where the font texture gets bound
+    PipelineHandle m_Pipeline;
 
     BorschDiligentViewportData pMainViewportData;
 
@@ -0,0 +1,33 @@
+#include "GraphicsTypes.h"
+#include "imgui.h"
+#include "ImGuiImplGlfw.hpp"
+#include "backends/imgui_impl_glfw.h"
+#include "DebugUtilities.hpp"
+
+namespace bt
+{
+    ImGuiImplGlfw::ImGuiImplGlfw(GLFWwindow* pWindow,
+                                 IRenderDevice* pDevice,
+                                 TEXTURE_FORMAT BackBufferFmt,
+                                 TEXTURE_FORMAT DepthBufferFmt,
+                                 Uint32 InitialVertexBufferSize,
+                                 Uint32 InitialIndexBufferSize) :
+        ImGuiImpl{pWindow, pDevice, BackBufferFmt, DepthBufferFmt, InitialVertexBufferSize, InitialIndexBufferSize}
+    {
+        // Chains to the callbacks the platform installed on the window
+        ImGui_ImplGlfw_InitForOther(pWindow, true);
+    }
+
+    ImGuiImplGlfw::~ImGuiImplGlfw()
+    {
+        ImGui_ImplGlfw_Shutdown();
+    }
+
+    void ImGuiImplGlfw::NewFrame(SURFACE_TRANSFORM SurfacePreTransform)
+    {
+        VERIFY(SurfacePreTransform == SURFACE_TRANSFORM_IDENTITY, "Unexpected surface pre-transform");
+
+        ImGui_ImplGlfw_NewFrame();
+        ImGuiImpl::NewFrame(SurfacePreTransform);
+    }
+} // namespace bt
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include "ImGuiImpl.hpp"
+
+struct GLFWwindow;
+
+namespace bt
+{
+
+class ImGuiImplGlfw final : public ImGuiImpl
+{
+public:
+    ImGuiImplGlfw(GLFWwindow*    pWindow,
+                  IRenderDevice* pDevice,
+                  TEXTURE_FORMAT BackBufferFmt,
+                  TEXTURE_FORMAT DepthBufferFmt,
+                  Uint32         InitialVertexBufferSize = ImGuiImpl::DefaultInitialVBSize,
+                  Uint32         InitialIndexBufferSize  = ImGuiImpl::DefaultInitialIBSize);
+    ~ImGuiImplGlfw();
+
+    // clang-format off
+    ImGuiImplGlfw             (const ImGuiImplGlfw&)  = delete;
+    ImGuiImplGlfw             (      ImGuiImplGlfw&&) = delete;
+    ImGuiImplGlfw& operator = (const ImGuiImplGlfw&)  = delete;
+    ImGuiImplGlfw& operator = (      ImGuiImplGlfw&&) = delete;
+    // clang-format on
+
+    virtual void NewFrame(SURFACE_TRANSFORM SurfacePreTransform) override final;
+};
+
+} // namespace bt
@@ -1 +1,29 @@
 #include "Scene.h"
+
+namespace bt {
+
+Uint32 Scene::AddBounds(const Vector &Center, const Vector &Extent) {
+    ++mVersion;
+    return mBounds.Add(Center, Extent);
+}
+
+void Scene::SetBounds(Uint32 Handle, const Vector &Center, const Vector &Extent) {
+    // Most objects do not move every frame, keep the version stable so views can reuse their culling results
+    if (mBounds.CenterX[Handle] == static_cast<float>(Center.x) &&
+        mBounds.CenterY[Handle] == static_cast<float>(Center.y) &&
+        mBounds.CenterZ[Handle] == static_cast<float>(Center.z) &&
+        mBounds.ExtentX[Handle] == static_cast<float>(Extent.x) &&
+        mBounds.ExtentY[Handle] == static_cast<float>(Extent.y) &&
+        mBounds.ExtentZ[Handle] == static_cast<float>(Extent.z)) {
+        return;
+    }
+
+    mBounds.Set(Handle, Center, Extent);
+    ++mVersion;
+}
+
+void Scene::Cull(const Frustum &ViewFrustum, std::vector<Uint32> &OutVisible) const {
+    CullBoxes(ViewFrustum, mBounds, OutVisible);
+}
+
+}
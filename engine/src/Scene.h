@@ -1,8 +1,29 @@
 #pragma once
 
-class Scene {
+#include <vector>
+
+#include "render/FrustumCulling.h"
 
+namespace bt {
+
+class Scene {
   public:
+    // Registers object bounds, returned handle is what Cull() reports for this object
+    Uint32 AddBounds(const Vector &Center, const Vector &Extent);
 
+    void SetBounds(Uint32 Handle, const Vector &Center, const Vector &Extent);
 
+    // Culls all registered bounds, OutVisible receives sorted handles of visible objects
+    void Cull(const Frustum &ViewFrustum, std::vector<Uint32> &OutVisible) const;
+
+    [[nodiscard]] Uint32 GetNumObjects() const { return mBounds.Size(); }
+
+    // Incremented whenever any bounds change
+    [[nodiscard]] Uint64 GetVersion() const { return mVersion; }
+
+  private:
+    BoundingBoxesSoA mBounds;
+    Uint64 mVersion = 0;
 };
+
+}
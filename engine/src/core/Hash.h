@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace bt {
+
+// 64-bit FNV-1a, used for content keys that have to stay stable between runs and tools
+constexpr uint64_t HashSeed = 14695981039346656037ull;
+
+inline void HashBytes(uint64_t &Hash, const void *pData, size_t Size) {
+    const auto *pBytes = static_cast<const uint8_t *>(pData);
+    for (size_t i = 0; i < Size; ++i) {
+        Hash ^= pBytes[i];
+        Hash *= 1099511628211ull;
+    }
+}
+
+template<typename T>
+void HashValue(uint64_t &Hash, const T &Value) {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only plain values can be hashed");
+    HashBytes(Hash, &Value, sizeof(Value));
+}
+
+inline void HashString(uint64_t &Hash, const char *Str) {
+    if (Str != nullptr) {
+        HashBytes(Hash, Str, std::strlen(Str));
+    }
+    // Separator so that ("ab", "c") and ("a", "bc") differ
+    HashValue(Hash, uint8_t{0});
+}
+
+inline void HashString(uint64_t &Hash, const std::string &Str) {
+    HashString(Hash, Str.c_str());
+}
+
+}
@@ -1,9 +1,10 @@
 #include "Logging.h"
 
-#include <Windows.h>
 #include <iostream>
 
-#include "Application.h"
+#ifdef _WIN32
+#include <Windows.h>
+#endif
 
 #include "spdlog/spdlog.h"
 #include "spdlog/async.h" //support for async logging.
@@ -14,6 +15,7 @@ namespace bt::log {
     std::unique_ptr<class Logger> GLogger;
 
     void Logger::Append(LogLevel level, const std::string &msg) {
+        std::lock_guard<std::mutex> lock(m_mutex);
 
         try
         {
@@ -49,7 +51,9 @@ namespace bt::log {
                 std::cerr << m << std::endl;
                 break;
         }
+#ifdef _WIN32
         OutputDebugStringA(m.c_str());
+#endif
         m_lines.push_back(LogLine { level, msg });
 
         for (auto d: m_delegates) {
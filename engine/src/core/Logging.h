@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -30,6 +31,8 @@ namespace bt::log {
     private:
         std::vector<LogLine> m_lines;
         std::vector<ILogDelegate*> m_delegates;
+        // Pipeline compile jobs log from worker threads
+        std::mutex m_mutex;
     };
 
     void Log(LogLevel level, const std::string &msg);
@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace bt {
+
+ThreadPool::ThreadPool(uint32_t NumThreads) {
+    if (NumThreads == 0) {
+        const auto HardwareThreads = std::thread::hardware_concurrency();
+        NumThreads = std::max(HardwareThreads, 2u) - 1;
+    }
+
+    mThreads.reserve(NumThreads);
+    for (uint32_t i = 0; i < NumThreads; ++i) {
+        mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mStopping = true;
+    }
+    mJobAvailable.notify_all();
+
+    for (auto &Thread: mThreads) {
+        Thread.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> Job) {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mJobs.push_back(std::move(Job));
+    }
+    mJobAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> Lock(mMutex);
+    mIdle.wait(Lock, [this] { return mJobs.empty() && mNumActiveJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t Count, const std::function<void(uint32_t)> &Fn) {
+    if (Count == 0) {
+        return;
+    }
+
+    std::mutex DoneMutex;
+    std::condition_variable Done;
+    uint32_t NumRemaining = Count - 1;
+
+    for (uint32_t i = 0; i + 1 < Count; ++i) {
+        Enqueue([&, i] {
+            Fn(i);
+            // Notify under the lock, the waiter destroys Done as soon as it sees zero
+            std::lock_guard<std::mutex> Lock(DoneMutex);
+            --NumRemaining;
+            Done.notify_one();
+        });
+    }
+
+    Fn(Count - 1);
+
+    std::unique_lock<std::mutex> Lock(DoneMutex);
+    Done.wait(Lock, [&NumRemaining] { return NumRemaining == 0; });
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> Job;
+        {
+            std::unique_lock<std::mutex> Lock(mMutex);
+            mJobAvailable.wait(Lock, [this] { return mStopping || !mJobs.empty(); });
+            // Remaining jobs are still drained on shutdown
+            if (mJobs.empty()) {
+                return;
+            }
+            Job = std::move(mJobs.front());
+            mJobs.pop_front();
+            ++mNumActiveJobs;
+        }
+
+        Job();
+
+        {
+            std::lock_guard<std::mutex> Lock(mMutex);
+            --mNumActiveJobs;
+            if (mJobs.empty() && mNumActiveJobs == 0) {
+                mIdle.notify_all();
+            }
+        }
+    }
+}
+
+}
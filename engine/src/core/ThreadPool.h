@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bt {
+
+// Fixed set of worker threads consuming a FIFO job queue
+class ThreadPool {
+  public:
+    // 0 threads means one per hardware thread minus the main thread, but at least one
+    explicit ThreadPool(uint32_t NumThreads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void Enqueue(std::function<void()> Job);
+
+    // Blocks until the queue is empty and no job is running
+    void WaitIdle();
+
+    // Runs Fn(0)..Fn(Count - 1) in parallel, the last index on the calling thread, and returns
+    // once all of them finished. Unlike WaitIdle() this does not wait for unrelated jobs.
+    void ParallelFor(uint32_t Count, const std::function<void(uint32_t)> &Fn);
+
+    [[nodiscard]] uint32_t GetNumThreads() const { return static_cast<uint32_t>(mThreads.size()); }
+
+  private:
+    void WorkerLoop();
+
+  private:
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mJobs;
+    std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::condition_variable mIdle;
+    uint32_t mNumActiveJobs = 0;
+    bool mStopping = false;
+};
+
+}
@@ -0,0 +1,71 @@
+#include "CubeField.h"
+
+#include <algorithm>
+
+#include "Scene.h"
+#include "TestCube.h"
+#include "render/RenderViews.h"
+#include "render/InstancedRenderer.h"
+
+namespace bt {
+
+namespace {
+constexpr Uint32 GridSide = 256;
+constexpr double GridSpacing = 3.0;
+constexpr double GridHeight = -3.0;
+}
+
+CubeField::CubeField(Scene &TargetScene, std::shared_ptr<Mesh> CubeMesh) : mScene(TargetScene) {
+    mPrototype = std::make_unique<TestCube>(std::move(CubeMesh));
+}
+
+CubeField::~CubeField() = default;
+
+void CubeField::AddCubes(Uint32 Count) {
+    const auto First = static_cast<Uint32>(mHandles.size());
+    mHandles.reserve(First + Count);
+    mTransforms.reserve(First + Count);
+    mColors.reserve(First + Count);
+
+    for (Uint32 i = First; i < First + Count; ++i) {
+        const Uint32 Column = i % GridSide;
+        const Uint32 Row = i / GridSide;
+        const Vector Location((static_cast<double>(Column) - GridSide / 2) * GridSpacing, GridHeight,
+                              static_cast<double>(Row) * GridSpacing);
+
+        mHandles.push_back(mScene.AddBounds(Location, TestCube::GetBoundsExtent()));
+        mTransforms.push_back(MatrixF(glm::translate(Matrix(1.0), Location)));
+
+        // Cheap hash so neighbouring cubes get different tints
+        const Uint32 Hash = i * 2654435761u;
+        mColors.emplace_back(0.5f + (Hash & 0xFF) / 510.f, 0.5f + ((Hash >> 8) & 0xFF) / 510.f,
+                             0.5f + ((Hash >> 16) & 0xFF) / 510.f, 1.f);
+    }
+}
+
+void CubeField::Submit(const RenderView &View, InstancedRenderer &Renderer) {
+    if (mHandles.empty()) {
+        return;
+    }
+
+    auto *pMesh = mPrototype->GetMesh();
+    auto *pMaterial = mPrototype->GetMaterial();
+
+    // Both sequences are sorted, walk them together instead of searching every handle
+    const auto &Visible = View.Visible;
+    auto It = std::lower_bound(Visible.begin(), Visible.end(), mHandles.front());
+    size_t Local = 0;
+    for (; It != Visible.end(); ++It) {
+        while (Local < mHandles.size() && mHandles[Local] < *It) {
+            ++Local;
+        }
+        if (Local == mHandles.size()) {
+            break;
+        }
+        if (mHandles[Local] == *It) {
+            Renderer.AddInstance(pMesh, pMaterial, mTransforms[Local], mColors[Local]);
+        }
+    }
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "core/Math.h"
+
+namespace bt {
+
+class Scene;
+class TestCube;
+struct Mesh;
+class InstancedRenderer;
+struct RenderView;
+
+// Grid of static cubes used to stress the instanced path. All cubes share the mesh and
+// material of one prototype TestCube, so every view draws the whole field with one call.
+class CubeField {
+  public:
+    CubeField(Scene &TargetScene, std::shared_ptr<Mesh> CubeMesh);
+
+    ~CubeField();
+
+    // Continues the grid on the XZ plane below the test cubes
+    void AddCubes(Uint32 Count);
+
+    // Queues cubes that are visible from the view
+    void Submit(const RenderView &View, InstancedRenderer &Renderer);
+
+    [[nodiscard]] Uint32 GetNumCubes() const { return static_cast<Uint32>(mHandles.size()); }
+
+  private:
+    Scene &mScene;
+    std::unique_ptr<TestCube> mPrototype;
+
+    // Scene handles in ascending order, matching the order of RenderView::Visible
+    std::vector<Uint32> mHandles;
+    std::vector<MatrixF> mTransforms;
+    std::vector<glm::vec4> mColors;
+};
+
+}
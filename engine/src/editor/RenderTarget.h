@@ -1,49 +1,51 @@
 #pragma once
 
-#include "EngineFactory.h"
+#include <algorithm>
+
 #include "RefCntAutoPtr.hpp"
-#include "RenderDevice.h"
 #include "DeviceContext.h"
-#include "SwapChain.h"
 #include "BasicMath.hpp"
+#include "render/RenderGraph.h"
 
 namespace bt {
 
 using namespace Diligent;
 
+// Offscreen color and depth target of a view. The textures are transient render graph resources
+// declared anew every frame, so their memory is pooled and shared with other transient targets.
+// They are allocated in size buckets larger than the requested size, which is rendered as a
+// sub-rectangle, so resizing only changes the texture when a bucket boundary is crossed.
 class RenderTarget {
   public:
-    explicit RenderTarget(IRenderDevice* Device) {
-        m_Width = 0;
-        m_Height = 0;
-        m_pDevice = Device;
+    static constexpr TEXTURE_FORMAT RenderTargetFormat = TEX_FORMAT_BGRA8_UNORM_SRGB;
+    static constexpr TEXTURE_FORMAT DepthBufferFormat  = TEX_FORMAT_D32_FLOAT;
+
+    RenderTarget() {
         SetSize(256, 256);
     }
 
     [[nodiscard]] Uint32 GetWidth() const { return m_Width; }
     [[nodiscard]] Uint32 GetHeight() const { return m_Height; }
 
-    void Activate(IDeviceContext* m_pImmediateContext) {
-        // Clear the offscreen render target and depth buffer
-        m_pImmediateContext->SetRenderTargets(1, &m_pColorRTV, m_pDepthDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        m_pImmediateContext->ClearRenderTarget(m_pColorRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        m_pImmediateContext->ClearDepthStencil(m_pDepthDSV, CLEAR_DEPTH_FLAG, 1.0f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    }
-
-    void SetSize(Uint32 Width, Uint32 Height) {
-        if (m_Width == Width && m_Height == Height) {
-            return;
+    // Declares this frame's color and depth textures as outputs of the pass being set up
+    void DeclareOutputs(RenderGraphBuilder &Builder) {
+        const auto RenderWidth = std::max(static_cast<Uint32>(m_Width * mResolutionScale + 0.5f), 1u);
+        const auto RenderHeight = std::max(static_cast<Uint32>(m_Height * mResolutionScale + 0.5f), 1u);
+        const auto AllocWidth = FitAllocation(RenderWidth, mAllocWidth);
+        const auto AllocHeight = FitAllocation(RenderHeight, mAllocHeight);
+        if (AllocWidth != mAllocWidth || AllocHeight != mAllocHeight) {
+            mAllocWidth = AllocWidth;
+            mAllocHeight = AllocHeight;
+            ++mNumReallocations;
         }
+        mFrameWidth = RenderWidth;
+        mFrameHeight = RenderHeight;
 
-        m_Width = Width;
-        m_Height = Height;
-
-// Create window-size offscreen render target
         TextureDesc RTColorDesc;
         RTColorDesc.Name      = "Offscreen render target";
         RTColorDesc.Type      = RESOURCE_DIM_TEX_2D;
-        RTColorDesc.Width     = Width;
-        RTColorDesc.Height    = Height;
+        RTColorDesc.Width     = mAllocWidth;
+        RTColorDesc.Height    = mAllocHeight;
         RTColorDesc.MipLevels = 1;
         RTColorDesc.Format    = RenderTargetFormat;
         // The render target can be bound as a shader resource and as a render target
@@ -54,14 +56,9 @@ class RenderTarget {
         RTColorDesc.ClearValue.Color[1] = ClearColor[1];
         RTColorDesc.ClearValue.Color[2] = ClearColor[2];
         RTColorDesc.ClearValue.Color[3] = ClearColor[3];
-        RefCntAutoPtr<ITexture> pRTColor;
-        m_pDevice->CreateTexture(RTColorDesc, nullptr, &pRTColor);
-        // Store the render target view
-        m_pColorRTV = pRTColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
-        m_pColorSRV = pRTColor->GetDefaultView(Diligent::TEXTURE_VIEW_SHADER_RESOURCE);
+        mColor = Builder.CreateTexture(RTColorDesc);
+        Builder.Write(mColor, RESOURCE_STATE_RENDER_TARGET);
 
-
-        // Create window-size depth buffer
         TextureDesc RTDepthDesc = RTColorDesc;
         RTDepthDesc.Name        = "Offscreen depth buffer";
         RTDepthDesc.Format      = DepthBufferFormat;
@@ -70,37 +67,83 @@ class RenderTarget {
         RTDepthDesc.ClearValue.Format               = RTDepthDesc.Format;
         RTDepthDesc.ClearValue.DepthStencil.Depth   = 1;
         RTDepthDesc.ClearValue.DepthStencil.Stencil = 0;
-        RefCntAutoPtr<ITexture> pRTDepth;
-        m_pDevice->CreateTexture(RTDepthDesc, nullptr, &pRTDepth);
-        // Store the depth-stencil view
-        m_pDepthDSV = pRTDepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+        mDepth = Builder.CreateTexture(RTDepthDesc);
+        Builder.Write(mDepth, RESOURCE_STATE_DEPTH_WRITE);
+    }
 
-        // We need to release and create a new SRB that references new off-screen render target SRV
-        // m_pRTSRB.Release();
-        // m_pRTPSO->CreateShaderResourceBinding(&m_pRTSRB, true);
+    // The graph has transitioned both textures before the pass runs
+    void Activate(IDeviceContext* m_pImmediateContext, const RenderGraph &Graph) {
+        ITextureView *pColorRTV = Graph.GetTextureView(mColor, TEXTURE_VIEW_RENDER_TARGET);
+        ITextureView *pDepthDSV = Graph.GetTextureView(mDepth, TEXTURE_VIEW_DEPTH_STENCIL);
 
-        // Set render target color texture SRV in the SRB
-        // m_pRTSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(pRTColor->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        // Clear the offscreen render target and depth buffer
+        m_pImmediateContext->SetRenderTargets(1, &pColorRTV, pDepthDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        const auto VP = GetViewport();
+        m_pImmediateContext->SetViewports(1, &VP, mAllocWidth, mAllocHeight);
+        m_pImmediateContext->ClearRenderTarget(pColorRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        m_pImmediateContext->ClearDepthStencil(pDepthDSV, CLEAR_DEPTH_FLAG, 1.0f, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
-    ITextureView* GetTexture() {
-        return m_pColorSRV;
+    // Takes effect when the outputs are declared next frame
+    void SetSize(Uint32 Width, Uint32 Height) {
+        m_Width = std::max(Width, 1u);
+        m_Height = std::max(Height, 1u);
     }
 
-  private:
+    // Fraction of the requested size that is actually rendered, the viewport image is upscaled
+    void SetResolutionScale(float Scale) {
+        mResolutionScale = Scale;
+    }
+
+    // Part of the textures this frame renders to
+    [[nodiscard]] Viewport GetViewport() const {
+        Viewport VP;
+        VP.Width = static_cast<float>(mFrameWidth);
+        VP.Height = static_cast<float>(mFrameHeight);
+        return VP;
+    }
+
+    // Texture coordinates of the bottom right corner of the viewport
+    [[nodiscard]] float2 GetUVScale() const {
+        return float2{static_cast<float>(mFrameWidth) / static_cast<float>(mAllocWidth),
+                      static_cast<float>(mFrameHeight) / static_cast<float>(mAllocHeight)};
+    }
+
+    [[nodiscard]] Uint32 GetNumReallocations() const { return mNumReallocations; }
+
+    // Color output of this frame, readers declare it with RenderGraphBuilder::Read()
+    [[nodiscard]] RGTextureHandle GetColor() const { return mColor; }
 
-    Uint32 m_Width;
-    Uint32 m_Height;
+    [[nodiscard]] RGTextureHandle GetDepth() const { return mDepth; }
 
-    RefCntAutoPtr<ITextureView> m_pColorRTV;
-    RefCntAutoPtr<ITextureView> m_pColorSRV;
-    RefCntAutoPtr<ITextureView> m_pDepthDSV;
+  private:
+    // Grows in SizeGranularity steps, shrinks only below half the allocation
+    static Uint32 FitAllocation(Uint32 Requested, Uint32 Allocated) {
+        if (Requested <= Allocated && Requested * 2 >= Allocated) {
+            return Allocated;
+        }
+        return (Requested + SizeGranularity - 1) / SizeGranularity * SizeGranularity;
+    }
 
-    RefCntAutoPtr<IRenderDevice> m_pDevice;
+  private:
+
+    // Requested size
+    Uint32 m_Width = 0;
+    Uint32 m_Height = 0;
+    // Texture size
+    Uint32 mAllocWidth = 0;
+    Uint32 mAllocHeight = 0;
+    // Rendered size when this frame's outputs were declared
+    Uint32 mFrameWidth = 1;
+    Uint32 mFrameHeight = 1;
+    Uint32 mNumReallocations = 0;
+    float mResolutionScale = 1.f;
+
+    RGTextureHandle mColor = InvalidRGTexture;
+    RGTextureHandle mDepth = InvalidRGTexture;
 
     static constexpr float ClearColor[] = {0.020f, 0.020f, 0.020f, 1.0f};
-    static constexpr TEXTURE_FORMAT RenderTargetFormat = TEX_FORMAT_BGRA8_UNORM_SRGB;
-    static constexpr TEXTURE_FORMAT DepthBufferFormat  = TEX_FORMAT_D32_FLOAT;
+    static constexpr Uint32 SizeGranularity = 128;
 };
 
 }
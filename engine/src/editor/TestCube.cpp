@@ -1,23 +1,21 @@
 #include "TestCube.h"
 
 #include "Application.h"
+#include "render/InstancedRenderer.h"
+#include "render/PipelineCache.h"
 
 #include "RenderDevice.h"
 #include "SwapChain.h"
 #include "MapHelper.hpp"
 #include "BasicMath.hpp"
+#include "fmt/core.h"
 
 using namespace bt;
 using namespace Diligent;
 
-TestCube::TestCube() {
+static RefCntAutoPtr<IPipelineState> CreateCubePipeline(PipelineCache &Cache, TEXTURE_FORMAT ColorFormat,
+                                                        TEXTURE_FORMAT DepthFormat, IBuffer *pViewConstants) {
     // Pipeline state object encompasses configuration of all GPU stages
-
-    auto app = gTheApp.get();
-    auto engineFactory = app->GetEngineFactory();
-    auto swapChain = app->GetSwapChain();
-    auto renderDevice = app->GetRenderDevice();
-
     GraphicsPipelineStateCreateInfo PSOCreateInfo;
 
     // Pipeline state name is used by the engine to report issues.
@@ -31,9 +29,9 @@ TestCube::TestCube() {
     // This tutorial will render to a single render target
     PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
     // Set render target format which is the format of the swap chain's color buffer
-    PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = swapChain->GetDesc().ColorBufferFormat;
+    PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = ColorFormat;
     // Set depth buffer format which is the format of the swap chain's back buffer
-    PSOCreateInfo.GraphicsPipeline.DSVFormat = swapChain->GetDesc().DepthBufferFormat;
+    PSOCreateInfo.GraphicsPipeline.DSVFormat = DepthFormat;
     // Primitive topology defines what kind of primitives will be rendered by this pipeline state
     PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     // Cull back faces
@@ -42,80 +40,69 @@ TestCube::TestCube() {
     PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
     // clang-format on
 
-    ShaderCreateInfo ShaderCI;
-    // Tell the system that the shader source code is in HLSL.
-    // For OpenGL, the engine will convert this into GLSL under the hood.
-    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderDesc VSDesc;
+    VSDesc.Type = SHADER_TYPE_VERTEX;
+    VSDesc.Name = "Cube VS";
+    VSDesc.FilePath = "cube_inst.vsh";
 
-    // OpenGL backend requires emulated combined HLSL texture samplers (g_Texture + g_Texture_sampler combination)
-    ShaderCI.UseCombinedTextureSamplers = true;
-
-    // In this tutorial, we will load shaders from file. To be able to do that,
-    // we need to create a shader source stream factory
-    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    engineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
-    // Create a vertex shader
-    RefCntAutoPtr<IShader> pVS;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
-        ShaderCI.EntryPoint = "main";
-        ShaderCI.Desc.Name = "Cube VS";
-        ShaderCI.FilePath = "d:/assets/cube.vsh";
-        renderDevice->CreateShader(ShaderCI, &pVS);
-        // Create dynamic uniform buffer that will store our transformation matrix
-        // Dynamic buffers can be frequently updated by the CPU
-        BufferDesc CBDesc;
-        CBDesc.Name = "VS constants CB";
-        CBDesc.Size = sizeof(float4x4);
-        CBDesc.Usage = USAGE_DYNAMIC;
-        CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
-        CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        renderDevice->CreateBuffer(CBDesc, nullptr, &m_VSConstants);
-    }
-
-    // Create a pixel shader
-    RefCntAutoPtr<IShader> pPS;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
-        ShaderCI.EntryPoint = "main";
-        ShaderCI.Desc.Name = "Cube PS";
-        ShaderCI.FilePath = "d:/assets/cube.psh";
-        renderDevice->CreateShader(ShaderCI, &pPS);
-    }
+    ShaderDesc PSDesc;
+    PSDesc.Type = SHADER_TYPE_PIXEL;
+    PSDesc.Name = "Cube PS";
+    PSDesc.FilePath = "cube.psh";
 
     // clang-format off
     // Define vertex shader input layout
+    // Slot 0 is the mesh, slot 1 is the per-instance stream filled by InstancedRenderer
     LayoutElement LayoutElems[] =
         {
             // Attribute 0 - vertex position
             LayoutElement{0, 0, 3, VT_FLOAT32, False},
             // Attribute 1 - vertex color
-            LayoutElement{1, 0, 4, VT_FLOAT32, False}
+            LayoutElement{1, 0, 4, VT_FLOAT32, False},
+            // Attributes 2..5 - instance world matrix columns
+            LayoutElement{2, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            LayoutElement{3, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            LayoutElement{4, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            LayoutElement{5, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            // Attribute 6 - instance color
+            LayoutElement{6, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
         };
     // clang-format on
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements = _countof(LayoutElems);
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
+    PSOCreateInfo.pVS = Cache.GetShader(VSDesc);
+    PSOCreateInfo.pPS = Cache.GetShader(PSDesc);
 
     // Define variable type that will be used by default
     PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
 
-    renderDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSOCube);
-
-
-    // Since we did not explcitly specify the type for 'Constants' variable, default
-    // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
-    // change and are bound directly through the pipeline state object.
-    m_pPSOCube->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
+    return RefCntAutoPtr<IPipelineState>(Cache.GetGraphicsPipeline(PSOCreateInfo, [pViewConstants](IPipelineState *pPSO) {
+        // Since we did not explcitly specify the type for 'Constants' variable, default
+        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
+        // change and are bound directly through the pipeline state object.
+        pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(pViewConstants);
+    }));
+}
 
-    // Create a shader resource binding object and bind all static resources in it
-    m_pPSOCube->CreateShaderResourceBinding(&m_pSRB, true);
+TestCube::TestCube(std::shared_ptr<Mesh> CubeMesh) : mMesh(std::move(CubeMesh)) {
+    auto app = gTheApp.get();
+    const auto ColorFormat = app->GetColorBufferFormat();
+    const auto DepthFormat = app->GetDepthBufferFormat();
+    RefCntAutoPtr<IBuffer> pViewConstants(app->GetInstancedRenderer()->GetViewConstants());
+
+    // Shaders and the pipeline are shared by all cubes, only the first cube queues the compilation
+    const auto Key = fmt::format("Cube {} {}", static_cast<Uint32>(ColorFormat), static_cast<Uint32>(DepthFormat));
+    mMaterial.Pipeline = app->GetPipelineCache()->RequestPipeline(Key, [=](PipelineCache &Cache) {
+        return CreateCubePipeline(Cache, ColorFormat, DepthFormat, pViewConstants);
+    });
+}
 
-    CreateVertexBuffer();
-    CreateIndexBuffer();
+std::shared_ptr<Mesh> TestCube::CreateMesh() {
+    auto CubeMesh = std::make_shared<Mesh>();
+    CreateVertexBuffer(*CubeMesh);
+    CreateIndexBuffer(*CubeMesh);
+    return CubeMesh;
 }
 
 void TestCube::Update(double CurrTime, double ElapsedTime) {
@@ -131,38 +118,11 @@ void TestCube::Update(double CurrTime, double ElapsedTime) {
     mCubeModelTransform = glm::rotate(mCubeModelTransform, Rotation, Vector(0, 1, 0));
 }
 
-void TestCube::DrawCube(const Matrix& ProjView) {
-    auto immediateContext = gTheApp->GetImmediateContext();
-    {
-        // Map the buffer and write current world-view-projection matrix
-        MapHelper<MatrixF> CBConstants(immediateContext, m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-
-        auto PVW = ProjView * mCubeModelTransform;
-        *CBConstants = MatrixTranspose(PVW);
-    }
-
-    // Bind vertex and index buffers
-    const Uint64 offset = 0;
-    IBuffer *pBuffs[] = {m_CubeVertexBuffer};
-    immediateContext->SetVertexBuffers(0, 1, pBuffs, &offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
-                                          SET_VERTEX_BUFFERS_FLAG_RESET);
-    immediateContext->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-    // Set the pipeline state
-    immediateContext->SetPipelineState(m_pPSOCube);
-    // Commit shader resources. RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode
-    // makes sure that resources are transitioned to required states.
-    immediateContext->CommitShaderResources(m_pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-    DrawIndexedAttribs DrawAttrs;     // This is an indexed draw call
-    DrawAttrs.IndexType = VT_UINT32; // Index type
-    DrawAttrs.NumIndices = 36;
-    // Verify the state of vertex and index buffers
-    DrawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
-    immediateContext->DrawIndexed(DrawAttrs);
+void TestCube::Submit(InstancedRenderer &Renderer) {
+    Renderer.AddInstance(mMesh.get(), &mMaterial, MatrixF(mCubeModelTransform), mColor);
 }
 
-void TestCube::CreateVertexBuffer() {
+void TestCube::CreateVertexBuffer(Mesh &CubeMesh) {
     auto device = gTheApp->GetRenderDevice();
     // Layout of this structure matches the one we defined in the pipeline state
     struct Vertex {
@@ -194,10 +154,10 @@ void TestCube::CreateVertexBuffer() {
     BufferData VBData;
     VBData.pData = CubeVerts;
     VBData.DataSize = sizeof(CubeVerts);
-    device->CreateBuffer(VertBuffDesc, &VBData, &m_CubeVertexBuffer);
+    device->CreateBuffer(VertBuffDesc, &VBData, &CubeMesh.VertexBuffer);
 }
 
-void TestCube::CreateIndexBuffer() {
+void TestCube::CreateIndexBuffer(Mesh &CubeMesh) {
     auto device = gTheApp->GetRenderDevice();
     // clang-format off
     Uint32 Indices[] =
@@ -219,7 +179,9 @@ void TestCube::CreateIndexBuffer() {
     BufferData IBData;
     IBData.pData = Indices;
     IBData.DataSize = sizeof(Indices);
-    device->CreateBuffer(IndBuffDesc, &IBData, &m_CubeIndexBuffer);
+    device->CreateBuffer(IndBuffDesc, &IBData, &CubeMesh.IndexBuffer);
+    CubeMesh.NumIndices = _countof(Indices);
+    CubeMesh.IndexType = VT_UINT32;
 }
 
 /*
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include "Application.h"
 #include "RefCntAutoPtr.hpp"
 
@@ -7,18 +9,26 @@
 #include "DeviceContext.h"
 #include "SwapChain.h"
 #include "core/Math.h"
+#include "render/Mesh.h"
 
 namespace bt {
 
 using namespace Diligent;
 
+class InstancedRenderer;
+
 class TestCube {
   public:
 
-    TestCube();
+    // All cubes draw the mesh made by CreateMesh(), the owner keeps it and passes it to each cube
+    explicit TestCube(std::shared_ptr<Mesh> CubeMesh);
+
+    [[nodiscard]] static std::shared_ptr<Mesh> CreateMesh();
 
     void Update(double CurrTime, double ElapsedTime);
-    void DrawCube(const Matrix &ProjView);
+
+    // Queues the cube for the instanced draw of the current view
+    void Submit(InstancedRenderer &Renderer);
 
     void SetLocation(const Vector& NewLoc) {
         mLocation = NewLoc;
@@ -28,11 +38,32 @@ class TestCube {
         Rotation = Rot;
     }
 
+    [[nodiscard]] const Vector &GetLocation() const {
+        return mLocation;
+    }
+
+    void SetColor(const glm::vec4 &Color) {
+        mColor = Color;
+    }
+
+    [[nodiscard]] Mesh *GetMesh() {
+        return mMesh.get();
+    }
+
+    [[nodiscard]] Material *GetMaterial() {
+        return &mMaterial;
+    }
+
+    // Conservative half-size of the cube rotated around the Y axis
+    [[nodiscard]] static Vector GetBoundsExtent() {
+        return Vector(1.415, 1.0, 1.415);
+    }
+
   private:
 
-    void CreateVertexBuffer();
+    static void CreateVertexBuffer(Mesh &CubeMesh);
 
-    void CreateIndexBuffer();
+    static void CreateIndexBuffer(Mesh &CubeMesh);
 
   private:
 
@@ -40,13 +71,11 @@ class TestCube {
 
     Vector mLocation;
     Matrix mCubeModelTransform;
+    glm::vec4 mColor = glm::vec4(1.f);
 
-    // Cube
-    RefCntAutoPtr<IPipelineState> m_pPSOCube;
-    RefCntAutoPtr<IShaderResourceBinding> m_pSRB;
-    RefCntAutoPtr<IBuffer> m_CubeVertexBuffer;
-    RefCntAutoPtr<IBuffer> m_CubeIndexBuffer;
-    RefCntAutoPtr<IBuffer> m_VSConstants;
+    // Cube, shared with the other cubes so they land in one instanced batch
+    std::shared_ptr<Mesh> mMesh;
+    Material mMaterial;
 };
 
 }
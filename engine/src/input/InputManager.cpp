@@ -1,11 +1,12 @@
 #include <cassert>
 #include <string>
 #include "InputManager.h"
-#include "Core/Logging.h"
+#include "core/Logging.h"
 
 namespace bt::input {
 
     void InputManager::Init() {
+#ifdef _WIN32
         RAWINPUTDEVICE Rid[2] = {};
 
         // Register mouse:
@@ -24,9 +25,11 @@ namespace bt::input {
             //registration failed. Call GetLastError for the cause of the error
             assert(0);
         }
+#endif
     }
 
     void InputManager::ParseMessage(void *lparam) {
+#ifdef _WIN32
         UINT size;
         UINT result;
 
@@ -42,6 +45,11 @@ namespace bt::input {
                 mInputMessages.push_back(input);
             }
         }
+#endif
+    }
+
+    void InputManager::QueueKeyEvent(unsigned Key, bool Pressed) {
+        mKeyEvents.emplace_back(Key, Pressed);
     }
 
     void InputManager::Update() {
@@ -50,6 +58,13 @@ namespace bt::input {
             state.IsJustReleased = false;
         }
 
+        for (const auto& event: mKeyEvents) {
+            SetKeyState(event.first, event.second);
+        }
+
+        mKeyEvents.clear();
+
+#ifdef _WIN32
         for (auto& msg: mInputMessages) {
             HandleRawInput(msg);
         }
@@ -88,19 +103,29 @@ namespace bt::input {
                 HandleRawInput(mInputBuffer[current_raw]);
             }
         }
+#endif
+    }
+
+    void InputManager::SetKeyState(unsigned Key, bool Pressed) {
+        if (Key >= sizeof(mKeysState) / sizeof(mKeysState[0])) {
+            return;
+        }
+        auto& state = mKeysState[Key];
+
+        auto wasPressed = state.IsPressed;
+
+        state.IsPressed = Pressed;
+        state.IsJustPressed = !wasPressed && Pressed;
+        state.IsJustReleased = wasPressed && !Pressed;
     }
 
+#ifdef _WIN32
     void InputManager::HandleRawInput(const RAWINPUT &raw) {
         if (raw.header.dwType == RIM_TYPEKEYBOARD) {
             const RAWKEYBOARD &rawkeyboard = raw.data.keyboard;
-            auto& state = mKeysState[rawkeyboard.VKey];
-
-            auto wasPressed = state.IsPressed;
-
-            state.IsPressed = rawkeyboard.Flags == RI_KEY_MAKE;
-            state.IsJustPressed = !wasPressed;
-            state.IsJustReleased = wasPressed && !state.IsPressed;
+            SetKeyState(rawkeyboard.VKey, rawkeyboard.Flags == RI_KEY_MAKE);
         }
 
     }
+#endif
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <utility>
 #include <vector>
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 namespace bt::input {
 
@@ -21,17 +25,26 @@ namespace bt::input {
 
     class InputManager {
 
+#ifdef _WIN32
         RAWINPUT mInputBuffer[1024];
 
         std::vector<RAWINPUT> mInputMessages;
+#endif
+
+        // Key code and pressed flag from platforms without raw input
+        std::vector<std::pair<unsigned, bool>> mKeyEvents;
 
         KeyState mKeysState[512];
 
     public:
         void Init();
 
+        // WM_INPUT message on Win32, ignored elsewhere
         void ParseMessage(void *lparam);
 
+        // Applied in the next Update(). Codes of letters and digits are their upper case ASCII values.
+        void QueueKeyEvent(unsigned Key, bool Pressed);
+
         void Update();
 
         bool IsKeyPressed(Key Key) {
@@ -51,7 +64,11 @@ namespace bt::input {
 
     private:
 
+        void SetKeyState(unsigned Key, bool Pressed);
+
+#ifdef _WIN32
         void HandleRawInput(const RAWINPUT &raw);
+#endif
 
     };
 
@@ -0,0 +1,26 @@
+#include <cstring>
+#include <memory>
+
+#include "Engine.h"
+#include "platform/Platform.h"
+
+using namespace bt;
+
+int main(int argc, char **argv) {
+    // --null runs without a window even where GLFW is available, e.g. on servers
+    auto Type = BT_PLATFORM_GLFW ? PlatformType::Glfw : PlatformType::Null;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--null") == 0) {
+            Type = PlatformType::Null;
+        }
+    }
+
+    GEngine = std::make_unique<Engine>();
+    GEngine->Init(BT_PROJECT_DIR, BT_DASCRIPT_DIR);
+
+    const int Result = RunApplication(argc, argv, Type);
+
+    GEngine->Shutdown();
+
+    return Result;
+}
@@ -0,0 +1,103 @@
+#include "Platform.h"
+
+#include "Engine.h"
+#include "ImGuiImplGlfw.hpp"
+#include "core/Logging.h"
+#include "fmt/core.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#if PLATFORM_WIN32
+#    define GLFW_EXPOSE_NATIVE_WIN32
+#elif PLATFORM_LINUX
+#    define GLFW_EXPOSE_NATIVE_X11
+#endif
+#include <GLFW/glfw3native.h>
+
+namespace bt {
+
+namespace {
+
+class GlfwPlatform final : public Platform {
+  public:
+    ~GlfwPlatform() override {
+        if (mWindow != nullptr) {
+            glfwDestroyWindow(mWindow);
+        }
+        if (mInitialized) {
+            glfwTerminate();
+        }
+    }
+
+    [[nodiscard]] PlatformType GetType() const override { return PlatformType::Glfw; }
+
+    bool CreateMainWindow(const WindowDesc &Desc) override {
+        glfwSetErrorCallback([](int Error, const char *Description) {
+            log::Error(fmt::format("GLFW error {}: {}", Error, Description));
+        });
+        mInitialized = glfwInit() == GLFW_TRUE;
+        if (!mInitialized) {
+            return false;
+        }
+
+        // The swap chain is created by the engine, GLFW must not make a GL context
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        mWindow = glfwCreateWindow(static_cast<int>(Desc.Width), static_cast<int>(Desc.Height), Desc.Title.c_str(),
+                                   nullptr, nullptr);
+        if (mWindow == nullptr) {
+            return false;
+        }
+
+        glfwSetWindowUserPointer(mWindow, this);
+        glfwSetFramebufferSizeCallback(mWindow, [](GLFWwindow *pWindow, int Width, int Height) {
+            static_cast<GlfwPlatform *>(glfwGetWindowUserPointer(pWindow))
+                ->NotifyResize(static_cast<Uint32>(Width), static_cast<Uint32>(Height));
+        });
+        glfwSetKeyCallback(mWindow, [](GLFWwindow *pWindow, int Key, int, int Action, int) {
+            if (Key == GLFW_KEY_ESCAPE && Action == GLFW_PRESS) {
+                glfwSetWindowShouldClose(pWindow, GLFW_TRUE);
+            }
+            // GLFW letter and digit codes are their ASCII values, like the virtual keys of input::Key
+            if (GInputManager != nullptr && Key >= 0 && Action != GLFW_REPEAT) {
+                GInputManager->QueueKeyEvent(static_cast<Uint32>(Key), Action == GLFW_PRESS);
+            }
+        });
+        return true;
+    }
+
+    bool PumpEvents() override {
+        glfwPollEvents();
+        return glfwWindowShouldClose(mWindow) == GLFW_FALSE;
+    }
+
+    bool GetNativeWindow(NativeWindow &OutWindow) const override {
+        if (mWindow == nullptr) {
+            return false;
+        }
+#if PLATFORM_WIN32
+        OutWindow = Win32NativeWindow{glfwGetWin32Window(mWindow)};
+#elif PLATFORM_LINUX
+        // Wayland sessions run the window through XWayland
+        OutWindow.WindowId = static_cast<Uint32>(glfwGetX11Window(mWindow));
+        OutWindow.pDisplay = glfwGetX11Display();
+#endif
+        return true;
+    }
+
+    std::unique_ptr<ImGuiImpl> CreateImGui(IRenderDevice *pDevice, TEXTURE_FORMAT BackBufferFmt,
+                                           TEXTURE_FORMAT DepthBufferFmt) override {
+        return std::make_unique<ImGuiImplGlfw>(mWindow, pDevice, BackBufferFmt, DepthBufferFmt);
+    }
+
+  private:
+    GLFWwindow *mWindow = nullptr;
+    bool mInitialized = false;
+};
+
+}
+
+std::unique_ptr<Platform> CreateGlfwPlatform() {
+    return std::make_unique<GlfwPlatform>();
+}
+
+}
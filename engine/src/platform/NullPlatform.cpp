@@ -0,0 +1,31 @@
+#include "Platform.h"
+
+#include "ImGuiImpl.hpp"
+
+namespace bt {
+
+namespace {
+
+// No window and no input. Drives headless runs on machines without a display.
+class NullPlatform final : public Platform {
+  public:
+    [[nodiscard]] PlatformType GetType() const override { return PlatformType::Null; }
+
+    bool CreateMainWindow(const WindowDesc &) override { return false; }
+
+    bool PumpEvents() override { return true; }
+
+    bool GetNativeWindow(NativeWindow &) const override { return false; }
+
+    std::unique_ptr<ImGuiImpl> CreateImGui(IRenderDevice *, TEXTURE_FORMAT, TEXTURE_FORMAT) override {
+        return nullptr;
+    }
+};
+
+}
+
+std::unique_ptr<Platform> CreateNullPlatform() {
+    return std::make_unique<NullPlatform>();
+}
+
+}
@@ -0,0 +1,76 @@
+#include "Platform.h"
+
+#include "Application.h"
+#include "HeadlessRunner.h"
+#include "core/Logging.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+// Defined next to each backend
+#if PLATFORM_WIN32
+std::unique_ptr<Platform> CreateWin32Platform();
+#endif
+#if BT_PLATFORM_GLFW
+std::unique_ptr<Platform> CreateGlfwPlatform();
+#endif
+std::unique_ptr<Platform> CreateNullPlatform();
+
+std::unique_ptr<Platform> CreatePlatform(PlatformType Type) {
+    switch (Type) {
+#if PLATFORM_WIN32
+        case PlatformType::Win32:
+            return CreateWin32Platform();
+#endif
+#if BT_PLATFORM_GLFW
+        case PlatformType::Glfw:
+            return CreateGlfwPlatform();
+#endif
+        case PlatformType::Null:
+            return CreateNullPlatform();
+        default:
+            return nullptr;
+    }
+}
+
+int RunApplication(int argc, char **argv, PlatformType Type) {
+    HeadlessOptions Headless;
+    if (ParseHeadlessOptions(argc, argv, Headless) || Type == PlatformType::Null) {
+        return RunHeadless(Headless);
+    }
+
+    auto Plat = CreatePlatform(Type);
+    if (!Plat) {
+        log::Error(fmt::format("Platform {} is not part of this build", static_cast<int>(Type)));
+        return 2;
+    }
+    if (!Plat->CreateMainWindow(WindowDesc{})) {
+        log::Error("Cannot create the main window");
+        return 2;
+    }
+
+    gTheApp = std::make_unique<Application>();
+    Plat->SetResizeHandler([](Uint32 Width, Uint32 Height) {
+        if (gTheApp) {
+            gTheApp->WindowResize(Width, Height);
+        }
+    });
+    if (!gTheApp->Init(*Plat)) {
+        gTheApp.reset();
+        return 2;
+    }
+
+    auto PrevTime = Plat->GetTime();
+    while (Plat->PumpEvents()) {
+        const auto CurrTime = Plat->GetTime();
+        const auto ElapsedTime = CurrTime - PrevTime;
+        PrevTime = CurrTime;
+        gTheApp->Tick(CurrTime, ElapsedTime);
+    }
+
+    gTheApp->Shutdown();
+    gTheApp.reset();
+    return 0;
+}
+
+}
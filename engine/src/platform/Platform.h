@@ -0,0 +1,80 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "BasicTypes.h"
+#include "GraphicsTypes.h"
+#include "NativeWindow.h"
+#include "Timer.hpp"
+
+namespace bt {
+
+using namespace Diligent;
+
+class ImGuiImpl;
+
+enum class PlatformType : Uint8 {
+    // Native window and RawInput, Windows only
+    Win32,
+    // GLFW window (X11, Wayland through XWayland) and input
+    Glfw,
+    // No window or input, the engine renders headless
+    Null
+};
+
+struct WindowDesc {
+    std::string Title = "BorschTech";
+    Uint32 Width = 1280;
+    Uint32 Height = 1024;
+};
+
+// Window, event pump, input and timing of one OS. Events are delivered from PumpEvents():
+// keys go to GInputManager, size changes to the resize handler.
+class Platform {
+  public:
+    virtual ~Platform() = default;
+
+    [[nodiscard]] virtual PlatformType GetType() const = 0;
+
+    virtual bool CreateMainWindow(const WindowDesc &Desc) = 0;
+
+    // Handles pending events without blocking, false once the user asked to quit
+    virtual bool PumpEvents() = 0;
+
+    // False when the platform has no window
+    virtual bool GetNativeWindow(NativeWindow &OutWindow) const = 0;
+
+    // Dear ImGui with this platform's input backend, nullptr without a window
+    virtual std::unique_ptr<ImGuiImpl> CreateImGui(IRenderDevice *pDevice, TEXTURE_FORMAT BackBufferFmt,
+                                                   TEXTURE_FORMAT DepthBufferFmt) = 0;
+
+    // Seconds since the platform was created
+    [[nodiscard]] double GetTime() const { return mTimer.GetElapsedTime(); }
+
+    void SetResizeHandler(std::function<void(Uint32 Width, Uint32 Height)> Handler) {
+        mResizeHandler = std::move(Handler);
+    }
+
+  protected:
+    void NotifyResize(Uint32 Width, Uint32 Height) {
+        if (mResizeHandler) {
+            mResizeHandler(Width, Height);
+        }
+    }
+
+  private:
+    Timer mTimer;
+    std::function<void(Uint32, Uint32)> mResizeHandler;
+};
+
+// nullptr when the platform is not compiled in
+std::unique_ptr<Platform> CreatePlatform(PlatformType Type);
+
+// Runs the application on the platform until its window closes and returns the exit code. The
+// engine must be initialized. With --headless (see HeadlessRunner.h) or the null platform no
+// window is created.
+int RunApplication(int argc, char **argv, PlatformType Type);
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Texture.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Collects the transitions a group of draws needs and issues them with one
+// TransitionResourceStates() call, after which the draws can bind with
+// RESOURCE_STATE_TRANSITION_MODE_VERIFY. Resources already in the requested state are skipped,
+// as are resources whose state is not tracked (e.g. dynamic buffers).
+class BarrierBatch {
+  public:
+    void Add(ITexture *pTexture, RESOURCE_STATE State) {
+        if (pTexture->IsInKnownState() && (pTexture->GetState() & State) == State) {
+            return;
+        }
+        Add(static_cast<IDeviceObject *>(pTexture), State);
+    }
+
+    void Add(IBuffer *pBuffer, RESOURCE_STATE State) {
+        if (!pBuffer->IsInKnownState() || (pBuffer->GetState() & State) == State) {
+            return;
+        }
+        Add(static_cast<IDeviceObject *>(pBuffer), State);
+    }
+
+    // Returns the number of transitions issued
+    Uint32 Flush(IDeviceContext *pCtx) {
+        const auto NumBarriers = static_cast<Uint32>(mBarriers.size());
+        if (NumBarriers != 0) {
+            pCtx->TransitionResourceStates(NumBarriers, mBarriers.data());
+            mBarriers.clear();
+        }
+        return NumBarriers;
+    }
+
+  private:
+    void Add(IDeviceObject *pResource, RESOURCE_STATE State) {
+        for (auto &Barrier: mBarriers) {
+            if (Barrier.pResource == pResource) {
+                // Several read states of one resource can be combined
+                Barrier.NewState = static_cast<RESOURCE_STATE>(Barrier.NewState | State);
+                return;
+            }
+        }
+
+        StateTransitionDesc Barrier;
+        Barrier.pResource = pResource;
+        Barrier.OldState = RESOURCE_STATE_UNKNOWN;
+        Barrier.NewState = State;
+        Barrier.Flags = STATE_TRANSITION_FLAG_UPDATE_STATE;
+        mBarriers.push_back(Barrier);
+    }
+
+  private:
+    std::vector<StateTransitionDesc> mBarriers;
+};
+
+}
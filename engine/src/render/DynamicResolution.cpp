@@ -0,0 +1,90 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace bt {
+
+namespace {
+
+// Weight of a new sample in the smoothed time
+constexpr double SmoothingFactor = 0.1;
+
+// Results are consumed a few frames after they were issued
+constexpr Uint32 NumBufferedQueries = 4;
+
+// Changes smaller than this are not worth a different render size
+constexpr float ScaleStep = 0.05f;
+
+}
+
+DynamicResolution::DynamicResolution(IRenderDevice *Device) {
+    const auto &Features = Device->GetDeviceInfo().Features;
+    if (Features.TimestampQueries || Features.DurationQueries) {
+        mQuery = std::make_unique<DurationQueryHelper>(Device, NumBufferedQueries);
+    }
+    mScale = mSettings.MaxScale;
+}
+
+DynamicResolution::~DynamicResolution() = default;
+
+void DynamicResolution::BeginMeasure(IDeviceContext *pCtx) {
+    if (mQuery) {
+        mQuery->Begin(pCtx);
+        mMeasuring = true;
+    }
+}
+
+void DynamicResolution::EndMeasure(IDeviceContext *pCtx) {
+    if (!mMeasuring) {
+        return;
+    }
+    mMeasuring = false;
+
+    double Duration = 0.0;
+    // Results that arrive right after a scale change were measured at the old scale
+    if (mQuery->End(pCtx, Duration) && mFramesSinceChange >= NumBufferedQueries) {
+        const auto TimeMs = Duration * 1000.0;
+        mSmoothedTimeMs = mSmoothedTimeMs == 0.0 ? TimeMs : mSmoothedTimeMs + (TimeMs - mSmoothedTimeMs) * SmoothingFactor;
+        mHasNewSample = true;
+    }
+}
+
+void DynamicResolution::Update() {
+    const auto MinScale = std::min(mSettings.MinScale, mSettings.MaxScale);
+    if (!mSettings.Enabled || !mQuery) {
+        mScale = mSettings.MaxScale;
+        return;
+    }
+
+    mScale = std::clamp(mScale, MinScale, mSettings.MaxScale);
+    ++mFramesSinceChange;
+    if (!mHasNewSample || mFramesSinceChange < mSettings.SettleFrames || mSmoothedTimeMs <= 0.0) {
+        return;
+    }
+    mHasNewSample = false;
+
+    const auto Target = static_cast<double>(mSettings.TargetTimeMs);
+    const bool OverBudget = mSmoothedTimeMs > Target * (1.0 + mSettings.Hysteresis);
+    const bool UnderBudget = mSmoothedTimeMs < Target * (1.0 - mSettings.Hysteresis);
+    if (!OverBudget && !UnderBudget) {
+        return;
+    }
+
+    // GPU time follows the pixel count, i.e. the square of the scale. Going up is capped so a
+    // briefly cheap frame does not overshoot.
+    auto Factor = static_cast<float>(std::sqrt(Target / mSmoothedTimeMs));
+    if (UnderBudget) {
+        Factor = std::min(Factor, 1.1f);
+    }
+
+    auto NewScale = std::round(mScale * Factor / ScaleStep) * ScaleStep;
+    NewScale = std::clamp(NewScale, MinScale, mSettings.MaxScale);
+    if (NewScale != mScale) {
+        mScale = NewScale;
+        mFramesSinceChange = 0;
+        mSmoothedTimeMs = 0.0;
+    }
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "DurationQueryHelper.hpp"
+
+namespace bt {
+
+using namespace Diligent;
+
+struct DynamicResolutionSettings {
+    bool Enabled = true;
+    // GPU time the measured pass should take
+    float TargetTimeMs = 8.f;
+    float MinScale = 0.5f;
+    float MaxScale = 1.f;
+    // No change while the smoothed time is within this fraction of the target
+    float Hysteresis = 0.1f;
+    // Frames to let a new scale show up in the measurements before changing it again
+    Uint32 SettleFrames = 8;
+};
+
+// Picks a resolution scale for a render pass from its measured GPU time. The time is read back
+// a few frames late through DurationQueryHelper and smoothed; the scale only moves when the time
+// leaves the hysteresis band around the target. Without GPU timing support the scale stays at
+// MaxScale.
+class DynamicResolution {
+  public:
+    explicit DynamicResolution(IRenderDevice *Device);
+
+    ~DynamicResolution();
+
+    // Bracket the commands of the pass
+    void BeginMeasure(IDeviceContext *pCtx);
+    void EndMeasure(IDeviceContext *pCtx);
+
+    // Called once per frame after the pass has been recorded
+    void Update();
+
+    [[nodiscard]] float GetScale() const { return mScale; }
+
+    [[nodiscard]] bool IsTimingSupported() const { return mQuery != nullptr; }
+
+    // Smoothed GPU time of the pass, 0 until the first result at the current scale arrives
+    [[nodiscard]] double GetGPUTimeMs() const { return mSmoothedTimeMs; }
+
+    [[nodiscard]] DynamicResolutionSettings &GetSettings() { return mSettings; }
+
+  private:
+    std::unique_ptr<DurationQueryHelper> mQuery;
+    DynamicResolutionSettings mSettings;
+
+    float mScale = 1.f;
+    double mSmoothedTimeMs = 0.0;
+    bool mMeasuring = false;
+    bool mHasNewSample = false;
+    Uint32 mFramesSinceChange = 0;
+};
+
+}
@@ -0,0 +1,47 @@
+#include "FrameSync.h"
+
+#include <algorithm>
+
+namespace bt {
+
+FrameSync::FrameSync(IRenderDevice *Device, IDeviceContext *Context, Uint32 NumFramesInFlight)
+    : mNumFramesInFlight(std::clamp(NumFramesInFlight, 2u, 3u)) {
+    m_pContext = Context;
+
+    FenceDesc Desc;
+    Desc.Name = "Frame fence";
+    Desc.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+    Device->CreateFence(Desc, &m_pFence);
+}
+
+void FrameSync::BeginFrame() {
+    // The frame that last used this slot must be done before its resources are touched again
+    if (mFrameIndex > mNumFramesInFlight) {
+        const auto SlotFrame = mFrameIndex - mNumFramesInFlight;
+        if (m_pFence->GetCompletedValue() < SlotFrame) {
+            m_pFence->Wait(SlotFrame);
+            ++mNumWaits;
+        }
+    }
+
+    ReleaseCompleted(m_pFence->GetCompletedValue());
+}
+
+void FrameSync::EndFrame() {
+    m_pContext->EnqueueSignal(m_pFence, mFrameIndex);
+    ++mFrameIndex;
+}
+
+void FrameSync::WaitIdle() {
+    m_pContext->WaitForIdle();
+    ReleaseCompleted(mFrameIndex);
+}
+
+void FrameSync::ReleaseCompleted(Uint64 CompletedFrame) {
+    // The queue is ordered by frame
+    while (!mReleaseQueue.empty() && mReleaseQueue.front().first <= CompletedFrame) {
+        mReleaseQueue.pop_front();
+    }
+}
+
+}
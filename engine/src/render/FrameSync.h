@@ -0,0 +1,72 @@
+#pragma once
+
+#include <deque>
+#include <utility>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Fence.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Paces the CPU against the GPU with a fence signalled at the end of every frame. The CPU may
+// record up to NumFramesInFlight frames ahead and only waits in BeginFrame() when it gets further
+// than that. Per-frame resource sets are indexed with GetFrameSlot(); objects the GPU may still
+// read are handed to DeferRelease() instead of being released directly.
+class FrameSync {
+  public:
+    // NumFramesInFlight is clamped to 2..3
+    FrameSync(IRenderDevice *Device, IDeviceContext *Context, Uint32 NumFramesInFlight);
+
+    // Waits for the GPU to retire the frame that used this frame's slot, then frees the objects
+    // that frame and earlier ones released
+    void BeginFrame();
+
+    // Must come before Present() so the signal is submitted with the frame
+    void EndFrame();
+
+    // Keeps Object alive until the GPU has finished every frame recorded so far
+    template<typename ObjectType>
+    void DeferRelease(RefCntAutoPtr<ObjectType> Object) {
+        if (Object) {
+            mReleaseQueue.emplace_back(mFrameIndex, RefCntAutoPtr<IObject>(Object.RawPtr()));
+        }
+    }
+
+    // Waits for the GPU to go idle and empties the release queue, e.g. before shutdown
+    void WaitIdle();
+
+    [[nodiscard]] Uint32 GetNumFramesInFlight() const { return mNumFramesInFlight; }
+
+    // Index of the frame being recorded, starting at 1
+    [[nodiscard]] Uint64 GetFrameIndex() const { return mFrameIndex; }
+
+    // Selects this frame's copy of a resource that exists once per frame in flight
+    [[nodiscard]] Uint32 GetFrameSlot() const { return static_cast<Uint32>(mFrameIndex % mNumFramesInFlight); }
+
+    // Last frame the GPU has finished
+    [[nodiscard]] Uint64 GetCompletedFrame() const { return m_pFence->GetCompletedValue(); }
+
+    [[nodiscard]] Uint32 GetNumPendingReleases() const { return static_cast<Uint32>(mReleaseQueue.size()); }
+
+    [[nodiscard]] Uint32 GetNumWaits() const { return mNumWaits; }
+
+  private:
+    void ReleaseCompleted(Uint64 CompletedFrame);
+
+  private:
+    RefCntAutoPtr<IDeviceContext> m_pContext;
+    RefCntAutoPtr<IFence> m_pFence;
+
+    Uint32 mNumFramesInFlight;
+    // Fence value of a frame is its index
+    Uint64 mFrameIndex = 1;
+    Uint32 mNumWaits = 0;
+
+    std::deque<std::pair<Uint64, RefCntAutoPtr<IObject>>> mReleaseQueue;
+};
+
+}
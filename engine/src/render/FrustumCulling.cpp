@@ -0,0 +1,419 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#    define BT_CULLING_AVX2 1
+#    include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define BT_CULLING_SSE 1
+#    include <emmintrin.h>
+#endif
+
+namespace bt {
+
+Frustum ExtractFrustum(const Matrix &ProjView) {
+    // GLM matrices are column-major, M[Col][Row]
+    auto Row = [&ProjView](int R) {
+        return Vector4(ProjView[0][R], ProjView[1][R], ProjView[2][R], ProjView[3][R]);
+    };
+
+    const Vector4 R0 = Row(0);
+    const Vector4 R1 = Row(1);
+    const Vector4 R2 = Row(2);
+    const Vector4 R3 = Row(3);
+
+    const Vector4 Planes[Frustum::NumPlanes] = {
+        R3 + R0, // left
+        R3 - R0, // right
+        R3 + R1, // bottom
+        R3 - R1, // top
+        R2,      // near, depth is in [0, 1]
+        R3 - R2  // far
+    };
+
+    Frustum Result;
+    for (Uint32 i = 0; i < Frustum::NumPlanes; ++i) {
+        const auto &P = Planes[i];
+        const double Len = glm::length(Vector(P.x, P.y, P.z));
+        const double InvLen = Len > 0.0 ? 1.0 / Len : 0.0;
+
+        Result.Planes[i].Nx = static_cast<float>(P.x * InvLen);
+        Result.Planes[i].Ny = static_cast<float>(P.y * InvLen);
+        Result.Planes[i].Nz = static_cast<float>(P.z * InvLen);
+        Result.Planes[i].D = static_cast<float>(P.w * InvLen);
+    }
+    return Result;
+}
+
+Uint32 BoundingBoxesSoA::Add(const Vector &Center, const Vector &Extent) {
+    const auto Idx = Size();
+    CenterX.push_back(0.f);
+    CenterY.push_back(0.f);
+    CenterZ.push_back(0.f);
+    ExtentX.push_back(0.f);
+    ExtentY.push_back(0.f);
+    ExtentZ.push_back(0.f);
+    Set(Idx, Center, Extent);
+    return Idx;
+}
+
+void BoundingBoxesSoA::Set(Uint32 Idx, const Vector &Center, const Vector &Extent) {
+    CenterX[Idx] = static_cast<float>(Center.x);
+    CenterY[Idx] = static_cast<float>(Center.y);
+    CenterZ[Idx] = static_cast<float>(Center.z);
+    ExtentX[Idx] = static_cast<float>(Extent.x);
+    ExtentY[Idx] = static_cast<float>(Extent.y);
+    ExtentZ[Idx] = static_cast<float>(Extent.z);
+}
+
+void BoundingBoxesSoA::Reserve(size_t Count) {
+    CenterX.reserve(Count);
+    CenterY.reserve(Count);
+    CenterZ.reserve(Count);
+    ExtentX.reserve(Count);
+    ExtentY.reserve(Count);
+    ExtentZ.reserve(Count);
+}
+
+void BoundingBoxesSoA::Clear() {
+    CenterX.clear();
+    CenterY.clear();
+    CenterZ.clear();
+    ExtentX.clear();
+    ExtentY.clear();
+    ExtentZ.clear();
+}
+
+Uint32 BoundingSpheresSoA::Add(const Vector &Center, float R) {
+    const auto Idx = Size();
+    CenterX.push_back(0.f);
+    CenterY.push_back(0.f);
+    CenterZ.push_back(0.f);
+    Radius.push_back(0.f);
+    Set(Idx, Center, R);
+    return Idx;
+}
+
+void BoundingSpheresSoA::Set(Uint32 Idx, const Vector &Center, float R) {
+    CenterX[Idx] = static_cast<float>(Center.x);
+    CenterY[Idx] = static_cast<float>(Center.y);
+    CenterZ[Idx] = static_cast<float>(Center.z);
+    Radius[Idx] = R;
+}
+
+void BoundingSpheresSoA::Reserve(size_t Count) {
+    CenterX.reserve(Count);
+    CenterY.reserve(Count);
+    CenterZ.reserve(Count);
+    Radius.reserve(Count);
+}
+
+void BoundingSpheresSoA::Clear() {
+    CenterX.clear();
+    CenterY.clear();
+    CenterZ.clear();
+    Radius.clear();
+}
+
+namespace {
+
+// Branchless compaction: every lane is written, but the output pointer only advances for visible ones.
+// The write position never overtakes the source index, so an output sized to the input count is enough.
+inline Uint32 *WriteVisible(Uint32 Mask, Uint32 NumLanes, Uint32 BaseIdx, Uint32 *pOut) {
+    if (Mask == 0)
+        return pOut;
+    for (Uint32 Lane = 0; Lane < NumLanes; ++Lane) {
+        *pOut = BaseIdx + Lane;
+        pOut += (Mask >> Lane) & 1u;
+    }
+    return pOut;
+}
+
+Uint32 *CullBoxesScalar(const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, Uint32 First, Uint32 Last,
+                        Uint32 *pOut) {
+    for (Uint32 i = First; i < Last; ++i) {
+        bool Visible = true;
+        for (const auto &P: ViewFrustum.Planes) {
+            const float Dist = P.Nx * Boxes.CenterX[i] + P.Ny * Boxes.CenterY[i] + P.Nz * Boxes.CenterZ[i] + P.D;
+            const float Radius = std::fabs(P.Nx) * Boxes.ExtentX[i] + std::fabs(P.Ny) * Boxes.ExtentY[i] +
+                                 std::fabs(P.Nz) * Boxes.ExtentZ[i];
+            Visible = Visible && (Dist + Radius >= 0.f);
+        }
+        *pOut = i;
+        pOut += Visible ? 1 : 0;
+    }
+    return pOut;
+}
+
+Uint32 *CullSpheresScalar(const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, Uint32 First,
+                          Uint32 Last, Uint32 *pOut) {
+    for (Uint32 i = First; i < Last; ++i) {
+        bool Visible = true;
+        for (const auto &P: ViewFrustum.Planes) {
+            const float Dist =
+                P.Nx * Spheres.CenterX[i] + P.Ny * Spheres.CenterY[i] + P.Nz * Spheres.CenterZ[i] + P.D;
+            Visible = Visible && (Dist + Spheres.Radius[i] >= 0.f);
+        }
+        *pOut = i;
+        pOut += Visible ? 1 : 0;
+    }
+    return pOut;
+}
+
+#if BT_CULLING_SSE
+Uint32 *CullBoxesSSE(const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, Uint32 First, Uint32 Last,
+                     Uint32 *pOut) {
+    const Uint32 PackedEnd = First + ((Last - First) & ~3u);
+    const __m128 SignMask = _mm_set1_ps(-0.f);
+    const __m128 Zero = _mm_setzero_ps();
+
+    __m128 Nx[Frustum::NumPlanes], Ny[Frustum::NumPlanes], Nz[Frustum::NumPlanes], D[Frustum::NumPlanes];
+    __m128 Ax[Frustum::NumPlanes], Ay[Frustum::NumPlanes], Az[Frustum::NumPlanes];
+    for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+        Nx[p] = _mm_set1_ps(ViewFrustum.Planes[p].Nx);
+        Ny[p] = _mm_set1_ps(ViewFrustum.Planes[p].Ny);
+        Nz[p] = _mm_set1_ps(ViewFrustum.Planes[p].Nz);
+        D[p] = _mm_set1_ps(ViewFrustum.Planes[p].D);
+        Ax[p] = _mm_andnot_ps(SignMask, Nx[p]);
+        Ay[p] = _mm_andnot_ps(SignMask, Ny[p]);
+        Az[p] = _mm_andnot_ps(SignMask, Nz[p]);
+    }
+
+    for (Uint32 i = First; i < PackedEnd; i += 4) {
+        const __m128 Cx = _mm_loadu_ps(Boxes.CenterX.data() + i);
+        const __m128 Cy = _mm_loadu_ps(Boxes.CenterY.data() + i);
+        const __m128 Cz = _mm_loadu_ps(Boxes.CenterZ.data() + i);
+        const __m128 Ex = _mm_loadu_ps(Boxes.ExtentX.data() + i);
+        const __m128 Ey = _mm_loadu_ps(Boxes.ExtentY.data() + i);
+        const __m128 Ez = _mm_loadu_ps(Boxes.ExtentZ.data() + i);
+
+        __m128 Visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+            __m128 Dist = _mm_add_ps(_mm_mul_ps(Nx[p], Cx), D[p]);
+            Dist = _mm_add_ps(Dist, _mm_mul_ps(Ny[p], Cy));
+            Dist = _mm_add_ps(Dist, _mm_mul_ps(Nz[p], Cz));
+            __m128 Radius = _mm_mul_ps(Ax[p], Ex);
+            Radius = _mm_add_ps(Radius, _mm_mul_ps(Ay[p], Ey));
+            Radius = _mm_add_ps(Radius, _mm_mul_ps(Az[p], Ez));
+            Visible = _mm_and_ps(Visible, _mm_cmpge_ps(_mm_add_ps(Dist, Radius), Zero));
+        }
+        pOut = WriteVisible(static_cast<Uint32>(_mm_movemask_ps(Visible)), 4, i, pOut);
+    }
+
+    return CullBoxesScalar(ViewFrustum, Boxes, PackedEnd, Last, pOut);
+}
+
+Uint32 *CullSpheresSSE(const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, Uint32 First,
+                       Uint32 Last, Uint32 *pOut) {
+    const Uint32 PackedEnd = First + ((Last - First) & ~3u);
+    const __m128 Zero = _mm_setzero_ps();
+
+    __m128 Nx[Frustum::NumPlanes], Ny[Frustum::NumPlanes], Nz[Frustum::NumPlanes], D[Frustum::NumPlanes];
+    for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+        Nx[p] = _mm_set1_ps(ViewFrustum.Planes[p].Nx);
+        Ny[p] = _mm_set1_ps(ViewFrustum.Planes[p].Ny);
+        Nz[p] = _mm_set1_ps(ViewFrustum.Planes[p].Nz);
+        D[p] = _mm_set1_ps(ViewFrustum.Planes[p].D);
+    }
+
+    for (Uint32 i = First; i < PackedEnd; i += 4) {
+        const __m128 Cx = _mm_loadu_ps(Spheres.CenterX.data() + i);
+        const __m128 Cy = _mm_loadu_ps(Spheres.CenterY.data() + i);
+        const __m128 Cz = _mm_loadu_ps(Spheres.CenterZ.data() + i);
+        const __m128 R = _mm_loadu_ps(Spheres.Radius.data() + i);
+
+        __m128 Visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+            __m128 Dist = _mm_add_ps(_mm_mul_ps(Nx[p], Cx), D[p]);
+            Dist = _mm_add_ps(Dist, _mm_mul_ps(Ny[p], Cy));
+            Dist = _mm_add_ps(Dist, _mm_mul_ps(Nz[p], Cz));
+            Visible = _mm_and_ps(Visible, _mm_cmpge_ps(_mm_add_ps(Dist, R), Zero));
+        }
+        pOut = WriteVisible(static_cast<Uint32>(_mm_movemask_ps(Visible)), 4, i, pOut);
+    }
+
+    return CullSpheresScalar(ViewFrustum, Spheres, PackedEnd, Last, pOut);
+}
+#endif
+
+#if BT_CULLING_AVX2
+Uint32 *CullBoxesAVX2(const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, Uint32 First, Uint32 Last,
+                      Uint32 *pOut) {
+    const Uint32 PackedEnd = First + ((Last - First) & ~7u);
+    const __m256 SignMask = _mm256_set1_ps(-0.f);
+    const __m256 Zero = _mm256_setzero_ps();
+
+    __m256 Nx[Frustum::NumPlanes], Ny[Frustum::NumPlanes], Nz[Frustum::NumPlanes], D[Frustum::NumPlanes];
+    __m256 Ax[Frustum::NumPlanes], Ay[Frustum::NumPlanes], Az[Frustum::NumPlanes];
+    for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+        Nx[p] = _mm256_set1_ps(ViewFrustum.Planes[p].Nx);
+        Ny[p] = _mm256_set1_ps(ViewFrustum.Planes[p].Ny);
+        Nz[p] = _mm256_set1_ps(ViewFrustum.Planes[p].Nz);
+        D[p] = _mm256_set1_ps(ViewFrustum.Planes[p].D);
+        Ax[p] = _mm256_andnot_ps(SignMask, Nx[p]);
+        Ay[p] = _mm256_andnot_ps(SignMask, Ny[p]);
+        Az[p] = _mm256_andnot_ps(SignMask, Nz[p]);
+    }
+
+    for (Uint32 i = First; i < PackedEnd; i += 8) {
+        const __m256 Cx = _mm256_loadu_ps(Boxes.CenterX.data() + i);
+        const __m256 Cy = _mm256_loadu_ps(Boxes.CenterY.data() + i);
+        const __m256 Cz = _mm256_loadu_ps(Boxes.CenterZ.data() + i);
+        const __m256 Ex = _mm256_loadu_ps(Boxes.ExtentX.data() + i);
+        const __m256 Ey = _mm256_loadu_ps(Boxes.ExtentY.data() + i);
+        const __m256 Ez = _mm256_loadu_ps(Boxes.ExtentZ.data() + i);
+
+        __m256 Visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+            __m256 Dist = _mm256_fmadd_ps(Nx[p], Cx, D[p]);
+            Dist = _mm256_fmadd_ps(Ny[p], Cy, Dist);
+            Dist = _mm256_fmadd_ps(Nz[p], Cz, Dist);
+            __m256 Radius = _mm256_mul_ps(Ax[p], Ex);
+            Radius = _mm256_fmadd_ps(Ay[p], Ey, Radius);
+            Radius = _mm256_fmadd_ps(Az[p], Ez, Radius);
+            Visible = _mm256_and_ps(Visible, _mm256_cmp_ps(_mm256_add_ps(Dist, Radius), Zero, _CMP_GE_OQ));
+        }
+        pOut = WriteVisible(static_cast<Uint32>(_mm256_movemask_ps(Visible)), 8, i, pOut);
+    }
+
+    return CullBoxesScalar(ViewFrustum, Boxes, PackedEnd, Last, pOut);
+}
+
+Uint32 *CullSpheresAVX2(const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, Uint32 First,
+                        Uint32 Last, Uint32 *pOut) {
+    const Uint32 PackedEnd = First + ((Last - First) & ~7u);
+    const __m256 Zero = _mm256_setzero_ps();
+
+    __m256 Nx[Frustum::NumPlanes], Ny[Frustum::NumPlanes], Nz[Frustum::NumPlanes], D[Frustum::NumPlanes];
+    for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+        Nx[p] = _mm256_set1_ps(ViewFrustum.Planes[p].Nx);
+        Ny[p] = _mm256_set1_ps(ViewFrustum.Planes[p].Ny);
+        Nz[p] = _mm256_set1_ps(ViewFrustum.Planes[p].Nz);
+        D[p] = _mm256_set1_ps(ViewFrustum.Planes[p].D);
+    }
+
+    for (Uint32 i = First; i < PackedEnd; i += 8) {
+        const __m256 Cx = _mm256_loadu_ps(Spheres.CenterX.data() + i);
+        const __m256 Cy = _mm256_loadu_ps(Spheres.CenterY.data() + i);
+        const __m256 Cz = _mm256_loadu_ps(Spheres.CenterZ.data() + i);
+        const __m256 R = _mm256_loadu_ps(Spheres.Radius.data() + i);
+
+        __m256 Visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (Uint32 p = 0; p < Frustum::NumPlanes; ++p) {
+            __m256 Dist = _mm256_fmadd_ps(Nx[p], Cx, D[p]);
+            Dist = _mm256_fmadd_ps(Ny[p], Cy, Dist);
+            Dist = _mm256_fmadd_ps(Nz[p], Cz, Dist);
+            Visible = _mm256_and_ps(Visible, _mm256_cmp_ps(_mm256_add_ps(Dist, R), Zero, _CMP_GE_OQ));
+        }
+        pOut = WriteVisible(static_cast<Uint32>(_mm256_movemask_ps(Visible)), 8, i, pOut);
+    }
+
+    return CullSpheresScalar(ViewFrustum, Spheres, PackedEnd, Last, pOut);
+}
+#endif
+
+CullingKernel ResolveKernel(CullingKernel Kernel) {
+    const auto Best = GetCullingKernel();
+    return static_cast<Uint8>(Kernel) > static_cast<Uint8>(Best) ? Best : Kernel;
+}
+
+}
+
+CullingKernel GetCullingKernel() {
+#if BT_CULLING_AVX2
+    return CullingKernel::AVX2;
+#elif BT_CULLING_SSE
+    return CullingKernel::SSE;
+#else
+    return CullingKernel::Scalar;
+#endif
+}
+
+const char *GetCullingKernelName(CullingKernel Kernel) {
+    switch (Kernel) {
+        case CullingKernel::Scalar:
+            return "Scalar";
+        case CullingKernel::SSE:
+            return "SSE";
+        case CullingKernel::AVX2:
+            return "AVX2";
+    }
+    return "Unknown";
+}
+
+Uint32 CullBoxes(const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, std::vector<Uint32> &OutVisible) {
+    return CullBoxes(GetCullingKernel(), ViewFrustum, Boxes, OutVisible);
+}
+
+Uint32 CullSpheres(const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, std::vector<Uint32> &OutVisible) {
+    return CullSpheres(GetCullingKernel(), ViewFrustum, Spheres, OutVisible);
+}
+
+Uint32 CullBoxes(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes,
+                 std::vector<Uint32> &OutVisible) {
+    OutVisible.resize(Boxes.Size());
+    const auto NumVisible = CullBoxes(Kernel, ViewFrustum, Boxes, 0, Boxes.Size(), OutVisible.data());
+    OutVisible.resize(NumVisible);
+    return NumVisible;
+}
+
+Uint32 CullSpheres(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres,
+                   std::vector<Uint32> &OutVisible) {
+    OutVisible.resize(Spheres.Size());
+    const auto NumVisible = CullSpheres(Kernel, ViewFrustum, Spheres, 0, Spheres.Size(), OutVisible.data());
+    OutVisible.resize(NumVisible);
+    return NumVisible;
+}
+
+Uint32 CullBoxes(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, Uint32 First,
+                 Uint32 Count, Uint32 *pOutVisible) {
+    const Uint32 Last = First + Count;
+    Uint32 *pEnd = pOutVisible;
+
+    switch (ResolveKernel(Kernel)) {
+#if BT_CULLING_AVX2
+        case CullingKernel::AVX2:
+            pEnd = CullBoxesAVX2(ViewFrustum, Boxes, First, Last, pOutVisible);
+            break;
+#endif
+#if BT_CULLING_SSE
+        case CullingKernel::SSE:
+            pEnd = CullBoxesSSE(ViewFrustum, Boxes, First, Last, pOutVisible);
+            break;
+#endif
+        default:
+            pEnd = CullBoxesScalar(ViewFrustum, Boxes, First, Last, pOutVisible);
+            break;
+    }
+
+    return static_cast<Uint32>(pEnd - pOutVisible);
+}
+
+Uint32 CullSpheres(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, Uint32 First,
+                   Uint32 Count, Uint32 *pOutVisible) {
+    const Uint32 Last = First + Count;
+    Uint32 *pEnd = pOutVisible;
+
+    switch (ResolveKernel(Kernel)) {
+#if BT_CULLING_AVX2
+        case CullingKernel::AVX2:
+            pEnd = CullSpheresAVX2(ViewFrustum, Spheres, First, Last, pOutVisible);
+            break;
+#endif
+#if BT_CULLING_SSE
+        case CullingKernel::SSE:
+            pEnd = CullSpheresSSE(ViewFrustum, Spheres, First, Last, pOutVisible);
+            break;
+#endif
+        default:
+            pEnd = CullSpheresScalar(ViewFrustum, Spheres, First, Last, pOutVisible);
+            break;
+    }
+
+    return static_cast<Uint32>(pEnd - pOutVisible);
+}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "core/Math.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Plane in the form dot(N, P) + D, positive half-space is inside of the frustum
+struct FrustumPlane {
+    float Nx = 0.f;
+    float Ny = 0.f;
+    float Nz = 0.f;
+    float D = 0.f;
+};
+
+struct Frustum {
+    enum PlaneIdx : Uint32 {
+        Left = 0,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        NumPlanes
+    };
+
+    FrustumPlane Planes[NumPlanes];
+};
+
+// Extracts normalized frustum planes from the projection-view matrix.
+// Expects zero-to-one clip space depth (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+Frustum ExtractFrustum(const Matrix &ProjView);
+
+// Axis-aligned bounding boxes stored as structure of arrays, so the culling
+// kernel can load 8 boxes per register without any shuffling.
+struct BoundingBoxesSoA {
+    std::vector<float> CenterX;
+    std::vector<float> CenterY;
+    std::vector<float> CenterZ;
+    std::vector<float> ExtentX;
+    std::vector<float> ExtentY;
+    std::vector<float> ExtentZ;
+
+    [[nodiscard]] Uint32 Size() const { return static_cast<Uint32>(CenterX.size()); }
+
+    Uint32 Add(const Vector &Center, const Vector &Extent);
+
+    void Set(Uint32 Idx, const Vector &Center, const Vector &Extent);
+
+    void Reserve(size_t Count);
+
+    void Clear();
+};
+
+struct BoundingSpheresSoA {
+    std::vector<float> CenterX;
+    std::vector<float> CenterY;
+    std::vector<float> CenterZ;
+    std::vector<float> Radius;
+
+    [[nodiscard]] Uint32 Size() const { return static_cast<Uint32>(CenterX.size()); }
+
+    Uint32 Add(const Vector &Center, float R);
+
+    void Set(Uint32 Idx, const Vector &Center, float R);
+
+    void Reserve(size_t Count);
+
+    void Clear();
+};
+
+enum class CullingKernel : Uint8 {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+// Best kernel this binary was compiled with (see ENGINE_ENABLE_AVX2 in CMakeLists.txt)
+CullingKernel GetCullingKernel();
+
+const char *GetCullingKernelName(CullingKernel Kernel);
+
+// Tests every box against the six frustum planes and writes indices of visible ones
+// into OutVisible (in ascending order). Returns the number of visible boxes.
+// Does not touch the GPU, so it is safe to call from worker threads and tools.
+Uint32 CullBoxes(const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, std::vector<Uint32> &OutVisible);
+
+Uint32 CullSpheres(const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, std::vector<Uint32> &OutVisible);
+
+// Same as above with explicitly selected kernel, used by the benchmark to compare code paths.
+// Requesting a kernel that is not compiled in falls back to the best available one.
+Uint32 CullBoxes(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes,
+                 std::vector<Uint32> &OutVisible);
+
+Uint32 CullSpheres(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres,
+                   std::vector<Uint32> &OutVisible);
+
+// Culls the [First, First + Count) slice, so several threads can cull one array in parallel.
+// pOutVisible must have room for Count indices.
+Uint32 CullBoxes(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingBoxesSoA &Boxes, Uint32 First,
+                 Uint32 Count, Uint32 *pOutVisible);
+
+Uint32 CullSpheres(CullingKernel Kernel, const Frustum &ViewFrustum, const BoundingSpheresSoA &Spheres, Uint32 First,
+                   Uint32 Count, Uint32 *pOutVisible);
+
+}
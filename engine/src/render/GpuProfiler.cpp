@@ -0,0 +1,214 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+
+#include "core/Logging.h"
+#include "fmt/core.h"
+#include "imgui.h"
+
+namespace bt {
+
+namespace {
+
+// Frames shown in the graphs
+constexpr Uint32 HistorySize = 240;
+
+// Queries per scope beyond the frames in flight, results of a frame usually arrive by then
+constexpr Uint32 ExtraQuerySlots = 2;
+
+}
+
+GpuProfiler::GpuProfiler(IRenderDevice *Device, Uint32 NumFramesInFlight)
+    : mNumSlots(NumFramesInFlight + ExtraQuerySlots) {
+    m_pDevice = Device;
+
+    const auto &Features = m_pDevice->GetDeviceInfo().Features;
+    if (Features.DurationQueries) {
+        mMode = Mode::Duration;
+    } else if (Features.TimestampQueries) {
+        mMode = Mode::Timestamp;
+    } else {
+        log::Warning("GPU profiler: the device supports neither duration nor timestamp queries");
+    }
+}
+
+GpuProfiler::~GpuProfiler() {
+    StopCapture();
+}
+
+GpuProfiler::Scope &GpuProfiler::FindScope(const char *Name) {
+    for (auto &S: mScopes) {
+        if (S.Name == Name) {
+            return S;
+        }
+    }
+
+    mScopes.emplace_back();
+    auto &S = mScopes.back();
+    S.Name = Name;
+    S.Slots.resize(mNumSlots);
+    S.History.resize(HistorySize, 0.f);
+    return S;
+}
+
+RefCntAutoPtr<IQuery> GpuProfiler::CreateQuery(const std::string &Name) const {
+    const auto QueryName = fmt::format("GPU profiler: {}", Name);
+    QueryDesc Desc;
+    Desc.Name = QueryName.c_str();
+    Desc.Type = mMode == Mode::Duration ? QUERY_TYPE_DURATION : QUERY_TYPE_TIMESTAMP;
+
+    RefCntAutoPtr<IQuery> pQuery;
+    m_pDevice->CreateQuery(Desc, &pQuery);
+    return pQuery;
+}
+
+void GpuProfiler::BeginScope(IDeviceContext *pCtx, const char *Name) {
+    if (!IsSupported()) {
+        return;
+    }
+
+    auto &S = FindScope(Name);
+    S.Nested = !mScopeStack.empty();
+    mScopeStack.push_back(static_cast<Uint32>(&S - mScopes.data()));
+
+    auto &Slot = S.Slots[S.NextSlot];
+    if (Slot.Pending) {
+        // The GPU is further behind than the ring is deep, reading the slot now would stall
+        S.ActiveSlot = ~0u;
+        ++S.NumSkipped;
+        return;
+    }
+
+    if (!Slot.Begin) {
+        Slot.Begin = CreateQuery(S.Name);
+        if (mMode == Mode::Timestamp) {
+            Slot.End = CreateQuery(S.Name);
+        }
+    }
+
+    if (mMode == Mode::Duration) {
+        pCtx->BeginQuery(Slot.Begin);
+    } else {
+        pCtx->EndQuery(Slot.Begin);
+    }
+    S.ActiveSlot = S.NextSlot;
+    S.NextSlot = (S.NextSlot + 1) % mNumSlots;
+}
+
+void GpuProfiler::EndScope(IDeviceContext *pCtx) {
+    if (mScopeStack.empty()) {
+        return;
+    }
+
+    auto &S = mScopes[mScopeStack.back()];
+    mScopeStack.pop_back();
+    if (S.ActiveSlot == ~0u) {
+        return;
+    }
+
+    auto &Slot = S.Slots[S.ActiveSlot];
+    pCtx->EndQuery(mMode == Mode::Duration ? Slot.Begin.RawPtr() : Slot.End.RawPtr());
+    Slot.Frame = mFrameIndex;
+    Slot.Pending = true;
+    S.ActiveSlot = ~0u;
+}
+
+bool GpuProfiler::ReadSlot(QuerySlot &Slot, double &OutMs) const {
+    if (mMode == Mode::Duration) {
+        QueryDataDuration Data;
+        if (!Slot.Begin->GetData(&Data, sizeof(Data))) {
+            return false;
+        }
+        OutMs = Data.Frequency != 0 ? static_cast<double>(Data.Duration) * 1000.0 / static_cast<double>(Data.Frequency) : 0.0;
+        return true;
+    }
+
+    // Both timestamps must be read in the same call, GetData() invalidates the query
+    QueryDataTimestamp BeginData;
+    QueryDataTimestamp EndData;
+    if (!Slot.End->GetData(&EndData, sizeof(EndData), false) || !Slot.Begin->GetData(&BeginData, sizeof(BeginData))) {
+        return false;
+    }
+    Slot.End->Invalidate();
+    const auto Ticks = EndData.Counter > BeginData.Counter ? EndData.Counter - BeginData.Counter : 0;
+    OutMs = EndData.Frequency != 0 ? static_cast<double>(Ticks) * 1000.0 / static_cast<double>(EndData.Frequency) : 0.0;
+    return true;
+}
+
+void GpuProfiler::EndFrame() {
+    if (!mScopeStack.empty()) {
+        log::Warning(fmt::format("GPU profiler: scope '{}' was not ended", mScopes[mScopeStack.back()].Name));
+        mScopeStack.clear();
+    }
+
+    for (auto &S: mScopes) {
+        // Slots are read oldest first so the history stays in frame order
+        for (Uint32 i = 0; i < mNumSlots; ++i) {
+            auto &Slot = S.Slots[(S.NextSlot + i) % mNumSlots];
+            double TimeMs = 0.0;
+            if (!Slot.Pending || !ReadSlot(Slot, TimeMs)) {
+                continue;
+            }
+            Slot.Pending = false;
+
+            S.History[S.HistoryOffset] = static_cast<float>(TimeMs);
+            S.HistoryOffset = (S.HistoryOffset + 1) % HistorySize;
+            S.NumSamples = std::min(S.NumSamples + 1, HistorySize);
+            if (mCapture.is_open()) {
+                mCapture << Slot.Frame << ',' << S.Name << ',' << TimeMs << '\n';
+            }
+        }
+    }
+
+    ++mFrameIndex;
+}
+
+bool GpuProfiler::StartCapture(const std::string &Path) {
+    StopCapture();
+    mCapture.open(Path, std::ios::trunc);
+    if (!mCapture) {
+        log::Error(fmt::format("GPU profiler: failed to open {}", Path));
+        return false;
+    }
+    mCapture << "frame,scope,gpu_ms\n";
+    log::Info(fmt::format("GPU profiler: writing timings to {}", Path));
+    return true;
+}
+
+void GpuProfiler::StopCapture() {
+    if (mCapture.is_open()) {
+        mCapture.close();
+    }
+}
+
+void GpuProfiler::DrawImGui() {
+    if (!IsSupported()) {
+        ImGui::Text("GPU timing unavailable on this device");
+        return;
+    }
+
+    float TotalMs = 0.f;
+    for (const auto &S: mScopes) {
+        float SumMs = 0.f;
+        float MaxMs = 0.f;
+        for (const auto TimeMs: S.History) {
+            SumMs += TimeMs;
+            MaxMs = std::max(MaxMs, TimeMs);
+        }
+        const auto AvgMs = S.NumSamples != 0 ? SumMs / static_cast<float>(S.NumSamples) : 0.f;
+        if (!S.Nested) {
+            TotalMs += AvgMs;
+        }
+
+        const auto Overlay = fmt::format("{}: {:.3f} ms avg, {:.3f} max", S.Name, AvgMs, MaxMs);
+        ImGui::PlotLines(fmt::format("##{}", S.Name).c_str(), S.History.data(), static_cast<int>(HistorySize),
+                         static_cast<int>(S.HistoryOffset), Overlay.c_str(), 0.f, std::max(MaxMs * 1.2f, 0.1f),
+                         ImVec2(-1.f, 48.f));
+        if (S.NumSkipped != 0) {
+            ImGui::Text("%u measurements skipped while the GPU was behind", S.NumSkipped);
+        }
+    }
+    ImGui::Text("Total: %.3f ms", TotalMs);
+}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// GPU time of named scopes, e.g. render graph passes. Every scope owns a small ring of queries
+// so results are read back frames later without waiting on the GPU; a scope whose oldest query
+// is still pending skips the measurement instead of stalling. Duration queries are used where
+// available, pairs of timestamps otherwise.
+class GpuProfiler {
+  public:
+    GpuProfiler(IRenderDevice *Device, Uint32 NumFramesInFlight);
+
+    ~GpuProfiler();
+
+    [[nodiscard]] bool IsSupported() const { return mMode != Mode::None; }
+
+    // Scopes may nest and are matched by name across frames
+    void BeginScope(IDeviceContext *pCtx, const char *Name);
+    void EndScope(IDeviceContext *pCtx);
+
+    // Collects the results that have arrived, call once per frame after the last scope
+    void EndFrame();
+
+    // Every resolved measurement is appended to Path as a "frame,scope,gpu_ms" row
+    bool StartCapture(const std::string &Path);
+    void StopCapture();
+    [[nodiscard]] bool IsCapturing() const { return mCapture.is_open(); }
+
+    // Rolling graph and average of every scope in the current ImGui window, the total adds up
+    // the top-level scopes only
+    void DrawImGui();
+
+  private:
+    enum class Mode {
+        None,
+        Duration,
+        Timestamp,
+    };
+
+    struct QuerySlot {
+        RefCntAutoPtr<IQuery> Begin;
+        // Only used with timestamps
+        RefCntAutoPtr<IQuery> End;
+        Uint64 Frame = 0;
+        bool Pending = false;
+    };
+
+    struct Scope {
+        std::string Name;
+        std::vector<QuerySlot> Slots;
+        Uint32 NextSlot = 0;
+        // Slot written this frame or ~0u when the measurement was skipped
+        Uint32 ActiveSlot = ~0u;
+        // Milliseconds, ring of HistorySize entries ending at HistoryOffset
+        std::vector<float> History;
+        Uint32 HistoryOffset = 0;
+        // History entries written so far, at most HistorySize
+        Uint32 NumSamples = 0;
+        Uint32 NumSkipped = 0;
+        // Begun inside another scope the last time, its time is already part of that scope's
+        bool Nested = false;
+    };
+
+    Scope &FindScope(const char *Name);
+
+    RefCntAutoPtr<IQuery> CreateQuery(const std::string &Name) const;
+
+    // False while the GPU has not finished the slot
+    bool ReadSlot(QuerySlot &Slot, double &OutMs) const;
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    Mode mMode = Mode::None;
+    Uint32 mNumSlots;
+
+    std::vector<Scope> mScopes;
+    std::vector<Uint32> mScopeStack;
+    Uint64 mFrameIndex = 0;
+
+    std::ofstream mCapture;
+};
+
+}
@@ -0,0 +1,89 @@
+#include "ImageCompare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#include "core/Logging.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+bool SaveImagePPM(const std::string &Path, const Image &Img) {
+    std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+    File << "P6\n" << Img.Width << ' ' << Img.Height << "\n255\n";
+
+    std::vector<Uint8> Row(Img.Width * 3);
+    for (Uint32 y = 0; y < Img.Height; ++y) {
+        const auto *pSrc = &Img.Pixels[static_cast<size_t>(y) * Img.Width * 4];
+        for (Uint32 x = 0; x < Img.Width; ++x) {
+            Row[x * 3 + 0] = pSrc[x * 4 + 0];
+            Row[x * 3 + 1] = pSrc[x * 4 + 1];
+            Row[x * 3 + 2] = pSrc[x * 4 + 2];
+        }
+        File.write(reinterpret_cast<const char *>(Row.data()), static_cast<std::streamsize>(Row.size()));
+    }
+
+    if (!File) {
+        log::Error(fmt::format("Failed to write {}", Path));
+        return false;
+    }
+    return true;
+}
+
+bool LoadImagePPM(const std::string &Path, Image &OutImg) {
+    std::ifstream File(Path, std::ios::binary);
+    std::string Magic;
+    Uint32 MaxValue = 0;
+    File >> Magic >> OutImg.Width >> OutImg.Height >> MaxValue;
+    // Exactly one whitespace character separates the header from the data
+    File.get();
+    if (!File || Magic != "P6" || MaxValue != 255) {
+        log::Error(fmt::format("{} is not an 8-bit binary PPM", Path));
+        return false;
+    }
+
+    std::vector<Uint8> Data(static_cast<size_t>(OutImg.Width) * OutImg.Height * 3);
+    File.read(reinterpret_cast<char *>(Data.data()), static_cast<std::streamsize>(Data.size()));
+    if (!File) {
+        log::Error(fmt::format("{} is truncated", Path));
+        return false;
+    }
+
+    OutImg.Pixels.resize(static_cast<size_t>(OutImg.Width) * OutImg.Height * 4);
+    for (size_t i = 0, Count = Data.size() / 3; i < Count; ++i) {
+        OutImg.Pixels[i * 4 + 0] = Data[i * 3 + 0];
+        OutImg.Pixels[i * 4 + 1] = Data[i * 3 + 1];
+        OutImg.Pixels[i * 4 + 2] = Data[i * 3 + 2];
+        OutImg.Pixels[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+ImageDiff CompareImages(const Image &Result, const Image &Golden, Uint32 Tolerance) {
+    ImageDiff Diff;
+    if (Result.Width != Golden.Width || Result.Height != Golden.Height) {
+        Diff.SizeMismatch = true;
+        return Diff;
+    }
+
+    double SumSquares = 0.0;
+    const size_t NumPixels = static_cast<size_t>(Result.Width) * Result.Height;
+    for (size_t i = 0; i < NumPixels; ++i) {
+        Uint32 PixelMax = 0;
+        for (size_t c = 0; c < 3; ++c) {
+            const auto Delta = static_cast<Uint32>(std::abs(Result.Pixels[i * 4 + c] - Golden.Pixels[i * 4 + c]));
+            PixelMax = std::max(PixelMax, Delta);
+            SumSquares += static_cast<double>(Delta * Delta);
+        }
+        Diff.MaxDifference = std::max(Diff.MaxDifference, PixelMax);
+        if (PixelMax > Tolerance) {
+            ++Diff.NumDifferingPixels;
+        }
+    }
+    Diff.RootMeanSquare = NumPixels != 0 ? std::sqrt(SumSquares / static_cast<double>(NumPixels * 3)) : 0.0;
+    return Diff;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Tightly packed 8-bit RGBA image
+struct Image {
+    Uint32 Width = 0;
+    Uint32 Height = 0;
+    std::vector<Uint8> Pixels;
+};
+
+struct ImageDiff {
+    bool SizeMismatch = false;
+    // Largest per-channel difference over all pixels
+    Uint32 MaxDifference = 0;
+    // Pixels with a channel differing by more than the tolerance
+    Uint64 NumDifferingPixels = 0;
+    double RootMeanSquare = 0.0;
+};
+
+// Binary PPM (P6), alpha is dropped on save and set to 255 on load. The format needs no
+// image library and is readable by every image viewer and diff tool.
+bool SaveImagePPM(const std::string &Path, const Image &Img);
+bool LoadImagePPM(const std::string &Path, Image &OutImg);
+
+// Alpha is not compared, it is not stored in the golden images
+ImageDiff CompareImages(const Image &Result, const Image &Golden, Uint32 Tolerance);
+
+}
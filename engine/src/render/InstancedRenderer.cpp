@@ -0,0 +1,203 @@
+#include "InstancedRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "MapHelper.hpp"
+#include "core/ThreadPool.h"
+
+namespace bt {
+
+namespace {
+
+// Below this many instances per thread recording in parallel costs more than it saves
+constexpr Uint32 MinInstancesPerSlice = 4096;
+
+}
+
+InstancedRenderer::InstancedRenderer(IRenderDevice *Device, UploadRing *Ring) : mRing(Ring) {
+    m_pDevice = Device;
+
+    BufferDesc CBDesc;
+    CBDesc.Name = "Instancing view constants CB";
+    CBDesc.Size = sizeof(MatrixF);
+    CBDesc.Usage = USAGE_DYNAMIC;
+    CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pViewConstants);
+}
+
+void InstancedRenderer::BeginFrame() {
+    mNumDrawCalls = 0;
+    mNumInstances = 0;
+    mNumSkippedInstances = 0;
+    mNumParallelFlushes = 0;
+}
+
+void InstancedRenderer::AddInstance(Mesh *pMesh, Material *pMaterial, const MatrixF &World, const glm::vec4 &Color) {
+    if (!pMaterial->IsReady()) {
+        ++mNumSkippedInstances;
+        return;
+    }
+
+    Batch *pBatch = nullptr;
+    for (auto &B: mBatches) {
+        // Materials requested with the same key share one pipeline entry, compare that rather than the owners
+        if (B.pMesh == pMesh && B.pMaterial->Pipeline == pMaterial->Pipeline) {
+            pBatch = &B;
+            break;
+        }
+    }
+
+    if (pBatch == nullptr) {
+        mBatches.emplace_back();
+        pBatch = &mBatches.back();
+        pBatch->pMesh = pMesh;
+        pBatch->pMaterial = pMaterial;
+    }
+
+    pBatch->Instances.push_back(InstanceData{World, Color});
+}
+
+void InstancedRenderer::SetRecordingContexts(ThreadPool *Workers, std::vector<IDeviceContext *> Contexts) {
+    mWorkers = Workers;
+    mDeferredContexts = std::move(Contexts);
+}
+
+void InstancedRenderer::CopyInstances(InstanceData *pDst, Uint32 First, Uint32 Last) const {
+    Uint32 BatchStart = 0;
+    for (const auto &B: mBatches) {
+        const auto BatchEnd = BatchStart + static_cast<Uint32>(B.Instances.size());
+        const auto Begin = std::max(BatchStart, First);
+        const auto End = std::min(BatchEnd, Last);
+        if (Begin < End) {
+            std::memcpy(pDst + Begin, B.Instances.data() + (Begin - BatchStart), (End - Begin) * sizeof(InstanceData));
+        }
+        BatchStart = BatchEnd;
+    }
+}
+
+Uint32 InstancedRenderer::RecordDraws(IDeviceContext *pCtx, Uint32 First, Uint32 Last, Uint64 InstanceOffset) const {
+    Uint32 NumDrawCalls = 0;
+    Uint32 BatchStart = 0;
+    IPipelineState *pLastPSO = nullptr;
+    for (const auto &B: mBatches) {
+        const auto BatchEnd = BatchStart + static_cast<Uint32>(B.Instances.size());
+        const auto Begin = std::max(BatchStart, First);
+        const auto End = std::min(BatchEnd, Last);
+        BatchStart = BatchEnd;
+        if (Begin >= End) {
+            continue;
+        }
+
+        const Uint64 Offsets[] = {0, InstanceOffset};
+        IBuffer *pBuffs[] = {B.pMesh->VertexBuffer, mRing->GetBuffer()};
+        pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, Offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY,
+                               SET_VERTEX_BUFFERS_FLAG_RESET);
+        pCtx->SetIndexBuffer(B.pMesh->IndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+        const auto &Pipeline = *B.pMaterial->Pipeline;
+        if (Pipeline.PSO.RawPtr() != pLastPSO) {
+            pLastPSO = Pipeline.PSO.RawPtr();
+            pCtx->SetPipelineState(pLastPSO);
+        }
+        pCtx->CommitShaderResources(Pipeline.SRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+        DrawIndexedAttribs DrawAttrs;
+        DrawAttrs.IndexType = B.pMesh->IndexType;
+        DrawAttrs.NumIndices = B.pMesh->NumIndices;
+        DrawAttrs.NumInstances = End - Begin;
+        DrawAttrs.FirstInstanceLocation = Begin;
+        DrawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
+        pCtx->DrawIndexed(DrawAttrs);
+        ++NumDrawCalls;
+    }
+    return NumDrawCalls;
+}
+
+void InstancedRenderer::Flush(IDeviceContext *pCtx, const Matrix &ProjView, ITextureView *pRTV, ITextureView *pDSV,
+                              const Viewport &VP) {
+    Uint32 TotalInstances = 0;
+    for (const auto &B: mBatches) {
+        TotalInstances += static_cast<Uint32>(B.Instances.size());
+    }
+
+    if (TotalInstances == 0) {
+        return;
+    }
+
+    const MatrixF ViewConstants = MatrixTranspose(ProjView);
+
+    // One upload for all batches, each batch addresses its range with FirstInstanceLocation
+    Uint64 InstanceOffset = 0;
+    auto *pInstances = static_cast<InstanceData *>(
+        mRing->Allocate(sizeof(InstanceData) * TotalInstances, sizeof(InstanceData), InstanceOffset));
+
+    // Mesh buffers start out in the copy state after their initial upload
+    for (const auto &B: mBatches) {
+        if (!B.Instances.empty()) {
+            mBarriers.Add(B.pMesh->VertexBuffer, RESOURCE_STATE_VERTEX_BUFFER);
+            mBarriers.Add(B.pMesh->IndexBuffer, RESOURCE_STATE_INDEX_BUFFER);
+        }
+    }
+    mBarriers.Add(mRing->GetBuffer(), RESOURCE_STATE_VERTEX_BUFFER);
+    mBarriers.Flush(pCtx);
+
+    // Deferred contexts can only read instance data from memory that is not tied to the context
+    // that mapped it, i.e. the persistently mapped ring
+    Uint32 NumSlices = 1;
+    if (mWorkers != nullptr && mRing->IsPersistent()) {
+        NumSlices = std::min(static_cast<Uint32>(mDeferredContexts.size()), TotalInstances / MinInstancesPerSlice);
+    }
+
+    if (NumSlices <= 1) {
+        CopyInstances(pInstances, 0, TotalInstances);
+        mRing->Unmap();
+        {
+            MapHelper<MatrixF> CBConstants(pCtx, m_pViewConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+            *CBConstants = ViewConstants;
+        }
+        mNumDrawCalls += RecordDraws(pCtx, 0, TotalInstances, InstanceOffset);
+    } else {
+        // Every slice copies its instances and records their draws into its own command list
+        const auto SliceSize = (TotalInstances + NumSlices - 1) / NumSlices;
+        mCommandLists.resize(NumSlices);
+        mSliceDrawCalls.assign(NumSlices, 0);
+        mWorkers->ParallelFor(NumSlices, [&](Uint32 Slice) {
+            const auto First = Slice * SliceSize;
+            const auto Last = std::min(First + SliceSize, TotalInstances);
+            CopyInstances(pInstances, First, Last);
+
+            auto *pDeferred = mDeferredContexts[Slice];
+            pDeferred->Begin(0);
+            pDeferred->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            // Binding targets resets the viewport to the whole texture
+            const auto &RTDesc = pRTV->GetTexture()->GetDesc();
+            pDeferred->SetViewports(1, &VP, RTDesc.Width, RTDesc.Height);
+            {
+                // Dynamic buffer contents are per context
+                MapHelper<MatrixF> CBConstants(pDeferred, m_pViewConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+                *CBConstants = ViewConstants;
+            }
+            mSliceDrawCalls[Slice] = RecordDraws(pDeferred, First, Last, InstanceOffset);
+            pDeferred->FinishCommandList(&mCommandLists[Slice]);
+        });
+
+        // Submitted in slice order, so the result matches single-threaded recording
+        std::vector<ICommandList *> CommandLists;
+        for (Uint32 Slice = 0; Slice < NumSlices; ++Slice) {
+            CommandLists.push_back(mCommandLists[Slice]);
+            mNumDrawCalls += mSliceDrawCalls[Slice];
+        }
+        pCtx->ExecuteCommandLists(NumSlices, CommandLists.data());
+        mCommandLists.clear();
+        ++mNumParallelFlushes;
+    }
+
+    mNumInstances += TotalInstances;
+    for (auto &B: mBatches) {
+        B.Instances.clear();
+    }
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "CommandList.h"
+#include "core/Math.h"
+#include "render/Mesh.h"
+#include "render/UploadRing.h"
+#include "render/BarrierBatch.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+class ThreadPool;
+
+// Per-instance vertex stream layout, must match ATTRIB2..ATTRIB6 in cube_inst.vsh
+struct InstanceData {
+    MatrixF World;
+    glm::vec4 Color;
+};
+
+// Gathers instances of the same mesh and material during the frame and draws every
+// such batch with one DrawIndexed call, or one per slice when recorded on several
+// threads. All instance data of a flush is one allocation from the frame's upload ring.
+class InstancedRenderer {
+  public:
+    InstancedRenderer(IRenderDevice *Device, UploadRing *Ring);
+
+    // View constants (view-projection matrix) that every instanced material binds as "Constants"
+    [[nodiscard]] IBuffer *GetViewConstants() { return m_pViewConstants; }
+
+    // Resets per-frame statistics
+    void BeginFrame();
+
+    // Instances of materials whose pipeline is still compiling are dropped
+    void AddInstance(Mesh *pMesh, Material *pMaterial, const MatrixF &World, const glm::vec4 &Color);
+
+    // Lets Flush() record large instance sets on Workers, one deferred context per slice. Contexts
+    // must hold at least two entries. The calling thread records the last slice as well, into
+    // mDeferredContexts[NumSlices - 1] rather than the immediate context.
+    void SetRecordingContexts(ThreadPool *Workers, std::vector<IDeviceContext *> Contexts);
+
+    // Uploads all gathered instances and draws them into the VP part of pRTV/pDSV, which pCtx must
+    // have bound already, then starts gathering a new set
+    void Flush(IDeviceContext *pCtx, const Matrix &ProjView, ITextureView *pRTV, ITextureView *pDSV,
+               const Viewport &VP);
+
+    // Statistics accumulated over all flushes since BeginFrame()
+    [[nodiscard]] Uint32 GetNumDrawCalls() const { return mNumDrawCalls; }
+    [[nodiscard]] Uint32 GetNumInstances() const { return mNumInstances; }
+    [[nodiscard]] Uint32 GetNumSkippedInstances() const { return mNumSkippedInstances; }
+    [[nodiscard]] Uint32 GetNumParallelFlushes() const { return mNumParallelFlushes; }
+
+  private:
+    struct Batch {
+        Mesh *pMesh = nullptr;
+        Material *pMaterial = nullptr;
+        std::vector<InstanceData> Instances;
+    };
+
+    // Instance ranges below are indices into the concatenation of all batches
+
+    void CopyInstances(InstanceData *pDst, Uint32 First, Uint32 Last) const;
+
+    Uint32 RecordDraws(IDeviceContext *pCtx, Uint32 First, Uint32 Last, Uint64 InstanceOffset) const;
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<IBuffer> m_pViewConstants;
+    UploadRing *mRing = nullptr;
+    BarrierBatch mBarriers;
+
+    ThreadPool *mWorkers = nullptr;
+    std::vector<IDeviceContext *> mDeferredContexts;
+    std::vector<RefCntAutoPtr<ICommandList>> mCommandLists;
+    std::vector<Uint32> mSliceDrawCalls;
+
+    // Batches persist between flushes so their instance arrays keep the allocated capacity
+    std::vector<Batch> mBatches;
+
+    Uint32 mNumDrawCalls = 0;
+    Uint32 mNumInstances = 0;
+    Uint32 mNumSkippedInstances = 0;
+    Uint32 mNumParallelFlushes = 0;
+};
+
+}
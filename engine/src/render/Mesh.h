@@ -0,0 +1,30 @@
+#pragma once
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "PipelineState.h"
+#include "ShaderResourceBinding.h"
+#include "Buffer.h"
+#include "render/PipelineCache.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+struct Mesh {
+    RefCntAutoPtr<IBuffer> VertexBuffer;
+    RefCntAutoPtr<IBuffer> IndexBuffer;
+    Uint32 NumIndices = 0;
+    VALUE_TYPE IndexType = VT_UINT32;
+};
+
+// Pipeline state plus the resource binding used with it. Objects that share a material
+// can be drawn with a single state setup. The pipeline compiles in the background, objects
+// are not drawn until it is ready.
+struct Material {
+    PipelineHandle Pipeline;
+
+    [[nodiscard]] bool IsReady() const { return Pipeline && Pipeline->IsReady(); }
+};
+
+}
@@ -0,0 +1,517 @@
+#include "PipelineCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "ShaderMacroHelper.hpp"
+#include "DataBlobImpl.hpp"
+#include "FileWrapper.hpp"
+#include "core/Hash.h"
+#include "core/Logging.h"
+#include "core/ThreadPool.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+namespace {
+
+constexpr Uint32 MaxIncludeDepth = 16;
+
+void HashSampler(Uint64 &Hash, const SamplerDesc &Desc) {
+    HashValue(Hash, Desc.MinFilter);
+    HashValue(Hash, Desc.MagFilter);
+    HashValue(Hash, Desc.MipFilter);
+    HashValue(Hash, Desc.AddressU);
+    HashValue(Hash, Desc.AddressV);
+    HashValue(Hash, Desc.AddressW);
+    HashValue(Hash, Desc.MipLODBias);
+    HashValue(Hash, Desc.MaxAnisotropy);
+    HashValue(Hash, Desc.ComparisonFunc);
+    for (auto Color: Desc.BorderColor) {
+        HashValue(Hash, Color);
+    }
+    HashValue(Hash, Desc.MinLOD);
+    HashValue(Hash, Desc.MaxLOD);
+}
+
+void HashResourceLayout(Uint64 &Hash, const PipelineResourceLayoutDesc &Layout) {
+    HashValue(Hash, Layout.DefaultVariableType);
+    HashValue(Hash, Layout.NumVariables);
+    for (Uint32 i = 0; i < Layout.NumVariables; ++i) {
+        const auto &Var = Layout.Variables[i];
+        HashValue(Hash, Var.ShaderStages);
+        HashString(Hash, Var.Name);
+        HashValue(Hash, Var.Type);
+    }
+    HashValue(Hash, Layout.NumImmutableSamplers);
+    for (Uint32 i = 0; i < Layout.NumImmutableSamplers; ++i) {
+        const auto &Sampler = Layout.ImmutableSamplers[i];
+        HashValue(Hash, Sampler.ShaderStages);
+        HashString(Hash, Sampler.SamplerOrTextureName);
+        HashSampler(Hash, Sampler.Desc);
+    }
+}
+
+void HashGraphicsPipeline(Uint64 &Hash, const GraphicsPipelineDesc &GP) {
+    const auto &Blend = GP.BlendDesc;
+    HashValue(Hash, Blend.AlphaToCoverageEnable);
+    HashValue(Hash, Blend.IndependentBlendEnable);
+    for (Uint32 i = 0; i < GP.NumRenderTargets; ++i) {
+        const auto &RT = Blend.RenderTargets[i];
+        HashValue(Hash, RT.BlendEnable);
+        HashValue(Hash, RT.LogicOperationEnable);
+        HashValue(Hash, RT.SrcBlend);
+        HashValue(Hash, RT.DestBlend);
+        HashValue(Hash, RT.BlendOp);
+        HashValue(Hash, RT.SrcBlendAlpha);
+        HashValue(Hash, RT.DestBlendAlpha);
+        HashValue(Hash, RT.BlendOpAlpha);
+        HashValue(Hash, RT.LogicOp);
+        HashValue(Hash, RT.RenderTargetWriteMask);
+        HashValue(Hash, GP.RTVFormats[i]);
+    }
+    HashValue(Hash, GP.SampleMask);
+
+    const auto &Raster = GP.RasterizerDesc;
+    HashValue(Hash, Raster.FillMode);
+    HashValue(Hash, Raster.CullMode);
+    HashValue(Hash, Raster.FrontCounterClockwise);
+    HashValue(Hash, Raster.DepthClipEnable);
+    HashValue(Hash, Raster.ScissorEnable);
+    HashValue(Hash, Raster.AntialiasedLineEnable);
+    HashValue(Hash, Raster.DepthBias);
+    HashValue(Hash, Raster.DepthBiasClamp);
+    HashValue(Hash, Raster.SlopeScaledDepthBias);
+
+    const auto &Depth = GP.DepthStencilDesc;
+    HashValue(Hash, Depth.DepthEnable);
+    HashValue(Hash, Depth.DepthWriteEnable);
+    HashValue(Hash, Depth.DepthFunc);
+    HashValue(Hash, Depth.StencilEnable);
+    HashValue(Hash, Depth.StencilReadMask);
+    HashValue(Hash, Depth.StencilWriteMask);
+    for (const auto *pFace: {&Depth.FrontFace, &Depth.BackFace}) {
+        HashValue(Hash, pFace->StencilFailOp);
+        HashValue(Hash, pFace->StencilDepthFailOp);
+        HashValue(Hash, pFace->StencilPassOp);
+        HashValue(Hash, pFace->StencilFunc);
+    }
+
+    const auto &Layout = GP.InputLayout;
+    HashValue(Hash, Layout.NumElements);
+    for (Uint32 i = 0; i < Layout.NumElements; ++i) {
+        const auto &Elem = Layout.LayoutElements[i];
+        HashString(Hash, Elem.HLSLSemantic);
+        HashValue(Hash, Elem.InputIndex);
+        HashValue(Hash, Elem.BufferSlot);
+        HashValue(Hash, Elem.NumComponents);
+        HashValue(Hash, Elem.ValueType);
+        HashValue(Hash, Elem.IsNormalized);
+        HashValue(Hash, Elem.RelativeOffset);
+        HashValue(Hash, Elem.Stride);
+        HashValue(Hash, Elem.Frequency);
+        HashValue(Hash, Elem.InstanceDataStepRate);
+    }
+
+    HashValue(Hash, GP.PrimitiveTopology);
+    HashValue(Hash, GP.NumViewports);
+    HashValue(Hash, GP.NumRenderTargets);
+    HashValue(Hash, GP.DSVFormat);
+    HashValue(Hash, GP.SmplDesc.Count);
+    HashValue(Hash, GP.SmplDesc.Quality);
+}
+
+}
+
+PipelineCache::PipelineCache(IRenderDevice *Device, IEngineFactory *Factory, ThreadPool *Workers,
+                             const std::string &SourceDir, const std::string &CacheDir, const std::string &PackPath)
+    : mSourceDir(SourceDir), mCacheDir(CacheDir) {
+    m_pDevice = Device;
+    Factory->CreateDefaultShaderSourceStreamFactory(mSourceDir.c_str(), &m_pSourceFactory);
+
+    if (!PackPath.empty()) {
+        LoadShaderPack(Factory, PackPath);
+    }
+
+    const auto DeviceType = m_pDevice->GetDeviceInfo().Type;
+    if (DeviceType != RENDER_DEVICE_TYPE_GL && DeviceType != RENDER_DEVICE_TYPE_GLES) {
+        mWorkers = Workers;
+    }
+
+    // OpenGL consumes GLSL text, there is no bytecode worth keeping
+    mBytecodeSupported = DeviceType == RENDER_DEVICE_TYPE_D3D11 || DeviceType == RENDER_DEVICE_TYPE_D3D12 ||
+                         DeviceType == RENDER_DEVICE_TYPE_VULKAN;
+
+#if BT_SHADER_PACK_ONLY
+    mBytecodeSupported = false;
+#endif
+
+    if (mBytecodeSupported) {
+        std::error_code Error;
+        std::filesystem::create_directories(mCacheDir, Error);
+        if (Error) {
+            log::Warning(fmt::format("Shader cache directory {} is not available: {}", mCacheDir, Error.message()));
+            mBytecodeSupported = false;
+        }
+    }
+}
+
+void PipelineCache::LoadShaderPack(IEngineFactory *Factory, const std::string &PackPath) {
+    FileWrapper PackFile(PackPath.c_str(), EFileAccessMode::Read);
+    if (!PackFile) {
+        log::Warning(fmt::format("Shader pack {} not found, shaders will be compiled at runtime", PackPath));
+        return;
+    }
+
+    auto pPackData = DataBlobImpl::Create();
+    if (!PackFile->Read(pPackData)) {
+        log::Error(fmt::format("Failed to read shader pack {}", PackPath));
+        return;
+    }
+
+    DearchiverCreateInfo DearchiverCI;
+    Factory->CreateDearchiver(DearchiverCI, &m_pDearchiver);
+    if (!m_pDearchiver || !m_pDearchiver->LoadArchive(pPackData)) {
+        log::Error(fmt::format("Shader pack {} is not a valid archive", PackPath));
+        m_pDearchiver.Release();
+    }
+}
+
+PipelineCache::~PipelineCache() {
+    // Compile jobs reference the cache
+    if (mWorkers != nullptr) {
+        mWorkers->WaitIdle();
+    }
+}
+
+PipelineHandle PipelineCache::RequestPipeline(const std::string &Key, PipelineBuilder Build) {
+    PipelineHandle Entry;
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        auto &Request = mRequests[Key];
+        if (Request) {
+            return Request;
+        }
+        Request = std::make_shared<PipelineEntry>();
+        Entry = Request;
+    }
+    ++mNumRequested;
+
+    auto Job = [this, Entry, Build = std::move(Build)]() { RunCompileJob(Entry, Build); };
+    if (mWorkers != nullptr) {
+        mWorkers->Enqueue(std::move(Job));
+    } else {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mMainThreadJobs.push_back(std::move(Job));
+    }
+    return Entry;
+}
+
+void PipelineCache::RunCompileJob(const PipelineHandle &Entry, const PipelineBuilder &Build) {
+    auto pPSO = Build(*this);
+    if (pPSO) {
+        Entry->SRB = GetSharedSRB(pPSO);
+    }
+    Entry->PSO = std::move(pPSO);
+    Entry->mFinished.store(true, std::memory_order_release);
+    ++mNumFinished;
+}
+
+void PipelineCache::Update() {
+    // One pipeline per frame keeps the hitch of synchronous compilation bounded
+    std::function<void()> Job;
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        if (mMainThreadJobs.empty()) {
+            return;
+        }
+        Job = std::move(mMainThreadJobs.front());
+        mMainThreadJobs.pop_front();
+    }
+    Job();
+}
+
+bool PipelineCache::HashSourceFile(const std::string &FilePath, Uint64 &Hash, Uint32 Depth) const {
+    if (Depth > MaxIncludeDepth) {
+        log::Error(fmt::format("Include depth limit reached in {}", FilePath));
+        return false;
+    }
+
+    std::ifstream File(std::filesystem::path(mSourceDir) / FilePath, std::ios::binary);
+    if (!File) {
+        log::Error(fmt::format("Can not open shader source {}", FilePath));
+        return false;
+    }
+
+    std::stringstream Contents;
+    Contents << File.rdbuf();
+    const auto Text = Contents.str();
+    HashString(Hash, FilePath);
+    HashString(Hash, Text);
+
+    // Included files are part of the shader key as well, otherwise editing a header would not invalidate it
+    std::istringstream Lines(Text);
+    std::string Line;
+    while (std::getline(Lines, Line)) {
+        const auto Pos = Line.find_first_not_of(" \t");
+        if (Pos == std::string::npos || Line.compare(Pos, 8, "#include") != 0) {
+            continue;
+        }
+        const auto Open = Line.find('"', Pos);
+        const auto Close = Open == std::string::npos ? Open : Line.find('"', Open + 1);
+        if (Close == std::string::npos) {
+            continue;
+        }
+        if (!HashSourceFile(Line.substr(Open + 1, Close - Open - 1), Hash, Depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string PipelineCache::GetBytecodePath(Uint64 Hash) const {
+    const auto DeviceType = static_cast<Uint32>(m_pDevice->GetDeviceInfo().Type);
+    return (std::filesystem::path(mCacheDir) / fmt::format("{:016x}.{}.bin", Hash, DeviceType)).string();
+}
+
+bool PipelineCache::LoadBytecode(Uint64 Hash, std::vector<Uint8> &OutBytecode) const {
+    std::ifstream File(GetBytecodePath(Hash), std::ios::binary | std::ios::ate);
+    if (!File) {
+        return false;
+    }
+
+    const auto Size = static_cast<size_t>(File.tellg());
+    if (Size == 0) {
+        return false;
+    }
+    OutBytecode.resize(Size);
+    File.seekg(0);
+    File.read(reinterpret_cast<char *>(OutBytecode.data()), static_cast<std::streamsize>(Size));
+    return static_cast<bool>(File);
+}
+
+void PipelineCache::SaveBytecode(Uint64 Hash, IShader *pShader) const {
+    const void *pBytecode = nullptr;
+    Uint64 Size = 0;
+    pShader->GetBytecode(&pBytecode, Size);
+    if (pBytecode == nullptr || Size == 0) {
+        return;
+    }
+
+    std::ofstream File(GetBytecodePath(Hash), std::ios::binary | std::ios::trunc);
+    File.write(static_cast<const char *>(pBytecode), static_cast<std::streamsize>(Size));
+    if (!File) {
+        log::Warning(fmt::format("Failed to write shader bytecode for {:016x}", Hash));
+    }
+}
+
+IShader *PipelineCache::GetShader(const ShaderDesc &Desc) {
+    if (m_pDearchiver && Desc.Source.empty()) {
+        if (auto *pShader = GetPackedShader(Desc)) {
+            return pShader;
+        }
+#if BT_SHADER_PACK_ONLY
+        log::Error(fmt::format("Shader {} ({}) is missing from the shader pack", Desc.Name, Desc.FilePath));
+        return nullptr;
+#endif
+    }
+
+    Uint64 Hash = HashSeed;
+    HashValue(Hash, Desc.Type);
+    HashString(Hash, Desc.EntryPoint);
+    for (const auto &Macro: Desc.Macros) {
+        HashString(Hash, Macro.first);
+        HashString(Hash, Macro.second);
+    }
+    if (!Desc.Source.empty()) {
+        HashString(Hash, Desc.Source);
+    } else if (!HashSourceFile(Desc.FilePath, Hash, 0)) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        if (auto It = mShaders.find(Hash); It != mShaders.end()) {
+            return It->second;
+        }
+    }
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.Desc.ShaderType = Desc.Type;
+    ShaderCI.Desc.Name = Desc.Name.c_str();
+    ShaderCI.EntryPoint = Desc.EntryPoint.c_str();
+    // Tell the system that the shader source code is in HLSL.
+    // For OpenGL, the engine will convert this into GLSL under the hood.
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    // OpenGL backend requires emulated combined HLSL texture samplers (g_Texture + g_Texture_sampler combination).
+    // Cached bytecode is reflected with it too, or the immutable samplers named after the textures do not attach.
+    ShaderCI.UseCombinedTextureSamplers = true;
+
+    RefCntAutoPtr<IShader> pShader;
+
+    std::vector<Uint8> Bytecode;
+    if (mBytecodeSupported && LoadBytecode(Hash, Bytecode)) {
+        ShaderCI.ByteCode = Bytecode.data();
+        ShaderCI.ByteCodeSize = Bytecode.size();
+        m_pDevice->CreateShader(ShaderCI, &pShader);
+        if (pShader) {
+            ++mNumLoadedShaders;
+        } else {
+            log::Warning(fmt::format("Cached bytecode of {} is unusable, recompiling", Desc.Name));
+        }
+        ShaderCI.ByteCode = nullptr;
+        ShaderCI.ByteCodeSize = 0;
+    }
+
+    if (!pShader) {
+        ShaderCI.pShaderSourceStreamFactory = m_pSourceFactory;
+        if (!Desc.Source.empty()) {
+            ShaderCI.Source = Desc.Source.c_str();
+        } else {
+            ShaderCI.FilePath = Desc.FilePath.c_str();
+        }
+
+        ShaderMacroHelper Macros;
+        for (const auto &Macro: Desc.Macros) {
+            Macros.AddShaderMacro(Macro.first.c_str(), Macro.second.c_str());
+        }
+        if (!Desc.Macros.empty()) {
+            ShaderCI.Macros = Macros;
+        }
+
+        m_pDevice->CreateShader(ShaderCI, &pShader);
+        if (!pShader) {
+            log::Error(fmt::format("Failed to compile shader {}", Desc.Name));
+            return nullptr;
+        }
+        ++mNumCompiledShaders;
+
+        if (mBytecodeSupported) {
+            SaveBytecode(Hash, pShader);
+        }
+    }
+
+    return AddShader(Hash, std::move(pShader));
+}
+
+IShader *PipelineCache::GetPackedShader(const ShaderDesc &Desc) {
+    const auto Hash = GetShaderPermutationHash(Desc);
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        if (auto It = mShaders.find(Hash); It != mShaders.end()) {
+            return It->second;
+        }
+    }
+
+    const auto PackName = GetShaderPackName(Desc);
+    ShaderUnpackInfo UnpackInfo;
+    UnpackInfo.pDevice = m_pDevice;
+    UnpackInfo.Name = PackName.c_str();
+
+    RefCntAutoPtr<IShader> pShader;
+    m_pDearchiver->UnpackShader(UnpackInfo, &pShader);
+    if (!pShader) {
+        return nullptr;
+    }
+    ++mNumLoadedShaders;
+
+    return AddShader(Hash, std::move(pShader));
+}
+
+IShader *PipelineCache::AddShader(Uint64 Hash, RefCntAutoPtr<IShader> pShader) {
+    // Another thread may have created the same shader meanwhile, keep the first one
+    std::lock_guard<std::mutex> Lock(mMutex);
+    auto Inserted = mShaders.emplace(Hash, std::move(pShader));
+    if (Inserted.second) {
+        mShaderHashes[Inserted.first->second.RawPtr()] = Hash;
+    }
+    return Inserted.first->second;
+}
+
+Uint64 PipelineCache::GetShaderHash(const IShader *pShader) const {
+    if (pShader == nullptr) {
+        return 0;
+    }
+
+    // Shaders created outside of the cache are only equal to themselves
+    std::lock_guard<std::mutex> Lock(mMutex);
+    auto It = mShaderHashes.find(pShader);
+    return It != mShaderHashes.end() ? It->second : static_cast<Uint64>(reinterpret_cast<uintptr_t>(pShader));
+}
+
+IPipelineState *PipelineCache::GetGraphicsPipeline(const GraphicsPipelineStateCreateInfo &CreateInfo,
+                                                   const std::function<void(IPipelineState *)> &OnCreated) {
+    Uint64 Hash = HashSeed;
+    HashValue(Hash, CreateInfo.PSODesc.PipelineType);
+    for (const IShader *pShader: {CreateInfo.pVS, CreateInfo.pPS, CreateInfo.pDS, CreateInfo.pHS, CreateInfo.pGS}) {
+        HashValue(Hash, GetShaderHash(pShader));
+    }
+    HashResourceLayout(Hash, CreateInfo.PSODesc.ResourceLayout);
+    HashGraphicsPipeline(Hash, CreateInfo.GraphicsPipeline);
+
+    return FindOrCreatePipeline(
+        Hash, CreateInfo.PSODesc.Name,
+        [&](RefCntAutoPtr<IPipelineState> &pPSO) { m_pDevice->CreateGraphicsPipelineState(CreateInfo, &pPSO); },
+        OnCreated);
+}
+
+IPipelineState *PipelineCache::GetComputePipeline(const ComputePipelineStateCreateInfo &CreateInfo,
+                                                  const std::function<void(IPipelineState *)> &OnCreated) {
+    Uint64 Hash = HashSeed;
+    HashValue(Hash, CreateInfo.PSODesc.PipelineType);
+    HashValue(Hash, GetShaderHash(CreateInfo.pCS));
+    HashResourceLayout(Hash, CreateInfo.PSODesc.ResourceLayout);
+
+    return FindOrCreatePipeline(
+        Hash, CreateInfo.PSODesc.Name,
+        [&](RefCntAutoPtr<IPipelineState> &pPSO) { m_pDevice->CreateComputePipelineState(CreateInfo, &pPSO); },
+        OnCreated);
+}
+
+IPipelineState *PipelineCache::FindOrCreatePipeline(Uint64 Hash, const char *Name,
+                                                    const std::function<void(RefCntAutoPtr<IPipelineState> &)> &Create,
+                                                    const std::function<void(IPipelineState *)> &OnCreated) {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        if (auto It = mPipelines.find(Hash); It != mPipelines.end()) {
+            return It->second;
+        }
+    }
+
+    RefCntAutoPtr<IPipelineState> pPSO;
+    Create(pPSO);
+    if (!pPSO) {
+        log::Error(fmt::format("Failed to create pipeline state {}", Name != nullptr ? Name : ""));
+        return nullptr;
+    }
+
+    if (OnCreated) {
+        OnCreated(pPSO);
+    }
+
+    std::lock_guard<std::mutex> Lock(mMutex);
+    return mPipelines.emplace(Hash, std::move(pPSO)).first->second;
+}
+
+IShaderResourceBinding *PipelineCache::GetSharedSRB(IPipelineState *pPSO) {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    auto &SRB = mSharedSRBs[pPSO];
+    if (!SRB) {
+        // Bind all static resources in it
+        pPSO->CreateShaderResourceBinding(&SRB, true);
+    }
+    return SRB;
+}
+
+Uint32 PipelineCache::GetNumShaders() const {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    return static_cast<Uint32>(mShaders.size());
+}
+
+Uint32 PipelineCache::GetNumPipelines() const {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    return static_cast<Uint32>(mPipelines.size());
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "EngineFactory.h"
+#include "PipelineState.h"
+#include "ShaderResourceBinding.h"
+#include "Shader.h"
+#include "Dearchiver.h"
+#include "render/ShaderDesc.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+class ThreadPool;
+class PipelineCache;
+
+// Pipeline requested through PipelineCache::RequestPipeline(). PSO and SRB are written once by
+// the compile job and must not be touched before IsReady() returns true.
+struct PipelineEntry {
+    RefCntAutoPtr<IPipelineState> PSO;
+    // Binding shared by every user of the pipeline, see PipelineCache::GetSharedSRB()
+    RefCntAutoPtr<IShaderResourceBinding> SRB;
+
+    [[nodiscard]] bool IsReady() const { return mFinished.load(std::memory_order_acquire) && PSO; }
+
+    [[nodiscard]] bool IsFailed() const { return mFinished.load(std::memory_order_acquire) && !PSO; }
+
+  private:
+    friend class PipelineCache;
+
+    std::atomic<bool> mFinished{false};
+};
+
+using PipelineHandle = std::shared_ptr<PipelineEntry>;
+
+// Creates the pipeline through the synchronous cache methods, runs on a compile worker
+using PipelineBuilder = std::function<RefCntAutoPtr<IPipelineState>(PipelineCache &Cache)>;
+
+// Deduplicates shaders, pipeline states and shader resource bindings by content hash.
+// Shaders are keyed by their source text (including #include'd files), entry point and macros,
+// pipelines by the shader keys and the full pipeline description. Compiled bytecode is kept in
+// CacheDir so the next run skips HLSL compilation on backends that accept bytecode.
+// The synchronous methods may be called from any thread.
+class PipelineCache {
+  public:
+    // Compile jobs go to Workers; without workers, or on OpenGL whose device is bound to the
+    // main thread, they run one per frame from Update(). File shaders are taken from the offline
+    // pack at PackPath when it has them (see engine/tools/ShaderPacker.cpp).
+    PipelineCache(IRenderDevice *Device, IEngineFactory *Factory, ThreadPool *Workers, const std::string &SourceDir,
+                  const std::string &CacheDir, const std::string &PackPath = {});
+
+    ~PipelineCache();
+
+    // Queues Build unless a request with the same Key was made before. The returned handle becomes
+    // ready in a later frame; until then users skip their draws. Key must name everything Build
+    // bakes into the pipeline that can differ between requesters, such as render target formats.
+    // Build runs on a compile worker, possibly after the requester is gone. It must only use the
+    // cache it is given and what it captured by value, never the requester's members.
+    PipelineHandle RequestPipeline(const std::string &Key, PipelineBuilder Build);
+
+    // Called once per frame on the main thread
+    void Update();
+
+    // Returns nullptr if the shader source can not be read or compiled. Builds with
+    // BT_SHADER_PACK_ONLY never compile file shaders and fail if the pack misses one.
+    IShader *GetShader(const ShaderDesc &Desc);
+
+    // CreateInfo.pVS/pPS etc. should come from GetShader(). OnCreated runs only for a pipeline
+    // that was not cached yet and is the place to set its static variables.
+    IPipelineState *GetGraphicsPipeline(const GraphicsPipelineStateCreateInfo &CreateInfo,
+                                        const std::function<void(IPipelineState *)> &OnCreated = {});
+
+    // Same as GetGraphicsPipeline() for a pipeline with only a compute shader
+    IPipelineState *GetComputePipeline(const ComputePipelineStateCreateInfo &CreateInfo,
+                                       const std::function<void(IPipelineState *)> &OnCreated = {});
+
+    // One binding per pipeline for objects that have no resources of their own
+    IShaderResourceBinding *GetSharedSRB(IPipelineState *pPSO);
+
+    [[nodiscard]] Uint32 GetNumShaders() const;
+    [[nodiscard]] Uint32 GetNumPipelines() const;
+    [[nodiscard]] Uint32 GetNumCompiledShaders() const { return mNumCompiledShaders; }
+    [[nodiscard]] Uint32 GetNumLoadedShaders() const { return mNumLoadedShaders; }
+    [[nodiscard]] Uint32 GetNumRequestedPipelines() const { return mNumRequested; }
+    [[nodiscard]] Uint32 GetNumFinishedPipelines() const { return mNumFinished; }
+
+  private:
+    void LoadShaderPack(IEngineFactory *Factory, const std::string &PackPath);
+
+    IShader *GetPackedShader(const ShaderDesc &Desc);
+
+    IShader *AddShader(Uint64 Hash, RefCntAutoPtr<IShader> pShader);
+
+    bool HashSourceFile(const std::string &FilePath, Uint64 &Hash, Uint32 Depth) const;
+
+    [[nodiscard]] std::string GetBytecodePath(Uint64 Hash) const;
+
+    bool LoadBytecode(Uint64 Hash, std::vector<Uint8> &OutBytecode) const;
+
+    void SaveBytecode(Uint64 Hash, IShader *pShader) const;
+
+    [[nodiscard]] Uint64 GetShaderHash(const IShader *pShader) const;
+
+    // Returns the pipeline cached under Hash or stores the one made by Create
+    IPipelineState *FindOrCreatePipeline(Uint64 Hash, const char *Name,
+                                         const std::function<void(RefCntAutoPtr<IPipelineState> &)> &Create,
+                                         const std::function<void(IPipelineState *)> &OnCreated);
+
+    void RunCompileJob(const PipelineHandle &Entry, const PipelineBuilder &Build);
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> m_pSourceFactory;
+    RefCntAutoPtr<IDearchiver> m_pDearchiver;
+    std::string mSourceDir;
+    std::string mCacheDir;
+    bool mBytecodeSupported = false;
+    ThreadPool *mWorkers = nullptr;
+
+    // Guards the maps below, compilation itself runs unlocked
+    mutable std::mutex mMutex;
+
+    std::unordered_map<Uint64, RefCntAutoPtr<IShader>> mShaders;
+    std::unordered_map<const IShader *, Uint64> mShaderHashes;
+    std::unordered_map<Uint64, RefCntAutoPtr<IPipelineState>> mPipelines;
+    std::unordered_map<const IPipelineState *, RefCntAutoPtr<IShaderResourceBinding>> mSharedSRBs;
+    std::unordered_map<std::string, PipelineHandle> mRequests;
+    std::deque<std::function<void()>> mMainThreadJobs;
+
+    std::atomic<Uint32> mNumCompiledShaders{0};
+    std::atomic<Uint32> mNumLoadedShaders{0};
+    std::atomic<Uint32> mNumRequested{0};
+    std::atomic<Uint32> mNumFinished{0};
+};
+
+}
@@ -0,0 +1,247 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+#include "core/Logging.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+namespace {
+
+// Pooled textures nobody asked for during this many frames are released
+constexpr Uint64 PoolRetainFrames = 8;
+
+bool IsCompatible(const TextureDesc &A, const TextureDesc &B) {
+    return A.Type == B.Type && A.Width == B.Width && A.Height == B.Height && A.ArraySize == B.ArraySize &&
+           A.Format == B.Format && A.MipLevels == B.MipLevels && A.SampleCount == B.SampleCount &&
+           A.BindFlags == B.BindFlags && A.Usage == B.Usage && A.MiscFlags == B.MiscFlags;
+}
+
+}
+
+RGTextureHandle RenderGraphBuilder::CreateTexture(const TextureDesc &Desc) {
+    const auto Handle = static_cast<RGTextureHandle>(mGraph.mResources.size());
+    mGraph.mResources.emplace_back();
+    auto &Res = mGraph.mResources.back();
+    Res.Desc = Desc;
+    Res.Name = Desc.Name != nullptr ? Desc.Name : "Transient texture";
+    Res.Desc.Name = nullptr;
+    return Handle;
+}
+
+void RenderGraphBuilder::Read(RGTextureHandle Texture, RESOURCE_STATE State) {
+    mGraph.AddAccess(mPassIndex, Texture, State, false);
+}
+
+void RenderGraphBuilder::Write(RGTextureHandle Texture, RESOURCE_STATE State) {
+    mGraph.AddAccess(mPassIndex, Texture, State, true);
+}
+
+void RenderGraphBuilder::SetSideEffects() {
+    mGraph.mPasses[mPassIndex].SideEffects = true;
+}
+
+RenderGraph::RenderGraph(IRenderDevice *Device, FrameSync &Sync) : mSync(Sync) {
+    m_pDevice = Device;
+}
+
+void RenderGraph::Reset() {
+    mPasses.clear();
+    mResources.clear();
+    mCompiled = false;
+    mNumCulledPasses = 0;
+    mNumTransientTextures = 0;
+    mNumBarriers = 0;
+    ++mFrameIndex;
+}
+
+RGTextureHandle RenderGraph::ImportTexture(ITexture *pTexture) {
+    const auto Handle = static_cast<RGTextureHandle>(mResources.size());
+    mResources.emplace_back();
+    auto &Res = mResources.back();
+    Res.Desc = pTexture->GetDesc();
+    Res.Name = Res.Desc.Name != nullptr ? Res.Desc.Name : "Imported texture";
+    Res.pTexture = pTexture;
+    Res.Imported = true;
+    return Handle;
+}
+
+void RenderGraph::AddPass(const char *Name, const RenderPassSetup &Setup, RenderPassExecute Execute) {
+    const auto PassIndex = static_cast<Uint32>(mPasses.size());
+    mPasses.emplace_back();
+    mPasses.back().Name = Name;
+    mPasses.back().Execute = std::move(Execute);
+
+    RenderGraphBuilder Builder(*this, PassIndex);
+    Setup(Builder);
+}
+
+void RenderGraph::AddAccess(Uint32 PassIndex, RGTextureHandle Texture, RESOURCE_STATE State, bool Write) {
+    if (Texture >= mResources.size()) {
+        log::Error(fmt::format("Render pass '{}' uses an invalid texture handle", mPasses[PassIndex].Name));
+        return;
+    }
+
+    auto &Accesses = mPasses[PassIndex].Accesses;
+    for (auto &A: Accesses) {
+        if (A.Texture == Texture) {
+            // Read states combine, a write always wins
+            if (Write) {
+                A.State = State;
+                A.Write = true;
+            } else if (!A.Write) {
+                A.State = static_cast<RESOURCE_STATE>(A.State | State);
+            }
+            return;
+        }
+    }
+    Accesses.push_back(Access{Texture, State, Write});
+}
+
+void RenderGraph::CullPasses() {
+    // Walk backwards from the passes with visible results: a pass survives if it writes something
+    // a surviving later pass reads, or an imported texture, or has side effects
+    std::vector<bool> Needed(mResources.size(), false);
+    for (size_t i = 0; i < mResources.size(); ++i) {
+        Needed[i] = mResources[i].Imported;
+    }
+
+    for (auto It = mPasses.rbegin(); It != mPasses.rend(); ++It) {
+        auto &P = *It;
+        bool Alive = P.SideEffects;
+        for (const auto &A: P.Accesses) {
+            Alive = Alive || (A.Write && Needed[A.Texture]);
+        }
+
+        P.Culled = !Alive;
+        if (P.Culled) {
+            ++mNumCulledPasses;
+            continue;
+        }
+
+        for (const auto &A: P.Accesses) {
+            if (!A.Write) {
+                Needed[A.Texture] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::AllocateTransients() {
+    for (Uint32 PassIndex = 0; PassIndex < mPasses.size(); ++PassIndex) {
+        if (mPasses[PassIndex].Culled) {
+            continue;
+        }
+        for (const auto &A: mPasses[PassIndex].Accesses) {
+            auto &Res = mResources[A.Texture];
+            Res.FirstPass = std::min(Res.FirstPass, PassIndex);
+            Res.LastPass = std::max(Res.LastPass, PassIndex);
+        }
+    }
+
+    for (auto &Pooled: mPool) {
+        Pooled.BusyUntilPass = 0;
+    }
+
+    // Resources are visited in creation order, which is the order of their first use. A pooled
+    // texture is free for a resource once every earlier user's last pass is behind its first one.
+    std::vector<bool> Taken(mPool.size(), false);
+    for (auto &Res: mResources) {
+        if (Res.Imported || Res.FirstPass == ~0u) {
+            continue;
+        }
+        ++mNumTransientTextures;
+
+        PooledTexture *pFree = nullptr;
+        for (size_t i = 0; i < mPool.size() && pFree == nullptr; ++i) {
+            auto &Pooled = mPool[i];
+            const bool Available = !Taken[i] || Pooled.BusyUntilPass < Res.FirstPass;
+            if (Available && IsCompatible(Pooled.Texture->GetDesc(), Res.Desc)) {
+                pFree = &Pooled;
+                Taken[i] = true;
+            }
+        }
+
+        if (pFree == nullptr) {
+            auto Desc = Res.Desc;
+            Desc.Name = Res.Name.c_str();
+            RefCntAutoPtr<ITexture> pTexture;
+            m_pDevice->CreateTexture(Desc, nullptr, &pTexture);
+            if (!pTexture) {
+                log::Error(fmt::format("Failed to create transient texture '{}'", Res.Name));
+                continue;
+            }
+            mPool.push_back(PooledTexture{pTexture, 0, 0});
+            Taken.push_back(true);
+            pFree = &mPool.back();
+        }
+
+        pFree->BusyUntilPass = Res.LastPass;
+        pFree->LastUsedFrame = mFrameIndex;
+        Res.pTexture = pFree->Texture;
+    }
+
+    // Earlier frames in flight may still sample a texture that drops out of the pool
+    mPool.erase(std::remove_if(mPool.begin(), mPool.end(),
+                               [this](PooledTexture &Pooled) {
+                                   if (Pooled.LastUsedFrame + PoolRetainFrames >= mFrameIndex) {
+                                       return false;
+                                   }
+                                   mSync.DeferRelease(std::move(Pooled.Texture));
+                                   return true;
+                               }),
+                mPool.end());
+}
+
+void RenderGraph::Compile() {
+    CullPasses();
+    AllocateTransients();
+    mCompiled = true;
+}
+
+void RenderGraph::Execute(IDeviceContext *pCtx) {
+    if (!mCompiled) {
+        Compile();
+    }
+
+    for (auto &P: mPasses) {
+        if (P.Culled) {
+            continue;
+        }
+
+        bool Valid = true;
+        for (const auto &A: P.Accesses) {
+            auto *pTexture = mResources[A.Texture].pTexture;
+            if (pTexture == nullptr) {
+                Valid = false;
+                break;
+            }
+            mBarriers.Add(pTexture, A.State);
+        }
+        mNumBarriers += mBarriers.Flush(pCtx);
+
+        if (!Valid) {
+            continue;
+        }
+        // The pass's barriers are outside the scope, they are accounted to no pass
+        if (mProfiler != nullptr) {
+            mProfiler->BeginScope(pCtx, P.Name.c_str());
+        }
+        P.Execute(pCtx);
+        if (mProfiler != nullptr) {
+            mProfiler->EndScope(pCtx);
+        }
+    }
+}
+
+ITexture *RenderGraph::GetTexture(RGTextureHandle Texture) const {
+    return Texture < mResources.size() ? mResources[Texture].pTexture : nullptr;
+}
+
+ITextureView *RenderGraph::GetTextureView(RGTextureHandle Texture, TEXTURE_VIEW_TYPE ViewType) const {
+    auto *pTexture = GetTexture(Texture);
+    return pTexture != nullptr ? pTexture->GetDefaultView(ViewType) : nullptr;
+}
+
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Texture.h"
+#include "render/BarrierBatch.h"
+#include "render/FrameSync.h"
+#include "render/GpuProfiler.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+using RGTextureHandle = Uint32;
+
+constexpr RGTextureHandle InvalidRGTexture = ~0u;
+
+class RenderGraph;
+
+// Handed to a pass's setup function to declare the textures the pass creates and touches
+class RenderGraphBuilder {
+  public:
+    // Transient texture that lives for this frame only. Its memory comes from the graph's pool and
+    // is shared with other transient textures of the same description whose lifetimes do not overlap.
+    RGTextureHandle CreateTexture(const TextureDesc &Desc);
+
+    void Read(RGTextureHandle Texture, RESOURCE_STATE State = RESOURCE_STATE_SHADER_RESOURCE);
+
+    void Write(RGTextureHandle Texture, RESOURCE_STATE State = RESOURCE_STATE_RENDER_TARGET);
+
+    // The pass has effects the graph can not see (e.g. presents to another window) and is never culled
+    void SetSideEffects();
+
+  private:
+    friend class RenderGraph;
+
+    RenderGraphBuilder(RenderGraph &Graph, Uint32 PassIndex) : mGraph(Graph), mPassIndex(PassIndex) {}
+
+    RenderGraph &mGraph;
+    Uint32 mPassIndex;
+};
+
+using RenderPassSetup = std::function<void(RenderGraphBuilder &Builder)>;
+using RenderPassExecute = std::function<void(IDeviceContext *pCtx)>;
+
+// Frame graph rebuilt every frame. Passes declare the textures they read and write, Compile()
+// culls passes whose results nobody consumes and assigns pooled textures to transient resources,
+// Execute() runs the surviving passes in order with all transitions of a pass issued as one batch
+// beforehand, so passes bind with RESOURCE_STATE_TRANSITION_MODE_VERIFY.
+class RenderGraph {
+  public:
+    // Pooled textures that fall out of use are released through Sync
+    RenderGraph(IRenderDevice *Device, FrameSync &Sync);
+
+    // Drops the previous frame's passes and resources, pooled textures are kept
+    void Reset();
+
+    // Externally owned texture, e.g. the swap chain back buffer. Passes writing imported
+    // textures are never culled.
+    RGTextureHandle ImportTexture(ITexture *pTexture);
+
+    void AddPass(const char *Name, const RenderPassSetup &Setup, RenderPassExecute Execute);
+
+    void Compile();
+
+    // Every executed pass is timed as a profiler scope of the same name
+    void SetProfiler(GpuProfiler *Profiler) { mProfiler = Profiler; }
+
+    void Execute(IDeviceContext *pCtx);
+
+    // Valid between Compile() and the next Reset()
+    [[nodiscard]] ITexture *GetTexture(RGTextureHandle Texture) const;
+
+    [[nodiscard]] ITextureView *GetTextureView(RGTextureHandle Texture, TEXTURE_VIEW_TYPE ViewType) const;
+
+    [[nodiscard]] Uint32 GetNumPasses() const { return static_cast<Uint32>(mPasses.size()); }
+    [[nodiscard]] Uint32 GetNumCulledPasses() const { return mNumCulledPasses; }
+    [[nodiscard]] Uint32 GetNumTransientTextures() const { return mNumTransientTextures; }
+    [[nodiscard]] Uint32 GetNumPooledTextures() const { return static_cast<Uint32>(mPool.size()); }
+    [[nodiscard]] Uint32 GetNumBarriers() const { return mNumBarriers; }
+
+  private:
+    friend class RenderGraphBuilder;
+
+    struct Access {
+        RGTextureHandle Texture;
+        RESOURCE_STATE State;
+        bool Write;
+    };
+
+    struct Pass {
+        std::string Name;
+        RenderPassExecute Execute;
+        std::vector<Access> Accesses;
+        bool SideEffects = false;
+        bool Culled = false;
+    };
+
+    struct Resource {
+        TextureDesc Desc;
+        std::string Name;
+        ITexture *pTexture = nullptr;
+        bool Imported = false;
+        // Alive pass range, filled by Compile()
+        Uint32 FirstPass = ~0u;
+        Uint32 LastPass = 0;
+    };
+
+    struct PooledTexture {
+        RefCntAutoPtr<ITexture> Texture;
+        // Last pass of the current frame that uses the texture
+        Uint32 BusyUntilPass = 0;
+        Uint64 LastUsedFrame = 0;
+    };
+
+    void AddAccess(Uint32 PassIndex, RGTextureHandle Texture, RESOURCE_STATE State, bool Write);
+
+    void CullPasses();
+
+    void AllocateTransients();
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    FrameSync &mSync;
+
+    std::vector<Pass> mPasses;
+    std::vector<Resource> mResources;
+    std::vector<PooledTexture> mPool;
+    BarrierBatch mBarriers;
+    GpuProfiler *mProfiler = nullptr;
+
+    Uint64 mFrameIndex = 0;
+    bool mCompiled = false;
+
+    Uint32 mNumCulledPasses = 0;
+    Uint32 mNumTransientTextures = 0;
+    Uint32 mNumBarriers = 0;
+};
+
+}
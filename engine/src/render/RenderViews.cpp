@@ -0,0 +1,55 @@
+#include "RenderViews.h"
+
+#include <algorithm>
+
+#include "Scene.h"
+
+namespace bt {
+
+bool RenderView::IsVisible(Uint32 Handle) const {
+    return std::binary_search(Visible.begin(), Visible.end(), Handle);
+}
+
+RenderView &RenderViewRegistry::AddView(const std::string &Name, RenderViewType Type, RenderTarget *Target) {
+    auto View = std::make_unique<RenderView>();
+    View->Name = Name;
+    View->Type = Type;
+    View->Target = Target;
+    mViews.push_back(std::move(View));
+    return *mViews.back();
+}
+
+void RenderViewRegistry::RemoveView(const std::string &Name) {
+    mViews.erase(std::remove_if(mViews.begin(), mViews.end(),
+                                [&Name](const std::unique_ptr<RenderView> &View) { return View->Name == Name; }),
+                 mViews.end());
+}
+
+RenderView *RenderViewRegistry::FindView(const std::string &Name) {
+    for (auto &View: mViews) {
+        if (View->Name == Name) {
+            return View.get();
+        }
+    }
+    return nullptr;
+}
+
+void RenderViewRegistry::PrepareViews(const Scene &CurrentScene) {
+    for (auto &View: mViews) {
+        if (!View->Enabled) {
+            continue;
+        }
+
+        // Nothing moved since the last frame - previous culling result is still valid
+        const auto CameraVersion = View->ViewCamera.GetVersion();
+        if (CameraVersion == View->mCulledCameraVersion && CurrentScene.GetVersion() == View->mCulledSceneVersion) {
+            continue;
+        }
+
+        CurrentScene.Cull(View->ViewCamera.GetFrustum(), View->Visible);
+        View->mCulledCameraVersion = CameraVersion;
+        View->mCulledSceneVersion = CurrentScene.GetVersion();
+    }
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+
+namespace bt {
+
+class Scene;
+class RenderTarget;
+
+enum class RenderViewType : Uint8 {
+    EditorViewport,
+    Game,
+    Shadow
+};
+
+struct RenderView {
+    std::string Name;
+    RenderViewType Type = RenderViewType::Game;
+    bool Enabled = true;
+
+    Camera ViewCamera;
+
+    // Offscreen target the view renders into, nullptr means the swap chain back buffer
+    RenderTarget *Target = nullptr;
+
+    // Sorted scene handles visible from this view, refreshed by RenderViewRegistry::PrepareViews()
+    std::vector<Uint32> Visible;
+
+    [[nodiscard]] bool IsVisible(Uint32 Handle) const;
+
+  private:
+    friend class RenderViewRegistry;
+
+    Uint64 mCulledCameraVersion = ~Uint64{0};
+    Uint64 mCulledSceneVersion = ~Uint64{0};
+};
+
+// Owns all cameras the renderer draws from (editor viewport, game view, shadow views).
+// Per-view CPU work such as culling is done once per frame in PrepareViews(), render passes only read the results.
+class RenderViewRegistry {
+  public:
+    RenderView &AddView(const std::string &Name, RenderViewType Type, RenderTarget *Target = nullptr);
+
+    void RemoveView(const std::string &Name);
+
+    [[nodiscard]] RenderView *FindView(const std::string &Name);
+
+    void PrepareViews(const Scene &CurrentScene);
+
+    template<typename FnType>
+    void ForEachView(FnType &&Fn) {
+        for (auto &View: mViews) {
+            if (View->Enabled) {
+                Fn(*View);
+            }
+        }
+    }
+
+    [[nodiscard]] size_t GetNumViews() const { return mViews.size(); }
+
+  private:
+    std::vector<std::unique_ptr<RenderView>> mViews;
+};
+
+}
@@ -0,0 +1,251 @@
+#include "SDFBaker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "core/ThreadPool.h"
+
+#if defined(__AVX2__)
+#    define BT_SDF_AVX2 1
+#    include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define BT_SDF_SSE 1
+#    include <emmintrin.h>
+#endif
+
+namespace bt {
+
+namespace {
+
+// Columns per thread are a multiple of this, so every SIMD lane but the map's last ones is full
+constexpr Uint32 ColumnAlignment = 8;
+// Below this many texels per job the threads cost more than they save
+constexpr Uint32 MinTexelsPerJob = 64 * 1024;
+
+// Walks one row down: a texel's distance is 0 if it is of the searched kind, otherwise the
+// distance of the texel above plus one. Lanes run along the row.
+void SweepDown(const Uint8 *pWalls, const float *pPrevToWall, const float *pPrevToEmpty, float *pToWall,
+               float *pToEmpty, Uint32 Count, float Cap) {
+    Uint32 i = 0;
+#if BT_SDF_AVX2
+    {
+        const __m256 One = _mm256_set1_ps(1.f);
+        const __m256 CapV = _mm256_set1_ps(Cap);
+        const __m256i Threshold = _mm256_set1_epi32(127);
+        for (; i + 8 <= Count; i += 8) {
+            const __m256i Bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pWalls + i)));
+            const __m256 IsWall = _mm256_castsi256_ps(_mm256_cmpgt_epi32(Bytes, Threshold));
+            const __m256 ToWall = _mm256_min_ps(_mm256_add_ps(_mm256_loadu_ps(pPrevToWall + i), One), CapV);
+            const __m256 ToEmpty = _mm256_min_ps(_mm256_add_ps(_mm256_loadu_ps(pPrevToEmpty + i), One), CapV);
+            _mm256_storeu_ps(pToWall + i, _mm256_andnot_ps(IsWall, ToWall));
+            _mm256_storeu_ps(pToEmpty + i, _mm256_and_ps(IsWall, ToEmpty));
+        }
+    }
+#endif
+#if BT_SDF_SSE
+    {
+        const __m128 One = _mm_set1_ps(1.f);
+        const __m128 CapV = _mm_set1_ps(Cap);
+        const __m128i Threshold = _mm_set1_epi32(127);
+        const __m128i Zero = _mm_setzero_si128();
+        for (; i + 4 <= Count; i += 4) {
+            int Packed;
+            std::memcpy(&Packed, pWalls + i, sizeof(Packed));
+            const __m128i Bytes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(Packed), Zero), Zero);
+            const __m128 IsWall = _mm_castsi128_ps(_mm_cmpgt_epi32(Bytes, Threshold));
+            const __m128 ToWall = _mm_min_ps(_mm_add_ps(_mm_loadu_ps(pPrevToWall + i), One), CapV);
+            const __m128 ToEmpty = _mm_min_ps(_mm_add_ps(_mm_loadu_ps(pPrevToEmpty + i), One), CapV);
+            _mm_storeu_ps(pToWall + i, _mm_andnot_ps(IsWall, ToWall));
+            _mm_storeu_ps(pToEmpty + i, _mm_and_ps(IsWall, ToEmpty));
+        }
+    }
+#endif
+    for (; i < Count; ++i) {
+        const bool IsWall = pWalls[i] > 127;
+        pToWall[i] = IsWall ? 0.f : std::min(pPrevToWall[i] + 1.f, Cap);
+        pToEmpty[i] = IsWall ? std::min(pPrevToEmpty[i] + 1.f, Cap) : 0.f;
+    }
+}
+
+// Walks one row up, keeping the nearer of the texel's own distance and the one below plus one
+void SweepUp(const float *pNextToWall, const float *pNextToEmpty, float *pToWall, float *pToEmpty, Uint32 Count) {
+    Uint32 i = 0;
+#if BT_SDF_AVX2
+    {
+        const __m256 One = _mm256_set1_ps(1.f);
+        for (; i + 8 <= Count; i += 8) {
+            const __m256 ToWall = _mm256_add_ps(_mm256_loadu_ps(pNextToWall + i), One);
+            const __m256 ToEmpty = _mm256_add_ps(_mm256_loadu_ps(pNextToEmpty + i), One);
+            _mm256_storeu_ps(pToWall + i, _mm256_min_ps(_mm256_loadu_ps(pToWall + i), ToWall));
+            _mm256_storeu_ps(pToEmpty + i, _mm256_min_ps(_mm256_loadu_ps(pToEmpty + i), ToEmpty));
+        }
+    }
+#endif
+#if BT_SDF_SSE
+    {
+        const __m128 One = _mm_set1_ps(1.f);
+        for (; i + 4 <= Count; i += 4) {
+            const __m128 ToWall = _mm_add_ps(_mm_loadu_ps(pNextToWall + i), One);
+            const __m128 ToEmpty = _mm_add_ps(_mm_loadu_ps(pNextToEmpty + i), One);
+            _mm_storeu_ps(pToWall + i, _mm_min_ps(_mm_loadu_ps(pToWall + i), ToWall));
+            _mm_storeu_ps(pToEmpty + i, _mm_min_ps(_mm_loadu_ps(pToEmpty + i), ToEmpty));
+        }
+    }
+#endif
+    for (; i < Count; ++i) {
+        pToWall[i] = std::min(pToWall[i], pNextToWall[i] + 1.f);
+        pToEmpty[i] = std::min(pToEmpty[i], pNextToEmpty[i] + 1.f);
+    }
+}
+
+// Lower envelope of the parabolas (x - q)^2 + F[q], gives the squared distance to the nearest
+// texel of the row taking the column distances in F into account. V and Z are scratch of N and
+// N + 1 elements.
+void DistanceTransform1D(const float *F, Int32 N, float *D, Int32 *V, float *Z) {
+    constexpr float Inf = std::numeric_limits<float>::infinity();
+
+    Int32 k = 0;
+    V[0] = 0;
+    Z[0] = -Inf;
+    Z[1] = Inf;
+    for (Int32 q = 1; q < N; ++q) {
+        const float Fq = F[q] + static_cast<float>(q * q);
+        auto Intersect = [&](Int32 p) {
+            return (Fq - (F[p] + static_cast<float>(p * p))) / static_cast<float>(2 * (q - p));
+        };
+        float s = Intersect(V[k]);
+        while (s <= Z[k]) {
+            --k;
+            s = Intersect(V[k]);
+        }
+        ++k;
+        V[k] = q;
+        Z[k] = s;
+        Z[k + 1] = Inf;
+    }
+
+    k = 0;
+    for (Int32 q = 0; q < N; ++q) {
+        while (Z[k + 1] < static_cast<float>(q)) {
+            ++k;
+        }
+        const Int32 p = V[k];
+        D[q] = static_cast<float>((q - p) * (q - p)) + F[p];
+    }
+}
+
+}
+
+SDFBaker::SDFBaker(const SDFParams &Params, ThreadPool *Workers) : mParams(Params), mWorkers(Workers) {}
+
+const char *SDFBaker::GetKernelName() {
+#if BT_SDF_AVX2
+    return "AVX2";
+#elif BT_SDF_SSE
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void SDFBaker::Bake(const Uint8 *pWallMap, Uint32 Width, Uint32 Height, float *pOutSDF) {
+    BakeRegion(pWallMap, Width, Height, SDFRect::Full(Width, Height), pOutSDF);
+}
+
+void SDFBaker::BakeRegion(const Uint8 *pWallMap, Uint32 Width, Uint32 Height, const SDFRect &Region,
+                          float *pOutSDF) {
+    const SDFRect Rect = Region.Expanded(0, Width, Height);
+    if (Rect.IsEmpty()) {
+        return;
+    }
+
+    // Every texel a distance in Rect can come from, texels farther away end up clamped
+    const SDFRect Halo = Rect.Expanded(mParams.Radius, Width, Height);
+    const Uint32 HaloWidth = Halo.X1 - Halo.X0;
+    const Uint32 HaloHeight = Halo.Y1 - Halo.Y0;
+    const Uint8 *pHaloWalls = pWallMap + static_cast<size_t>(Halo.Y0) * Width + Halo.X0;
+
+    const size_t NumTexels = static_cast<size_t>(HaloWidth) * HaloHeight;
+    mToWall.resize(NumTexels);
+    mToEmpty.resize(NumTexels);
+
+    // Anything farther than Radius ends up clamped, capping keeps the math small and exact
+    const float Cap = static_cast<float>(mParams.Radius + 1);
+
+    Uint32 NumJobs = 1;
+    if (mWorkers != nullptr) {
+        NumJobs = std::max<Uint32>(1, static_cast<Uint32>(std::min<size_t>(mWorkers->GetNumThreads() + 1,
+                                                                            NumTexels / MinTexelsPerJob)));
+    }
+    auto Run = [this](Uint32 Count, const std::function<void(Uint32)> &Fn) {
+        if (Count > 1) {
+            mWorkers->ParallelFor(Count, Fn);
+        } else {
+            Fn(0);
+        }
+    };
+
+    // Vertical pass over the halo, threads take strips of columns and walk them row by row
+    Uint32 StripWidth = (HaloWidth + NumJobs - 1) / NumJobs;
+    StripWidth = (StripWidth + ColumnAlignment - 1) / ColumnAlignment * ColumnAlignment;
+    const Uint32 NumStrips = (HaloWidth + StripWidth - 1) / StripWidth;
+    Run(NumStrips, [&](Uint32 Strip) {
+        const Uint32 X0 = Strip * StripWidth;
+        const Uint32 Count = std::min(StripWidth, HaloWidth - X0);
+
+        // The row above the halo counts as far from everything
+        std::vector<float> CapRow(Count, Cap);
+        SweepDown(pHaloWalls + X0, CapRow.data(), CapRow.data(), &mToWall[X0], &mToEmpty[X0], Count, Cap);
+        for (Uint32 y = 1; y < HaloHeight; ++y) {
+            const size_t Row = static_cast<size_t>(y) * HaloWidth + X0;
+            SweepDown(pHaloWalls + static_cast<size_t>(y) * Width + X0, &mToWall[Row - HaloWidth],
+                      &mToEmpty[Row - HaloWidth], &mToWall[Row], &mToEmpty[Row], Count, Cap);
+        }
+        for (Uint32 y = HaloHeight - 1; y-- > 0;) {
+            const size_t Row = static_cast<size_t>(y) * HaloWidth + X0;
+            SweepUp(&mToWall[Row + HaloWidth], &mToEmpty[Row + HaloWidth], &mToWall[Row], &mToEmpty[Row], Count);
+        }
+    });
+
+    // Horizontal pass over the rows of Rect only, threads take bands of rows
+    const Uint32 NumRows = Rect.Y1 - Rect.Y0;
+    const Uint32 BandHeight = (NumRows + NumJobs - 1) / NumJobs;
+    const Uint32 NumBands = (NumRows + BandHeight - 1) / BandHeight;
+    const float MaxDist = static_cast<float>(mParams.Radius);
+    const float DistScale = mParams.DistScale;
+    Run(NumBands, [&](Uint32 Band) {
+        std::vector<float> F(HaloWidth);
+        std::vector<float> DistToWall(HaloWidth);
+        std::vector<float> DistToEmpty(HaloWidth);
+        std::vector<Int32> V(HaloWidth);
+        std::vector<float> Z(HaloWidth + 1);
+
+        const Uint32 Y1 = std::min(Rect.Y1, Rect.Y0 + (Band + 1) * BandHeight);
+        for (Uint32 y = Rect.Y0 + Band * BandHeight; y < Y1; ++y) {
+            const size_t Row = static_cast<size_t>(y - Halo.Y0) * HaloWidth;
+            for (Uint32 x = 0; x < HaloWidth; ++x) {
+                F[x] = mToWall[Row + x] * mToWall[Row + x];
+            }
+            DistanceTransform1D(F.data(), static_cast<Int32>(HaloWidth), DistToWall.data(), V.data(), Z.data());
+            for (Uint32 x = 0; x < HaloWidth; ++x) {
+                F[x] = mToEmpty[Row + x] * mToEmpty[Row + x];
+            }
+            DistanceTransform1D(F.data(), static_cast<Int32>(HaloWidth), DistToEmpty.data(), V.data(), Z.data());
+
+            const size_t MapRow = static_cast<size_t>(y) * Width;
+            for (Uint32 x = Rect.X0; x < Rect.X1; ++x) {
+                const bool InsideWall = pWallMap[MapRow + x] > 127;
+                const Uint32 HaloX = x - Halo.X0;
+                const float Dist = std::min(std::sqrt(InsideWall ? DistToEmpty[HaloX] : DistToWall[HaloX]), MaxDist);
+                pOutSDF[MapRow + x] = (InsideWall ? -Dist : Dist) * DistScale;
+            }
+        }
+    });
+}
+
+}
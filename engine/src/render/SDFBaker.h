@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "render/SDFDirtyRegions.h"
+#include "render/SDFParams.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+class ThreadPool;
+
+// CPU counterpart of SDFGenerator for tools, tests and CPU-side queries. Uses the exact
+// Euclidean distance transform of Felzenszwalb and Huttenlocher, so the cost is linear in the
+// number of texels and does not depend on the radius. Results match the GPU generator up to
+// its R16F rounding: distance in texels to the nearest texel of the other kind, times
+// DistScale, clamped to Radius * DistScale and negative inside walls.
+class SDFBaker {
+  public:
+    // Without Workers everything runs on the calling thread
+    explicit SDFBaker(const SDFParams &Params = {}, ThreadPool *Workers = nullptr);
+
+    // pWallMap holds Width * Height bytes, a value above 127 is a wall like R > 0.5 in the
+    // shaders. Writes Width * Height distances in map units to pOutSDF.
+    void Bake(const Uint8 *pWallMap, Uint32 Width, Uint32 Height, float *pOutSDF);
+
+    // Same as Bake() but only writes the texels of Region. Reads the wall map up to Radius
+    // around it, so the cost follows the size of the region rather than the map.
+    void BakeRegion(const Uint8 *pWallMap, Uint32 Width, Uint32 Height, const SDFRect &Region, float *pOutSDF);
+
+    [[nodiscard]] const SDFParams &GetParams() const { return mParams; }
+
+    // Name of the SIMD instruction set the column pass was compiled with
+    [[nodiscard]] static const char *GetKernelName();
+
+  private:
+    SDFParams mParams;
+    ThreadPool *mWorkers;
+
+    // Distance in texels to the nearest wall / empty texel of the same column within the region
+    // being baked, capped at Radius + 1
+    std::vector<float> mToWall;
+    std::vector<float> mToEmpty;
+};
+
+}
@@ -0,0 +1,882 @@
+#include "SDFBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "render/ImageCompare.h"
+#include "render/PipelineCache.h"
+#include "render/SDFDirtyRegions.h"
+#include "render/SDFGenerator.h"
+#include "render/SDFMapRenderer.h"
+#include "render/SDFWorld.h"
+#include "render/TextureReadback.h"
+#include "core/Logging.h"
+#include "core/ThreadPool.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+namespace {
+
+constexpr Uint32 MapSizes[] = {256, 512, 1024, 2048};
+constexpr Uint32 Radii[] = {4, 8, 16, 32, 64};
+constexpr Uint32 Iterations = 10;
+constexpr Uint32 LightingMapSize = 1024;
+// Per-channel difference from the full resolution image that counts as a visible change
+constexpr Uint32 LightingTolerance = 8;
+constexpr Uint32 MapLightCounts[] = {16, 64, 256, 1024};
+// Fine texels of the world benchmark's reference map, which has its origin at the world's
+constexpr Uint32 WorldReferenceSize = 1024;
+// Lights stacked on the player, all reaching every tile, several times what a tile keeps
+constexpr Uint32 NumCrowdedLights = 4 * MaxLightsPerTile;
+// The 8-bit SDF saves bandwidth once the map no longer fits the texture cache
+constexpr Uint32 EncodingMapSizes[] = {1024, 4096};
+// Every swept radius is in ShaderPack.txt, without a pack they are compiled at run time
+constexpr auto PipelineTimeout = std::chrono::seconds(120);
+
+// Rooms carved out of solid rock plus scattered pillars, roughly what game maps look like
+std::vector<Uint8> MakeWallMap(Uint32 Size, Uint32 Seed) {
+    std::vector<Uint8> Map(static_cast<size_t>(Size) * Size, 255);
+    std::mt19937 Rng(Seed);
+    auto Fill = [&](Uint32 NumRects, Uint32 MinSize, Uint32 MaxSize, Uint8 Value) {
+        std::uniform_int_distribution<Uint32> Extent(MinSize, MaxSize);
+        std::uniform_int_distribution<Uint32> Pos(0, Size - 1);
+        for (Uint32 i = 0; i < NumRects; ++i) {
+            const Uint32 X0 = Pos(Rng), Y0 = Pos(Rng);
+            const Uint32 X1 = std::min(Size, X0 + Extent(Rng)), Y1 = std::min(Size, Y0 + Extent(Rng));
+            for (Uint32 y = Y0; y < Y1; ++y) {
+                std::fill(Map.begin() + y * Size + X0, Map.begin() + y * Size + X1, Value);
+            }
+        }
+    };
+    Fill(Size / 4, Size / 32, Size / 6, 0);
+    Fill(Size / 2, 2, 8, 255);
+    return Map;
+}
+
+float HalfToFloat(Uint16 Half) {
+    const Uint32 Sign = (Half >> 15) & 1u;
+    const Uint32 Exponent = (Half >> 10) & 0x1Fu;
+    const Uint32 Mantissa = Half & 0x3FFu;
+    float Value;
+    if (Exponent == 0) {
+        Value = std::ldexp(static_cast<float>(Mantissa), -24);
+    } else if (Exponent == 31) {
+        Value = Mantissa == 0 ? INFINITY : NAN;
+    } else {
+        Value = std::ldexp(static_cast<float>(Mantissa | 0x400u), static_cast<int>(Exponent) - 25);
+    }
+    return Sign != 0 ? -Value : Value;
+}
+
+bool ReadSDF(IDeviceContext *pCtx, TextureReadback &Readback, ITexture *pSDF, std::vector<float> &OutValues) {
+    StateTransitionDesc Barrier{pSDF, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_COPY_SOURCE,
+                                STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+    const auto &Desc = pSDF->GetDesc();
+    Readback.Copy(pCtx, pSDF, Desc.Width, Desc.Height);
+
+    std::vector<Uint8> Data;
+    if (!Readback.Read(pCtx, Data)) {
+        return false;
+    }
+    OutValues.resize(Data.size() / sizeof(Uint16));
+    for (size_t i = 0; i < OutValues.size(); ++i) {
+        Uint16 Half;
+        std::memcpy(&Half, Data.data() + i * sizeof(Uint16), sizeof(Uint16));
+        OutValues[i] = HalfToFloat(Half);
+    }
+    return true;
+}
+
+// Gives the pipelines PipelineTimeout to compile, the cache compiles them on its workers
+bool WaitForPipelines(PipelineCache &Cache, const std::function<bool()> &IsReady,
+                      const std::function<bool()> &IsFailed) {
+    const auto Deadline = std::chrono::steady_clock::now() + PipelineTimeout;
+    while (!IsReady()) {
+        if (IsFailed() || std::chrono::steady_clock::now() > Deadline) {
+            return false;
+        }
+        Cache.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool WaitForPipelines(PipelineCache &Cache, const SDFGenerator &Generator) {
+    for (auto Method: {SDFMethod::BruteForce, SDFMethod::JumpFlood}) {
+        if (!WaitForPipelines(Cache, [&] { return Generator.IsReady(Method); },
+                              [&] { return Generator.IsFailed(Method); })) {
+            log::Error(fmt::format("SDF benchmark: no {} pipeline for radius {}", GetSDFMethodName(Method),
+                                   Generator.GetParams().Radius));
+            return false;
+        }
+    }
+    return true;
+}
+
+// Without duration queries the time includes submission and the wait for the GPU
+RefCntAutoPtr<IQuery> CreateDurationQuery(IRenderDevice *pDevice) {
+    RefCntAutoPtr<IQuery> pQuery;
+    if (pDevice->GetDeviceInfo().Features.DurationQueries) {
+        QueryDesc Desc;
+        Desc.Name = "SDF benchmark query";
+        Desc.Type = QUERY_TYPE_DURATION;
+        pDevice->CreateQuery(Desc, &pQuery);
+    }
+    return pQuery;
+}
+
+// Average time of Iterations runs of Work, which records GPU commands
+double MeasureMs(IDeviceContext *pCtx, IQuery *pQuery, const std::function<void()> &Work) {
+    double TotalMs = 0.0;
+    for (Uint32 i = 0; i < Iterations; ++i) {
+        const auto Start = std::chrono::high_resolution_clock::now();
+        if (pQuery) {
+            pCtx->BeginQuery(pQuery);
+        }
+        Work();
+        if (pQuery) {
+            pCtx->EndQuery(pQuery);
+        }
+        pCtx->WaitForIdle();
+
+        QueryDataDuration Data;
+        if (pQuery && pQuery->GetData(&Data, sizeof(Data)) && Data.Frequency != 0) {
+            TotalMs += static_cast<double>(Data.Duration) * 1000.0 / static_cast<double>(Data.Frequency);
+        } else {
+            const auto End = std::chrono::high_resolution_clock::now();
+            TotalMs += std::chrono::duration<double, std::milli>(End - Start).count();
+        }
+    }
+    return TotalMs / Iterations;
+}
+
+RefCntAutoPtr<ITexture> CreateWallMapTexture(IRenderDevice *pDevice, const std::vector<Uint8> &WallMap, Uint32 Size) {
+    TextureDesc Desc;
+    Desc.Name = "SDF benchmark wall map";
+    Desc.Type = RESOURCE_DIM_TEX_2D;
+    Desc.Width = Size;
+    Desc.Height = Size;
+    Desc.Format = TEX_FORMAT_R8_UNORM;
+    Desc.Usage = USAGE_IMMUTABLE;
+    Desc.BindFlags = BIND_SHADER_RESOURCE;
+    TextureSubResData SubRes{WallMap.data(), Size};
+    TextureData InitData{&SubRes, 1};
+    RefCntAutoPtr<ITexture> pWallMap;
+    pDevice->CreateTexture(Desc, &InitData, &pWallMap);
+    return pWallMap;
+}
+
+RefCntAutoPtr<ITexture> CreateSDFTexture(IRenderDevice *pDevice, Uint32 Size,
+                                         TEXTURE_FORMAT Format = TEX_FORMAT_R16_FLOAT) {
+    TextureDesc Desc;
+    Desc.Name = "SDF benchmark output";
+    Desc.Type = RESOURCE_DIM_TEX_2D;
+    Desc.Width = Size;
+    Desc.Height = Size;
+    Desc.Format = Format;
+    Desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+    RefCntAutoPtr<ITexture> pSDF;
+    pDevice->CreateTexture(Desc, nullptr, &pSDF);
+    return pSDF;
+}
+
+bool ReadImage(IDeviceContext *pCtx, TextureReadback &Readback, ITexture *pColor, Uint32 Width, Uint32 Height,
+               Image &OutImage) {
+    StateTransitionDesc Barrier{pColor, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_COPY_SOURCE,
+                                STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+    Readback.Copy(pCtx, pColor, Width, Height);
+    OutImage.Width = Width;
+    OutImage.Height = Height;
+    return Readback.Read(pCtx, OutImage.Pixels);
+}
+
+// Point lights and cones of random colors in empty space, about one in three a cone
+std::vector<MapLight> MakeLights(const std::vector<Uint8> &WallMap, Uint32 Size, float DistScale, Uint32 NumLights) {
+    std::mt19937 Rng(NumLights);
+    std::uniform_int_distribution<Uint32> Texel(0, Size - 1);
+    std::uniform_real_distribution<float> Unit(0.f, 1.f);
+    std::vector<MapLight> Lights;
+    while (Lights.size() < NumLights) {
+        const Uint32 X = Texel(Rng), Y = Texel(Rng);
+        if (WallMap[static_cast<size_t>(Y) * Size + X] > 127) {
+            continue;
+        }
+        MapLight Light;
+        Light.Pos = float2(static_cast<float>(X) + 0.5f, static_cast<float>(Y) + 0.5f) * DistScale;
+        Light.Color = float3(Unit(Rng), Unit(Rng), Unit(Rng)) * 0.5f;
+        Light.Radius = static_cast<float>(Size) * DistScale * (0.02f + 0.04f * Unit(Rng));
+        if (Unit(Rng) < 0.3f) {
+            const float Angle = Unit(Rng) * 6.2831853f;
+            Light.Dir = float2(std::cos(Angle), std::sin(Angle));
+            Light.CosHalfAngle = 0.7f;
+        }
+        Lights.push_back(Light);
+    }
+    return Lights;
+}
+
+Int32 FloorDiv(Int32 A, Int32 B) {
+    return A >= 0 ? A / B : -((-A + B - 1) / B);
+}
+
+// Endless world of rooms on a grid, each with a door in its left and top walls and most with a
+// pillar. Only depends on the texel, so chunks generated in any order agree at their borders.
+bool IsProceduralWall(Int32 X, Int32 Y) {
+    constexpr Int32 RoomSize = 96;
+    constexpr Int32 WallThickness = 6;
+    constexpr Int32 DoorWidth = 24;
+    constexpr Int32 PillarSize = 10;
+    const Int32 RoomX = FloorDiv(X, RoomSize);
+    const Int32 RoomY = FloorDiv(Y, RoomSize);
+    const Int32 LocalX = X - RoomX * RoomSize;
+    const Int32 LocalY = Y - RoomY * RoomSize;
+
+    Uint32 Hash = static_cast<Uint32>(RoomX) * 73856093u ^ static_cast<Uint32>(RoomY) * 19349663u;
+    Hash ^= Hash >> 13;
+    Hash *= 0x5BD1E995u;
+    Hash ^= Hash >> 15;
+
+    constexpr auto DoorRange = static_cast<Uint32>(RoomSize - WallThickness - DoorWidth);
+    if (LocalX < WallThickness) {
+        const Int32 DoorY = WallThickness + static_cast<Int32>(Hash % DoorRange);
+        return LocalY < DoorY || LocalY >= DoorY + DoorWidth;
+    }
+    if (LocalY < WallThickness) {
+        const Int32 DoorX = WallThickness + static_cast<Int32>((Hash >> 8) % DoorRange);
+        return LocalX < DoorX || LocalX >= DoorX + DoorWidth;
+    }
+    if ((Hash >> 16) % 4 == 0) {
+        return false;
+    }
+    const Int32 PillarX = 24 + static_cast<Int32>((Hash >> 18) % 40);
+    const Int32 PillarY = 24 + static_cast<Int32>((Hash >> 24) % 40);
+    return LocalX >= PillarX && LocalX < PillarX + PillarSize && LocalY >= PillarY && LocalY < PillarY + PillarSize;
+}
+
+// SDFChunkSource of the procedural world, a downscaled byte takes the texel at its center
+void FillProceduralWalls(Int32 X, Int32 Y, Uint32 Width, Uint32 Height, Uint32 Downscale, Uint8 *pWalls) {
+    const auto Step = static_cast<Int32>(Downscale);
+    for (Uint32 y = 0; y < Height; ++y) {
+        for (Uint32 x = 0; x < Width; ++x) {
+            const Int32 TexelX = X + static_cast<Int32>(x) * Step + Step / 2;
+            const Int32 TexelY = Y + static_cast<Int32>(y) * Step + Step / 2;
+            pWalls[static_cast<size_t>(y) * Width + x] = IsProceduralWall(TexelX, TexelY) ? 255 : 0;
+        }
+    }
+}
+
+// First empty texel on a spiral around the map center
+std::pair<Uint32, Uint32> FindEmptyTexel(const std::vector<Uint8> &WallMap, Uint32 Size) {
+    const int Center = static_cast<int>(Size / 2);
+    for (int Ring = 0; Ring < Center; ++Ring) {
+        for (int y = Center - Ring; y <= Center + Ring; ++y) {
+            for (int x = Center - Ring; x <= Center + Ring; ++x) {
+                if (WallMap[static_cast<size_t>(y) * Size + x] <= 127) {
+                    return {static_cast<Uint32>(x), static_cast<Uint32>(y)};
+                }
+            }
+        }
+    }
+    return {Size / 2, Size / 2};
+}
+
+// The whole map on screen, lit by the player standing near its center
+void MakeLightingView(const std::vector<Uint8> &WallMap, Uint32 Size, float DistScale, MapConstants &OutMap,
+                      PlayerConstants &OutPlayer) {
+    const float MapExtent = static_cast<float>(Size) * DistScale;
+    OutMap = {};
+    OutMap.ScreenRectLR = float2(-1.f, 1.f);
+    OutMap.ScreenRectTB = float2(1.f, -1.f);
+    OutMap.UVToMap = float2(MapExtent, MapExtent);
+    OutMap.MapToUV = float2(1.f / MapExtent, 1.f / MapExtent);
+    OutMap.TeleportPos = float2(MapExtent * 0.25f, MapExtent * 0.25f);
+    OutMap.TeleportRadius = 2.f;
+    OutMap.TeleportWaveRadius = 8.f;
+
+    const auto PlayerTexel = FindEmptyTexel(WallMap, Size);
+    OutPlayer = {};
+    OutPlayer.PlayerPos = (float2(static_cast<float>(PlayerTexel.first), static_cast<float>(PlayerTexel.second)) +
+                           float2(0.5f, 0.5f)) * DistScale;
+    OutPlayer.PlayerRadius = 0.5f;
+    OutPlayer.AmbientLightRadius = MapExtent * 0.25f;
+    OutPlayer.FlashLightDir = normalize(float2(1.f, 0.3f));
+    OutPlayer.FlashLightPower = 1.f;
+    OutPlayer.FlshLightMaxDist = MapExtent * 0.5f;
+}
+
+}
+
+int RunSDFBenchmark(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache, const std::string &OutputDir) {
+    auto pQuery = CreateDurationQuery(pDevice);
+
+    std::error_code Error;
+    std::filesystem::create_directories(OutputDir, Error);
+    std::ofstream Csv(std::filesystem::path(OutputDir) / "sdf_benchmark.csv", std::ios::trunc);
+    Csv << "size,radius,method,ms,max_error,wrong_texels\n";
+    log::Info(fmt::format("SDF benchmark, {} iterations, {} time", Iterations, pQuery ? "GPU" : "CPU"));
+
+    TextureReadback Readback(pDevice);
+    std::vector<float> Reference;
+    std::vector<float> Values;
+
+    for (const Uint32 Radius: Radii) {
+        SDFGenerator Generator(pDevice, Cache, SDFParams{Radius});
+        if (!WaitForPipelines(Cache, Generator)) {
+            return 2;
+        }
+
+        for (const Uint32 Size: MapSizes) {
+            const auto WallMap = MakeWallMap(Size, Size);
+
+            auto pWallMap = CreateWallMapTexture(pDevice, WallMap, Size);
+            auto pSDF = CreateSDFTexture(pDevice, Size);
+            if (!pWallMap || !pSDF) {
+                log::Error(fmt::format("SDF benchmark: cannot create {0}x{0} textures", Size));
+                return 2;
+            }
+
+            for (auto Method: {SDFMethod::BruteForce, SDFMethod::JumpFlood}) {
+                // Warms up the pipeline and sizes the jump flood seed textures
+                Generator.Generate(pCtx, pWallMap, pSDF, Method);
+                pCtx->WaitForIdle();
+
+                const double Ms =
+                    MeasureMs(pCtx, pQuery, [&] { Generator.Generate(pCtx, pWallMap, pSDF, Method); });
+
+                // Brute force runs first and is the reference
+                auto &Result = Method == SDFMethod::BruteForce ? Reference : Values;
+                if (!ReadSDF(pCtx, Readback, pSDF, Result)) {
+                    log::Error("SDF benchmark: failed to read the result back");
+                    return 2;
+                }
+                float MaxError = 0.f;
+                Uint32 NumWrong = 0;
+                if (Method != SDFMethod::BruteForce) {
+                    // Errors under half a texel are the R16F rounding of larger distances
+                    const float Threshold = 0.5f * Generator.GetParams().DistScale;
+                    for (size_t i = 0; i < Values.size(); ++i) {
+                        const float Diff = std::abs(Values[i] - Reference[i]);
+                        MaxError = std::max(MaxError, Diff);
+                        NumWrong += Diff > Threshold ? 1 : 0;
+                    }
+                }
+
+                log::Info(fmt::format("  {0:>4}x{0:<4} radius {1:>2}  {2:<11} {3:9.3f} ms  max error {4:.4f} ({5})",
+                                      Size, Radius, GetSDFMethodName(Method), Ms, MaxError, NumWrong));
+                Csv << Size << ',' << Radius << ',' << GetSDFMethodName(Method) << ',' << Ms << ',' << MaxError << ','
+                    << NumWrong << '\n';
+            }
+        }
+    }
+    return 0;
+}
+
+int RunLightingBenchmark(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache, Uint32 Width,
+                         Uint32 Height, const std::string &OutputDir) {
+    auto pQuery = CreateDurationQuery(pDevice);
+
+    SDFGenerator Generator(pDevice, Cache);
+    SDFMapRenderer Renderer(pDevice, Cache, TEX_FORMAT_RGBA8_UNORM);
+    if (!WaitForPipelines(Cache, Generator)) {
+        return 2;
+    }
+
+    const auto WallMap = MakeWallMap(LightingMapSize, LightingMapSize);
+    auto pWallMap = CreateWallMapTexture(pDevice, WallMap, LightingMapSize);
+    auto pSDF = CreateSDFTexture(pDevice, LightingMapSize);
+
+    TextureDesc ColorDesc;
+    ColorDesc.Name = "Lighting benchmark color";
+    ColorDesc.Type = RESOURCE_DIM_TEX_2D;
+    ColorDesc.Width = Width;
+    ColorDesc.Height = Height;
+    ColorDesc.Format = TEX_FORMAT_RGBA8_UNORM;
+    ColorDesc.BindFlags = BIND_RENDER_TARGET;
+    RefCntAutoPtr<ITexture> pColor;
+    pDevice->CreateTexture(ColorDesc, nullptr, &pColor);
+    if (!pWallMap || !pSDF || !pColor) {
+        log::Error("Lighting benchmark: cannot create textures");
+        return 2;
+    }
+    Generator.Generate(pCtx, pWallMap, pSDF, SDFMethod::JumpFlood);
+
+    MapConstants Map;
+    PlayerConstants Player;
+    MakeLightingView(WallMap, LightingMapSize, Generator.GetParams().DistScale, Map, Player);
+
+    std::error_code Error;
+    std::filesystem::create_directories(OutputDir, Error);
+    const std::filesystem::path OutputPath(OutputDir);
+    std::ofstream Csv(OutputPath / "sdf_lighting.csv", std::ios::trunc);
+    Csv << "shadows,resolution,ms,speedup,max_difference,rms,differing_pixels\n";
+    log::Info(fmt::format("Lighting benchmark, {}x{}, {} iterations, {} time", Width, Height, Iterations,
+                          pQuery ? "GPU" : "CPU"));
+
+    TextureReadback Readback(pDevice);
+    auto *pRTV = pColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+    Image Reference;
+    double ReferenceMs = 0.0;
+    // Full resolution cone shadows, what temporal lighting converges to
+    Image ConeReference;
+    double ConeReferenceMs = 0.0;
+    // Full resolution three ray shadows run first and are the reference
+    for (auto Method: {SDFShadowMethod::ThreeRays, SDFShadowMethod::Cone}) {
+        for (auto Resolution: {SDFLightingResolution::Full, SDFLightingResolution::Half,
+                               SDFLightingResolution::Quarter}) {
+            const auto *MethodName = GetSDFShadowMethodName(Method);
+            const auto *Name = GetSDFLightingResolutionName(Resolution);
+            Renderer.SetShadowMethod(Method);
+            Renderer.SetLightingResolution(Resolution);
+            if (!WaitForPipelines(Cache, [&] { return Renderer.IsReady(); }, [&] { return Renderer.IsFailed(); })) {
+                log::Error(fmt::format("Lighting benchmark: no pipelines for {} resolution {} shadows", Name,
+                                       MethodName));
+                return 2;
+            }
+
+            // Warms up the pipelines and sizes the lighting target
+            Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player);
+            pCtx->WaitForIdle();
+            const double Ms =
+                MeasureMs(pCtx, pQuery, [&] { Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player); });
+
+            Image Result;
+            if (!ReadImage(pCtx, Readback, pColor, Width, Height, Result)) {
+                log::Error("Lighting benchmark: failed to read the image back");
+                return 2;
+            }
+            const auto FileName = fmt::format("lighting_{}_{}.ppm", Method == SDFShadowMethod::Cone ? "cone" : "rays",
+                                              Name);
+            SaveImagePPM((OutputPath / FileName).string(), Result);
+            if (Reference.Pixels.empty()) {
+                Reference = Result;
+                ReferenceMs = Ms;
+            }
+            if (Method == SDFShadowMethod::Cone && Resolution == SDFLightingResolution::Full) {
+                ConeReference = Result;
+                ConeReferenceMs = Ms;
+            }
+            const auto Diff = CompareImages(Result, Reference, LightingTolerance);
+            const double Speedup = Ms > 0.0 ? ReferenceMs / Ms : 0.0;
+
+            log::Info(fmt::format("  {:<10} {:<7} {:9.3f} ms  x{:.2f}  max difference {}  rms {:.3f}  {} over {}",
+                                  MethodName, Name, Ms, Speedup, Diff.MaxDifference, Diff.RootMeanSquare,
+                                  Diff.NumDifferingPixels, LightingTolerance));
+            Csv << MethodName << ',' << Name << ',' << Ms << ',' << Speedup << ',' << Diff.MaxDifference << ','
+                << Diff.RootMeanSquare << ',' << Diff.NumDifferingPixels << '\n';
+        }
+    }
+
+    // R16F against 8-bit SDFs of growing maps, cone shadows at full resolution. The 8-bit image is
+    // compared with the R16F one of the same map.
+    std::ofstream EncodingCsv(OutputPath / "sdf_encoding.csv", std::ios::trunc);
+    EncodingCsv << "size,encoding,sdf_bytes,ms,speedup,max_difference,rms,differing_pixels\n";
+    Renderer.SetShadowMethod(SDFShadowMethod::Cone);
+    Renderer.SetLightingResolution(SDFLightingResolution::Full);
+    if (!WaitForPipelines(Cache, [&] { return Renderer.IsReady(); }, [&] { return Renderer.IsFailed(); })) {
+        log::Error("Lighting benchmark: no pipelines for cone shadows");
+        return 2;
+    }
+    for (const Uint32 Size: EncodingMapSizes) {
+        const auto SizeWallMap = MakeWallMap(Size, Size);
+        auto pSizeWallMap = CreateWallMapTexture(pDevice, SizeWallMap, Size);
+        MapConstants SizeMap;
+        PlayerConstants SizePlayer;
+        MakeLightingView(SizeWallMap, Size, Generator.GetParams().DistScale, SizeMap, SizePlayer);
+
+        Image EncodingReference;
+        double EncodingReferenceMs = 0.0;
+        for (auto Encoding: {SDFEncoding::Float16, SDFEncoding::Unorm8}) {
+            const auto *Name = Encoding == SDFEncoding::Unorm8 ? "unorm8" : "float16";
+            SDFParams Params;
+            Params.Encoding = Encoding;
+            SDFGenerator EncodingGenerator(pDevice, Cache, Params);
+            if (!WaitForPipelines(Cache, EncodingGenerator)) {
+                return 2;
+            }
+            auto pEncodedSDF = CreateSDFTexture(pDevice, Size, GetSDFTextureFormat(Encoding));
+            if (!pSizeWallMap || !pEncodedSDF) {
+                log::Error(fmt::format("Lighting benchmark: cannot create {0}x{0} textures", Size));
+                return 2;
+            }
+            EncodingGenerator.Generate(pCtx, pSizeWallMap, pEncodedSDF, SDFMethod::JumpFlood);
+            SizeMap.SDFDecodeScale = GetSDFDecodeScale(Params);
+            SizeMap.SDFDecodeBias = GetSDFDecodeBias(Params);
+
+            Renderer.Render(pCtx, pRTV, Width, Height, pEncodedSDF, SizeMap, SizePlayer);
+            pCtx->WaitForIdle();
+            const double Ms = MeasureMs(pCtx, pQuery, [&] {
+                Renderer.Render(pCtx, pRTV, Width, Height, pEncodedSDF, SizeMap, SizePlayer);
+            });
+
+            Image Result;
+            if (!ReadImage(pCtx, Readback, pColor, Width, Height, Result)) {
+                log::Error("Lighting benchmark: failed to read the image back");
+                return 2;
+            }
+            SaveImagePPM((OutputPath / fmt::format("lighting_{}_{}.ppm", Name, Size)).string(), Result);
+            if (Encoding == SDFEncoding::Float16) {
+                EncodingReference = Result;
+                EncodingReferenceMs = Ms;
+            }
+            const auto Diff = CompareImages(Result, EncodingReference, LightingTolerance);
+            const double Speedup = Ms > 0.0 ? EncodingReferenceMs / Ms : 0.0;
+            const Uint64 Bytes = static_cast<Uint64>(Size) * Size * (Encoding == SDFEncoding::Unorm8 ? 1 : 2);
+
+            log::Info(fmt::format("  {0:>4}x{0:<4} {1:<7} {2:>5} MB {3:9.3f} ms  x{4:.2f}  max difference {5}  "
+                                  "rms {6:.3f}  {7} over {8}",
+                                  Size, Name, Bytes >> 20, Ms, Speedup, Diff.MaxDifference, Diff.RootMeanSquare,
+                                  Diff.NumDifferingPixels, LightingTolerance));
+            EncodingCsv << Size << ',' << Name << ',' << Bytes << ',' << Ms << ',' << Speedup << ','
+                        << Diff.MaxDifference << ',' << Diff.RootMeanSquare << ',' << Diff.NumDifferingPixels << '\n';
+        }
+    }
+
+    // Temporal lighting with cone shadows: the first frames after the history is cleared, then the time
+    // per frame of a still view. Compared with cone shadows traced every frame.
+    std::ofstream TemporalCsv(OutputPath / "sdf_temporal.csv", std::ios::trunc);
+    TemporalCsv << "frames,ms,speedup,max_difference,rms,differing_pixels\n";
+    Renderer.SetShadowMethod(SDFShadowMethod::Cone);
+    Renderer.SetTemporalLighting(true);
+    if (!WaitForPipelines(Cache, [&] { return Renderer.IsReady(); }, [&] { return Renderer.IsFailed(); })) {
+        log::Error("Lighting benchmark: no pipelines for temporal lighting");
+        return 2;
+    }
+    auto ReportTemporal = [&](const std::string &Frames, double Ms) {
+        Image Result;
+        if (!ReadImage(pCtx, Readback, pColor, Width, Height, Result)) {
+            log::Error("Lighting benchmark: failed to read the image back");
+            return false;
+        }
+        SaveImagePPM((OutputPath / fmt::format("lighting_temporal_{}.ppm", Frames)).string(), Result);
+        const auto Diff = CompareImages(Result, ConeReference, LightingTolerance);
+        const double Speedup = Ms > 0.0 ? ConeReferenceMs / Ms : 0.0;
+
+        log::Info(fmt::format("  temporal {:<6} {:9.3f} ms  x{:.2f}  max difference {}  rms {:.3f}  {} over {}",
+                              Frames, Ms, Speedup, Diff.MaxDifference, Diff.RootMeanSquare, Diff.NumDifferingPixels,
+                              LightingTolerance));
+        TemporalCsv << Frames << ',' << Ms << ',' << Speedup << ',' << Diff.MaxDifference << ','
+                    << Diff.RootMeanSquare << ',' << Diff.NumDifferingPixels << '\n';
+        return true;
+    };
+    // Every pixel has been traced after 4 frames
+    Renderer.InvalidateHistory();
+    for (Uint32 Frame = 1; Frame <= 4; ++Frame) {
+        Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player);
+        if (!ReportTemporal(fmt::format("{}", Frame), 0.0)) {
+            return 2;
+        }
+    }
+    const double TemporalMs =
+        MeasureMs(pCtx, pQuery, [&] { Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player); });
+    if (!ReportTemporal("still", TemporalMs)) {
+        return 2;
+    }
+    Renderer.SetTemporalLighting(false);
+
+    // Map lights on top of the player's, binned into tiles. Cone shadows at full resolution.
+    std::ofstream LightsCsv(OutputPath / "sdf_lights.csv", std::ios::trunc);
+    LightsCsv << "lights,ms\n";
+    Renderer.SetShadowMethod(SDFShadowMethod::Cone);
+    Renderer.SetLightingResolution(SDFLightingResolution::Full);
+    for (const Uint32 NumLights: MapLightCounts) {
+        Renderer.SetLights(MakeLights(WallMap, LightingMapSize, Generator.GetParams().DistScale, NumLights));
+        if (!WaitForPipelines(Cache, [&] { return Renderer.IsReady(); }, [&] { return Renderer.IsFailed(); })) {
+            log::Error("Lighting benchmark: no pipelines for map lights");
+            return 2;
+        }
+
+        Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player);
+        pCtx->WaitForIdle();
+        const double Ms =
+            MeasureMs(pCtx, pQuery, [&] { Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player); });
+
+        Image Result;
+        if (ReadImage(pCtx, Readback, pColor, Width, Height, Result)) {
+            SaveImagePPM((OutputPath / fmt::format("lighting_lights_{}.ppm", NumLights)).string(), Result);
+        }
+        log::Info(fmt::format("  {:>4} map lights {:9.3f} ms", NumLights, Ms));
+        LightsCsv << NumLights << ',' << Ms << '\n';
+    }
+
+    // Over-full tiles must keep the same lights every frame, the first MaxLightsPerTile ones. The
+    // colors are dim so that no sum saturates and any other choice of lights changes the image.
+    std::vector<MapLight> Crowded(NumCrowdedLights);
+    std::mt19937 Rng(NumCrowdedLights);
+    std::uniform_real_distribution<float> Unit(0.f, 1.f);
+    for (auto &Light: Crowded) {
+        Light.Pos = Player.PlayerPos;
+        Light.Color = float3(Unit(Rng), Unit(Rng), Unit(Rng)) * 0.01f;
+        Light.Radius = Map.UVToMap.x * 2.f;
+    }
+    Image First;
+    Renderer.SetLights(Crowded);
+    for (Uint32 i = 0; i <= Iterations; ++i) {
+        Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player);
+        Image Result;
+        if (!ReadImage(pCtx, Readback, pColor, Width, Height, Result)) {
+            log::Error("Lighting benchmark: failed to read the image back");
+            return 2;
+        }
+        if (i == 0) {
+            First = std::move(Result);
+        } else if (CompareImages(Result, First, 0).NumDifferingPixels != 0) {
+            log::Error(fmt::format("Lighting benchmark: frame {} with {} lights on one spot differs from the first",
+                                   i, NumCrowdedLights));
+            return 1;
+        }
+    }
+    Renderer.SetLights({Crowded.begin(), Crowded.begin() + MaxLightsPerTile});
+    Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player);
+    Image FirstLights;
+    if (!ReadImage(pCtx, Readback, pColor, Width, Height, FirstLights)) {
+        log::Error("Lighting benchmark: failed to read the image back");
+        return 2;
+    }
+    const auto Diff = CompareImages(FirstLights, First, 0);
+    log::Info(fmt::format("  {} lights on one spot: {} frames identical, max difference {} from the first {}",
+                          NumCrowdedLights, Iterations + 1, Diff.MaxDifference, MaxLightsPerTile));
+    if (Diff.NumDifferingPixels != 0) {
+        log::Error("Lighting benchmark: over-full tiles do not keep their first lights");
+        return 1;
+    }
+    return 0;
+}
+
+int RunSDFRegionCheck(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache) {
+    // Small enough for a software adapter, large enough that the dirty regions stay regions
+    constexpr Uint32 Size = 256;
+    constexpr Uint32 CheckRadii[] = {8, 32};
+    // One edit inside the map and one against its corner, which clamps the halo
+    constexpr SDFRect Edits[] = {{100, 90, 124, 106}, {0, 236, 20, 256}};
+
+    const auto OldMap = MakeWallMap(Size, Size);
+    auto NewMap = OldMap;
+    for (const auto &Edit: Edits) {
+        for (Uint32 y = Edit.Y0; y < Edit.Y1; ++y) {
+            for (Uint32 x = Edit.X0; x < Edit.X1; ++x) {
+                // Flipping walls and floor both removes seeds and adds new ones
+                NewMap[y * Size + x] = 255 - NewMap[y * Size + x];
+            }
+        }
+    }
+
+    auto pOldMap = CreateWallMapTexture(pDevice, OldMap, Size);
+    auto pNewMap = CreateWallMapTexture(pDevice, NewMap, Size);
+    auto pRegionSDF = CreateSDFTexture(pDevice, Size);
+    auto pFullSDF = CreateSDFTexture(pDevice, Size);
+    if (!pOldMap || !pNewMap || !pRegionSDF || !pFullSDF) {
+        log::Error(fmt::format("SDF region check: cannot create {0}x{0} textures", Size));
+        return 2;
+    }
+
+    TextureReadback Readback(pDevice);
+    std::vector<float> Region;
+    std::vector<float> Full;
+    bool Match = true;
+
+    for (const Uint32 Radius: CheckRadii) {
+        SDFGenerator Generator(pDevice, Cache, SDFParams{Radius});
+        if (!WaitForPipelines(Cache, Generator)) {
+            return 2;
+        }
+
+        for (auto Method: {SDFMethod::BruteForce, SDFMethod::JumpFlood}) {
+            SDFDirtyRegions Dirty;
+            for (const auto &Edit: Edits) {
+                Dirty.Add(Edit);
+            }
+            const auto Rects = Dirty.Take(Radius, Size, Size);
+
+            Generator.Generate(pCtx, pOldMap, pRegionSDF, Method);
+            for (const auto &Rect: Rects) {
+                Generator.GenerateRegion(pCtx, pNewMap, pRegionSDF, Rect, Method);
+            }
+            Generator.Generate(pCtx, pNewMap, pFullSDF, Method);
+            pCtx->WaitForIdle();
+
+            if (!ReadSDF(pCtx, Readback, pRegionSDF, Region) || !ReadSDF(pCtx, Readback, pFullSDF, Full)) {
+                log::Error("SDF region check: failed to read the result back");
+                return 2;
+            }
+            float MaxError = 0.f;
+            Uint32 NumDiffering = 0;
+            for (size_t i = 0; i < Region.size(); ++i) {
+                const float Diff = std::abs(Region[i] - Full[i]);
+                MaxError = std::max(MaxError, Diff);
+                NumDiffering += Diff > 0.f ? 1 : 0;
+            }
+
+            log::Info(fmt::format("  radius {:>2}  {:<11} {} regions  max error {:.4f} ({})", Radius,
+                                  GetSDFMethodName(Method), Rects.size(), MaxError, NumDiffering));
+            // A regional jump flood only propagates seeds through the halo, so it may settle on
+            // different seeds than the full one where both are approximate
+            if (Method == SDFMethod::BruteForce && NumDiffering != 0) {
+                log::Error(fmt::format("SDF region check: brute force region update differs at radius {}", Radius));
+                Match = false;
+            }
+        }
+    }
+    return Match ? 0 : 1;
+}
+
+int RunSDFWorldBenchmark(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache, Uint32 Width,
+                         Uint32 Height, const std::string &OutputDir) {
+    SDFGenerator Generator(pDevice, Cache);
+    SDFMapRenderer Renderer(pDevice, Cache, TEX_FORMAT_RGBA8_UNORM);
+    if (!WaitForPipelines(Cache, Generator)) {
+        return 2;
+    }
+    const auto &Params = Generator.GetParams();
+
+    // The single texture path reads the same walls from a map at the world origin
+    std::vector<Uint8> ReferenceWalls(static_cast<size_t>(WorldReferenceSize) * WorldReferenceSize);
+    FillProceduralWalls(0, 0, WorldReferenceSize, WorldReferenceSize, 1, ReferenceWalls.data());
+    auto pWallMap = CreateWallMapTexture(pDevice, ReferenceWalls, WorldReferenceSize);
+    auto pSDF = CreateSDFTexture(pDevice, WorldReferenceSize);
+
+    TextureDesc ColorDesc;
+    ColorDesc.Name = "SDF world benchmark color";
+    ColorDesc.Type = RESOURCE_DIM_TEX_2D;
+    ColorDesc.Width = Width;
+    ColorDesc.Height = Height;
+    ColorDesc.Format = TEX_FORMAT_RGBA8_UNORM;
+    ColorDesc.BindFlags = BIND_RENDER_TARGET;
+    RefCntAutoPtr<ITexture> pColor;
+    pDevice->CreateTexture(ColorDesc, nullptr, &pColor);
+    if (!pWallMap || !pSDF || !pColor) {
+        log::Error("SDF world benchmark: cannot create textures");
+        return 2;
+    }
+    // Brute force gives exact distances like the SDFBaker that bakes the world chunks
+    Generator.Generate(pCtx, pWallMap, pSDF, SDFMethod::BruteForce);
+
+    // Destroyed after the world, whose last jobs may still run
+    ThreadPool Workers;
+    SDFWorldDesc WorldDesc;
+    WorldDesc.Params = Params;
+    SDFWorld World(pDevice, Workers, FillProceduralWalls, WorldDesc);
+    const Uint64 MemoryUsage = World.GetMemoryUsage();
+    const Uint32 NumSlots = WorldDesc.AtlasChunks * WorldDesc.AtlasChunks;
+
+    const auto PlayerTexel = FindEmptyTexel(ReferenceWalls, WorldReferenceSize);
+    const float2 PlayerPos =
+        (float2(static_cast<float>(PlayerTexel.first), static_cast<float>(PlayerTexel.second)) + float2(0.5f, 0.5f)) *
+        Params.DistScale;
+
+    // Out into negative coordinates and back to the player, much farther than the window reaches,
+    // without waiting for the chunks on the way. Memory must not grow with the distance covered.
+    constexpr Int32 NumWalkFrames = 200;
+    const float2 WalkEnd = PlayerPos + float2(-4800.f, 2400.f) * Params.DistScale;
+    Uint32 MaxPending = 0;
+    for (Int32 Frame = 0; Frame <= NumWalkFrames; ++Frame) {
+        const float T = 1.f - std::abs(1.f - 2.f * static_cast<float>(Frame) / NumWalkFrames);
+        World.Update(pCtx, PlayerPos + (WalkEnd - PlayerPos) * T);
+        MaxPending = std::max(MaxPending, World.GetNumPendingChunks());
+        if (World.GetMemoryUsage() != MemoryUsage || World.GetNumFineChunks() > NumSlots ||
+            World.GetNumPendingChunks() > WorldDesc.MaxJobsInFlight) {
+            log::Error(fmt::format("SDF world benchmark: frame {} has {} bytes, {} fine chunks and {} pending", Frame,
+                                   World.GetMemoryUsage(), World.GetNumFineChunks(), World.GetNumPendingChunks()));
+            return 1;
+        }
+    }
+
+    // Back at the player, everything around it must arrive
+    const auto Start = std::chrono::steady_clock::now();
+    const auto Deadline = Start + PipelineTimeout;
+    Uint32 NumUpdates = 0;
+    do {
+        if (std::chrono::steady_clock::now() > Deadline) {
+            log::Error(fmt::format("SDF world benchmark: {} chunks still pending", World.GetNumPendingChunks()));
+            return 2;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        World.Update(pCtx, PlayerPos);
+        ++NumUpdates;
+    } while (World.GetNumPendingChunks() != 0);
+    const double LoadMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+    Renderer.SetSDFWorld(&World);
+    if (!WaitForPipelines(Cache, [&] { return Renderer.IsReady(); }, [&] { return Renderer.IsFailed(); })) {
+        log::Error("SDF world benchmark: no SDF world pipelines");
+        return 2;
+    }
+
+    // 512 texels around the player, inside the fine chunks and away from the reference map
+    // edges, where the clamped brute force search differs from the endless world
+    constexpr float ViewTexels = 512.f;
+    MapConstants Map;
+    Map.ScreenRectLR = float2(-1.f, 1.f);
+    Map.ScreenRectTB = float2(1.f, -1.f);
+    Map.MapOrigin = PlayerPos - float2(ViewTexels, ViewTexels) * (0.5f * Params.DistScale);
+    Map.UVToMap = float2(ViewTexels, ViewTexels) * Params.DistScale;
+    const float ReferenceExtent = static_cast<float>(WorldReferenceSize) * Params.DistScale;
+    Map.MapToUV = float2(1.f / ReferenceExtent, 1.f / ReferenceExtent);
+    Map.TeleportPos = float2(-ReferenceExtent, -ReferenceExtent);
+    Map.TeleportRadius = 1.f;
+    Map.TeleportWaveRadius = 1.f;
+
+    PlayerConstants Player;
+    Player.PlayerPos = PlayerPos;
+    Player.PlayerRadius = 0.5f;
+    Player.AmbientLightRadius = ViewTexels * 0.25f * Params.DistScale;
+    Player.FlashLightDir = normalize(float2(1.f, 0.3f));
+    Player.FlashLightPower = 1.f;
+    Player.FlshLightMaxDist = ViewTexels * 0.5f * Params.DistScale;
+
+    std::error_code Error;
+    std::filesystem::create_directories(OutputDir, Error);
+    const std::filesystem::path OutputPath(OutputDir);
+    TextureReadback Readback(pDevice);
+    auto *pRTV = pColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+
+    Image WorldImage;
+    Renderer.Render(pCtx, pRTV, Width, Height, nullptr, Map, Player);
+    if (!ReadImage(pCtx, Readback, pColor, Width, Height, WorldImage)) {
+        log::Error("SDF world benchmark: failed to read the image back");
+        return 2;
+    }
+    SaveImagePPM((OutputPath / "sdf_world.ppm").string(), WorldImage);
+
+    Renderer.SetSDFWorld(nullptr);
+    if (!WaitForPipelines(Cache, [&] { return Renderer.IsReady(); }, [&] { return Renderer.IsFailed(); })) {
+        log::Error("SDF world benchmark: no SDF texture pipelines");
+        return 2;
+    }
+    Image ReferenceImage;
+    Renderer.Render(pCtx, pRTV, Width, Height, pSDF, Map, Player);
+    if (!ReadImage(pCtx, Readback, pColor, Width, Height, ReferenceImage)) {
+        log::Error("SDF world benchmark: failed to read the image back");
+        return 2;
+    }
+    SaveImagePPM((OutputPath / "sdf_world_reference.ppm").string(), ReferenceImage);
+
+    // Both read exact distances rounded to R16F, only the filtering across chunk borders differs
+    const auto Diff = CompareImages(WorldImage, ReferenceImage, LightingTolerance);
+    const Uint64 MaxDifferingPixels = static_cast<Uint64>(Width) * Height / 1000;
+    log::Info(fmt::format("SDF world benchmark: {:.1f} MB, at most {} chunks pending on the way, {:.1f} ms and {} "
+                          "updates to load around the player",
+                          static_cast<double>(MemoryUsage) / (1024.0 * 1024.0), MaxPending, LoadMs, NumUpdates));
+    log::Info(fmt::format("  {} fine chunks, max difference {} from the single texture, {} pixels over {}",
+                          World.GetNumFineChunks(), Diff.MaxDifference, Diff.NumDifferingPixels, LightingTolerance));
+    if (Diff.SizeMismatch || Diff.NumDifferingPixels > MaxDifferingPixels) {
+        log::Error("SDF world benchmark: the world lighting differs from the single texture");
+        return 1;
+    }
+    return 0;
+}
+
+}
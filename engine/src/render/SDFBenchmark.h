@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+class PipelineCache;
+
+// Times every SDFGenerator method on random wall maps over a range of map sizes and radii and
+// reports how far the jump flood result is from the brute force one. Results go to the log and
+// to sdf_benchmark.csv in OutputDir. Returns the process exit code like RunHeadless().
+int RunSDFBenchmark(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache, const std::string &OutputDir);
+
+// Draws a random map at Width x Height with every SDFShadowMethod traced at every
+// SDFLightingResolution and compares the images against full resolution three ray shadows.
+// Then compares 8-bit SDFs with R16F ones on growing maps, follows temporal lighting as it
+// converges and times growing numbers of tiled map lights. Results go to the log and to
+// sdf_lighting.csv, sdf_encoding.csv, sdf_temporal.csv and sdf_lights.csv in OutputDir, the
+// images to lighting_*.ppm for inspection. Returns 1 when tiles with more than MaxLightsPerTile
+// lights change between frames or do not keep their first lights.
+int RunLightingBenchmark(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache, Uint32 Width,
+                         Uint32 Height, const std::string &OutputDir);
+
+// Edits rectangles of a wall map and updates only the dirty regions of its SDF, then compares the
+// result with a full update of the edited map. Brute force must match exactly, the jump flood
+// difference is only reported. Returns 0 on a match, 1 on a mismatch and 2 when it cannot run.
+int RunSDFRegionCheck(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache);
+
+// Streams a procedural SDFWorld while its focus walks far out and back, checking on every frame
+// that memory stays fixed, then draws the map around the focus from the world and from a single
+// SDF texture of the same walls. Images go to sdf_world*.ppm in OutputDir. Returns 1 when memory
+// grows or the images differ.
+int RunSDFWorldBenchmark(IRenderDevice *pDevice, IDeviceContext *pCtx, PipelineCache &Cache, Uint32 Width,
+                         Uint32 Height, const std::string &OutputDir);
+
+}
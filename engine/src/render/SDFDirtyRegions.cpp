@@ -0,0 +1,76 @@
+#include "SDFDirtyRegions.h"
+
+#include <algorithm>
+
+namespace bt {
+
+namespace {
+
+// Share of the map above which the regions are replaced by one full update
+constexpr double FullUpdateFraction = 0.5;
+
+bool Overlap(const SDFRect &A, const SDFRect &B) {
+    return A.X0 < B.X1 && B.X0 < A.X1 && A.Y0 < B.Y1 && B.Y0 < A.Y1;
+}
+
+SDFRect Union(const SDFRect &A, const SDFRect &B) {
+    return {std::min(A.X0, B.X0), std::min(A.Y0, B.Y0), std::max(A.X1, B.X1), std::max(A.Y1, B.Y1)};
+}
+
+}
+
+SDFRect SDFRect::Expanded(Uint32 Amount, Uint32 Width, Uint32 Height) const {
+    return {X0 > Amount ? X0 - Amount : 0, Y0 > Amount ? Y0 - Amount : 0, std::min(X1 + Amount, Width),
+            std::min(Y1 + Amount, Height)};
+}
+
+void SDFDirtyRegions::Add(const SDFRect &Rect) {
+    if (!Rect.IsEmpty()) {
+        mRects.push_back(Rect);
+    }
+}
+
+void SDFDirtyRegions::AddAll(Uint32 Width, Uint32 Height) {
+    mRects.clear();
+    Add(SDFRect::Full(Width, Height));
+}
+
+std::vector<SDFRect> SDFDirtyRegions::Take(Uint32 Radius, Uint32 Width, Uint32 Height) {
+    std::vector<SDFRect> Result;
+    Result.reserve(mRects.size());
+    for (const auto &Rect: mRects) {
+        const auto Grown = Rect.Expanded(Radius, Width, Height);
+        if (!Grown.IsEmpty()) {
+            Result.push_back(Grown);
+        }
+    }
+    mRects.clear();
+
+    // Merging may make a rectangle overlap one that was checked before, repeat until stable.
+    // There are only a handful of edits per frame, quadratic is fine.
+    for (bool Merged = true; Merged;) {
+        Merged = false;
+        for (size_t i = 0; i < Result.size(); ++i) {
+            for (size_t j = i + 1; j < Result.size();) {
+                if (Overlap(Result[i], Result[j])) {
+                    Result[i] = Union(Result[i], Result[j]);
+                    Result.erase(Result.begin() + static_cast<std::ptrdiff_t>(j));
+                    Merged = true;
+                } else {
+                    ++j;
+                }
+            }
+        }
+    }
+
+    Uint64 Area = 0;
+    for (const auto &Rect: Result) {
+        Area += Rect.GetArea();
+    }
+    if (static_cast<double>(Area) > FullUpdateFraction * static_cast<double>(Width) * Height) {
+        Result.assign(1, SDFRect::Full(Width, Height));
+    }
+    return Result;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Texel rectangle [X0, X1) x [Y0, Y1)
+struct SDFRect {
+    Uint32 X0 = 0;
+    Uint32 Y0 = 0;
+    Uint32 X1 = 0;
+    Uint32 Y1 = 0;
+
+    [[nodiscard]] bool IsEmpty() const { return X0 >= X1 || Y0 >= Y1; }
+
+    [[nodiscard]] Uint64 GetArea() const { return IsEmpty() ? 0 : static_cast<Uint64>(X1 - X0) * (Y1 - Y0); }
+
+    // Grows the rectangle by Amount texels on every side without leaving a Width x Height map
+    [[nodiscard]] SDFRect Expanded(Uint32 Amount, Uint32 Width, Uint32 Height) const;
+
+    [[nodiscard]] static SDFRect Full(Uint32 Width, Uint32 Height) { return {0, 0, Width, Height}; }
+};
+
+// Collects the wall map texels changed since the last SDF update. Take() turns them into the
+// rectangles whose distances may have changed, which SDFGenerator::GenerateRegion() and
+// SDFBaker::BakeRegion() then recompute.
+class SDFDirtyRegions {
+  public:
+    void Add(const SDFRect &Rect);
+
+    // Everything changed, e.g. a new map was loaded
+    void AddAll(Uint32 Width, Uint32 Height);
+
+    [[nodiscard]] bool IsEmpty() const { return mRects.empty(); }
+
+    // Returns the dirty rectangles grown by Radius, the farthest a change is seen from, with
+    // overlapping ones merged, and forgets them. Falls back to the full map once the regions
+    // cover most of it, as updating them one by one would cost more than a single pass.
+    std::vector<SDFRect> Take(Uint32 Radius, Uint32 Width, Uint32 Height);
+
+  private:
+    std::vector<SDFRect> mRects;
+};
+
+}
@@ -0,0 +1,252 @@
+#include "SDFGenerator.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CommonlyUsedStates.h"
+#include "MapHelper.hpp"
+#include "fmt/core.h"
+
+namespace bt {
+
+namespace {
+
+constexpr Uint32 ThreadGroupSize = 8;
+
+using MacroList = std::vector<std::pair<std::string, std::string>>;
+
+// SDFRegionConstants in Structures.fxh
+struct SDFRegionConstants {
+    Int32 Region[4];
+    Int32 Step;
+    Int32 Padding[3];
+};
+
+RefCntAutoPtr<IPipelineState> CreateSDFPipeline(PipelineCache &Cache, const std::string &Name, const char *FilePath,
+                                                const char *EntryPoint, MacroList Macros, bool SamplesSource) {
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = Name.c_str();
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+    ShaderDesc CSDesc;
+    CSDesc.Type = SHADER_TYPE_COMPUTE;
+    CSDesc.Name = Name;
+    CSDesc.FilePath = FilePath;
+    CSDesc.EntryPoint = EntryPoint;
+    CSDesc.Macros = std::move(Macros);
+    PSOCreateInfo.pCS = Cache.GetShader(CSDesc);
+    if (PSOCreateInfo.pCS == nullptr) {
+        return {};
+    }
+
+    // Textures change with every call. The region buffer belongs to the generator and is set
+    // in its own bindings, as generators with the same parameters share the pipelines.
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+    ShaderResourceVariableDesc Vars[] = {
+        {SHADER_TYPE_COMPUTE, "cbSDFRegion", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    // The brute force search reads past the map edges
+    ImmutableSamplerDesc Samplers[] = {
+        {SHADER_TYPE_COMPUTE, "g_SrcTex", Sam_PointClamp},
+    };
+    if (SamplesSource) {
+        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers = Samplers;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(Samplers);
+    }
+
+    return RefCntAutoPtr<IPipelineState>(Cache.GetComputePipeline(PSOCreateInfo));
+}
+
+void SetTexture(IShaderResourceBinding *pSRB, const char *Name, ITexture *pTexture, TEXTURE_VIEW_TYPE ViewType) {
+    pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, Name)->Set(pTexture->GetDefaultView(ViewType));
+}
+
+}
+
+TEXTURE_FORMAT GetSDFTextureFormat(SDFEncoding Encoding) {
+    return Encoding == SDFEncoding::Unorm8 ? TEX_FORMAT_R8_UNORM : TEX_FORMAT_R16_FLOAT;
+}
+
+const char *GetSDFMethodName(SDFMethod Method) {
+    switch (Method) {
+        case SDFMethod::BruteForce:
+            return "brute force";
+        case SDFMethod::JumpFlood:
+            return "jump flood";
+        default:
+            return "unknown";
+    }
+}
+
+SDFGenerator::SDFGenerator(IRenderDevice *Device, PipelineCache &Cache, const SDFParams &Params) : mParams(Params) {
+    m_pDevice = Device;
+
+    BufferDesc CBDesc;
+    CBDesc.Name = "SDF region constants CB";
+    CBDesc.Size = sizeof(SDFRegionConstants);
+    CBDesc.Usage = USAGE_DYNAMIC;
+    CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pRegionConstants);
+
+    // Must match the permutations in ShaderPack.txt for the defaults to come from the pack
+    MacroList DistMacros = {{"RADIUS", fmt::format("{}", Params.Radius)},
+                            {"DIST_SCALE", fmt::format("{}", Params.DistScale)}};
+    if (Params.Encoding == SDFEncoding::Unorm8) {
+        DistMacros.emplace_back("SDF_UNORM8", "1");
+    }
+    const auto Suffix = fmt::format("R{} S{} E{}", Params.Radius, Params.DistScale,
+                                    static_cast<Uint32>(Params.Encoding));
+
+    const auto BruteForceKey = fmt::format("SDF brute force {}", Suffix);
+    mBruteForce.Pipeline = Cache.RequestPipeline(BruteForceKey, [DistMacros](PipelineCache &C) {
+        return CreateSDFPipeline(C, "SDF brute force CS", "GenerateSDF.hlsl", "main", DistMacros, true);
+    });
+    mInitSeeds.Pipeline = Cache.RequestPipeline("SDF jump flood seeds", [](PipelineCache &C) {
+        return CreateSDFPipeline(C, "SDF jump flood seeds CS", "JumpFloodSDF.hlsl", "InitSeeds", {{"INIT_SEEDS", "1"}},
+                                 false);
+    });
+    mJumpFlood.Pipeline = Cache.RequestPipeline("SDF jump flood step", [](PipelineCache &C) {
+        return CreateSDFPipeline(C, "SDF jump flood step CS", "JumpFloodSDF.hlsl", "JumpFlood", {{"JUMP_FLOOD", "1"}},
+                                 false);
+    });
+    const auto ResolveKey = fmt::format("SDF jump flood resolve {}", Suffix);
+    mResolve.Pipeline = Cache.RequestPipeline(ResolveKey, [DistMacros](PipelineCache &C) {
+        auto Macros = DistMacros;
+        Macros.emplace_back("RESOLVE", "1");
+        return CreateSDFPipeline(C, "SDF jump flood resolve CS", "JumpFloodSDF.hlsl", "Resolve", std::move(Macros),
+                                 false);
+    });
+}
+
+bool SDFGenerator::IsReady(SDFMethod Method) const {
+    if (Method == SDFMethod::BruteForce) {
+        return mBruteForce.Pipeline->IsReady();
+    }
+    return mInitSeeds.Pipeline->IsReady() && mJumpFlood.Pipeline->IsReady() && mResolve.Pipeline->IsReady();
+}
+
+bool SDFGenerator::IsFailed(SDFMethod Method) const {
+    if (Method == SDFMethod::BruteForce) {
+        return mBruteForce.Pipeline->IsFailed();
+    }
+    return mInitSeeds.Pipeline->IsFailed() || mJumpFlood.Pipeline->IsFailed() || mResolve.Pipeline->IsFailed();
+}
+
+Uint32 SDFGenerator::GetNumJumpFloodPasses(Uint32 Radius) {
+    Uint32 NumPasses = 1;
+    for (Uint32 Step = 1; Step * 2 <= Radius; Step *= 2) {
+        ++NumPasses;
+    }
+    return NumPasses + 1;
+}
+
+IShaderResourceBinding *SDFGenerator::GetSRB(Pass &P) {
+    if (!P.SRB) {
+        P.Pipeline->PSO->CreateShaderResourceBinding(&P.SRB, true);
+        P.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbSDFRegion")->Set(m_pRegionConstants);
+    }
+    return P.SRB;
+}
+
+void SDFGenerator::Dispatch(IDeviceContext *pCtx, Pass &P, const SDFRect &Rect, Int32 Step) {
+    {
+        MapHelper<SDFRegionConstants> Constants(pCtx, m_pRegionConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+        *Constants = SDFRegionConstants{{static_cast<Int32>(Rect.X0), static_cast<Int32>(Rect.Y0),
+                                         static_cast<Int32>(Rect.X1), static_cast<Int32>(Rect.Y1)},
+                                        Step,
+                                        {}};
+    }
+
+    pCtx->SetPipelineState(P.Pipeline->PSO);
+    pCtx->CommitShaderResources(P.SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    DispatchComputeAttribs Attribs;
+    Attribs.ThreadGroupCountX = (Rect.X1 - Rect.X0 + ThreadGroupSize - 1) / ThreadGroupSize;
+    Attribs.ThreadGroupCountY = (Rect.Y1 - Rect.Y0 + ThreadGroupSize - 1) / ThreadGroupSize;
+    pCtx->DispatchCompute(Attribs);
+}
+
+void SDFGenerator::ResizeSeeds(Uint32 Width, Uint32 Height) {
+    if (m_pSeeds[0] && m_pSeeds[0]->GetDesc().Width == Width && m_pSeeds[0]->GetDesc().Height == Height) {
+        return;
+    }
+
+    TextureDesc Desc;
+    Desc.Type = RESOURCE_DIM_TEX_2D;
+    Desc.Width = Width;
+    Desc.Height = Height;
+    Desc.Format = TEX_FORMAT_RGBA16_UINT;
+    Desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+    for (Uint32 i = 0; i < 2; ++i) {
+        const auto Name = fmt::format("SDF jump flood seeds {}", i);
+        Desc.Name = Name.c_str();
+        m_pSeeds[i].Release();
+        m_pDevice->CreateTexture(Desc, nullptr, &m_pSeeds[i]);
+    }
+}
+
+bool SDFGenerator::Generate(IDeviceContext *pCtx, ITexture *pWallMap, ITexture *pDstSDF, SDFMethod Method) {
+    const auto &DstDesc = pDstSDF->GetDesc();
+    return GenerateRegion(pCtx, pWallMap, pDstSDF, SDFRect::Full(DstDesc.Width, DstDesc.Height), Method);
+}
+
+bool SDFGenerator::GenerateRegion(IDeviceContext *pCtx, ITexture *pWallMap, ITexture *pDstSDF, const SDFRect &Region,
+                                  SDFMethod Method) {
+    if (!IsReady(Method)) {
+        return false;
+    }
+
+    const auto &DstDesc = pDstSDF->GetDesc();
+    const SDFRect Rect = Region.Expanded(0, DstDesc.Width, DstDesc.Height);
+    if (Rect.IsEmpty()) {
+        return true;
+    }
+
+    if (Method == SDFMethod::BruteForce) {
+        auto *pSRB = GetSRB(mBruteForce);
+        SetTexture(pSRB, "g_SrcTex", pWallMap, TEXTURE_VIEW_SHADER_RESOURCE);
+        SetTexture(pSRB, "g_DstTex", pDstSDF, TEXTURE_VIEW_UNORDERED_ACCESS);
+        Dispatch(pCtx, mBruteForce, Rect);
+        return true;
+    }
+
+    ResizeSeeds(DstDesc.Width, DstDesc.Height);
+
+    // Seeds of the texels up to Radius away from the region are all its distances can come from
+    const SDFRect Halo = Rect.Expanded(mParams.Radius, DstDesc.Width, DstDesc.Height);
+
+    auto *pSRB = GetSRB(mInitSeeds);
+    SetTexture(pSRB, "g_SrcTex", pWallMap, TEXTURE_VIEW_SHADER_RESOURCE);
+    SetTexture(pSRB, "g_SeedsOut", m_pSeeds[0], TEXTURE_VIEW_UNORDERED_ACCESS);
+    Dispatch(pCtx, mInitSeeds, Halo);
+
+    Uint32 Src = 0;
+    const Uint32 NumPasses = GetNumJumpFloodPasses(mParams.Radius);
+    Int32 Step = 1;
+    while (static_cast<Uint32>(Step) * 2 <= mParams.Radius) {
+        Step *= 2;
+    }
+    pSRB = GetSRB(mJumpFlood);
+    for (Uint32 i = 0; i < NumPasses; ++i) {
+        SetTexture(pSRB, "g_SeedsIn", m_pSeeds[Src], TEXTURE_VIEW_SHADER_RESOURCE);
+        SetTexture(pSRB, "g_SeedsOut", m_pSeeds[1 - Src], TEXTURE_VIEW_UNORDERED_ACCESS);
+        Dispatch(pCtx, mJumpFlood, Halo, Step);
+        Src = 1 - Src;
+        // The last pass repeats step 1, which fixes most of the texels plain jump flooding gets wrong
+        Step = std::max(Step / 2, 1);
+    }
+
+    pSRB = GetSRB(mResolve);
+    SetTexture(pSRB, "g_SeedsIn", m_pSeeds[Src], TEXTURE_VIEW_SHADER_RESOURCE);
+    SetTexture(pSRB, "g_DstTex", pDstSDF, TEXTURE_VIEW_UNORDERED_ACCESS);
+    Dispatch(pCtx, mResolve, Rect);
+    return true;
+}
+
+}
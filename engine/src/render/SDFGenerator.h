@@ -0,0 +1,86 @@
+#pragma once
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "render/PipelineCache.h"
+#include "render/SDFDirtyRegions.h"
+#include "render/SDFParams.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+enum class SDFMethod : Uint8 {
+    // GenerateSDF.hlsl, samples the whole (2 * Radius + 1)^2 neighbourhood of every texel
+    BruteForce,
+    // JumpFloodSDF.hlsl, about log2(Radius) + 4 full-screen passes of 9 taps each
+    JumpFlood,
+};
+
+[[nodiscard]] const char *GetSDFMethodName(SDFMethod Method);
+
+// Format of the SDF textures SDFGenerator writes with Encoding
+[[nodiscard]] TEXTURE_FORMAT GetSDFTextureFormat(SDFEncoding Encoding);
+
+// Turns a wall map (R > 0.5 is a wall) into the signed distance map read by DrawMap.hlsl:
+// distance in texels to the nearest texel of the other kind, times DistScale, clamped to
+// Radius * DistScale and negative inside walls. SDFBaker computes the same on the CPU.
+// With SDFEncoding::Unorm8 the distances are stored normalized, DrawMap.hlsl decodes them with
+// the GetSDFDecodeScale() and GetSDFDecodeBias() it gets in its MapConstants.
+class SDFGenerator {
+  public:
+    SDFGenerator(IRenderDevice *Device, PipelineCache &Cache, const SDFParams &Params = {});
+
+    [[nodiscard]] bool IsReady(SDFMethod Method) const;
+
+    // A pipeline of Method could not be created, e.g. a radius missing from the shader pack
+    [[nodiscard]] bool IsFailed(SDFMethod Method) const;
+
+    // pWallMap must be readable by shaders and pDstSDF a texture of GetSDFTextureFormat() of the
+    // same size with unordered access. Returns false while the pipelines for Method are still compiling.
+    bool Generate(IDeviceContext *pCtx, ITexture *pWallMap, ITexture *pDstSDF, SDFMethod Method);
+
+    // Same as Generate() but only writes the texels of Region, e.g. one returned by
+    // SDFDirtyRegions::Take(). The jump flood reads the wall map up to Radius around it.
+    bool GenerateRegion(IDeviceContext *pCtx, ITexture *pWallMap, ITexture *pDstSDF, const SDFRect &Region,
+                        SDFMethod Method);
+
+    [[nodiscard]] const SDFParams &GetParams() const { return mParams; }
+
+    // Jump flood steps between seeding and resolve: from the largest power of two not above
+    // Radius down to 1, plus one more step of 1
+    [[nodiscard]] static Uint32 GetNumJumpFloodPasses(Uint32 Radius);
+
+  private:
+    struct Pass {
+        PipelineHandle Pipeline;
+        RefCntAutoPtr<IShaderResourceBinding> SRB;
+    };
+
+    // Creates the pass binding once the pipeline is ready
+    IShaderResourceBinding *GetSRB(Pass &P);
+
+    // Runs one thread per texel of Rect
+    void Dispatch(IDeviceContext *pCtx, Pass &P, const SDFRect &Rect, Int32 Step = 0);
+
+    void ResizeSeeds(Uint32 Width, Uint32 Height);
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    // SDFRegionConstants, rewritten before every dispatch
+    RefCntAutoPtr<IBuffer> m_pRegionConstants;
+    // Ping-pong nearest wall / nearest empty texel coordinates of the jump flood
+    RefCntAutoPtr<ITexture> m_pSeeds[2];
+
+    SDFParams mParams;
+
+    Pass mBruteForce;
+    Pass mInitSeeds;
+    Pass mJumpFlood;
+    Pass mResolve;
+};
+
+}
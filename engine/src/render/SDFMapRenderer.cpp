@@ -0,0 +1,631 @@
+#include "SDFMapRenderer.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CommonlyUsedStates.h"
+#include "MapHelper.hpp"
+#include "fmt/core.h"
+
+namespace bt {
+
+namespace {
+
+constexpr TEXTURE_FORMAT LightingFormat = TEX_FORMAT_RG16_FLOAT;
+// SDF of the lighting pixels outside the map rect, far from any real value so they get no weight
+constexpr float NoLightingSDF = 60000.f;
+constexpr TEXTURE_FORMAT HistoryFormat = TEX_FORMAT_RGBA16_FLOAT;
+// History alpha of the pixels not traced since it was cleared
+constexpr float NoHistory = -1.f;
+// One pixel of every 2x2 block per frame, diagonal ones first so the first two frames cover the
+// block evenly
+constexpr Uint32 HistoryPhases[4][2] = {{0, 0}, {1, 1}, {1, 0}, {0, 1}};
+
+using MacroList = std::vector<std::pair<std::string, std::string>>;
+
+// LightingConstants in Structures.fxh
+struct LightingConstants {
+    float2 FullToLowRes;
+    float BilateralSharpness;
+    float Padding;
+};
+
+RefCntAutoPtr<IPipelineState> CreateMapPipeline(PipelineCache &Cache, const std::string &Name,
+                                                TEXTURE_FORMAT ColorFormat, const char *EntryPoint,
+                                                MacroList Macros) {
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = Name.c_str();
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+    PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
+    PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = ColorFormat;
+    // VSmain makes the map rect out of 4 vertices
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode = CULL_MODE_NONE;
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
+
+    ShaderDesc VSDesc;
+    VSDesc.Type = SHADER_TYPE_VERTEX;
+    VSDesc.Name = "Draw map VS";
+    VSDesc.FilePath = "DrawMap.hlsl";
+    VSDesc.EntryPoint = "VSmain";
+
+    ShaderDesc PSDesc;
+    PSDesc.Type = SHADER_TYPE_PIXEL;
+    PSDesc.Name = Name;
+    PSDesc.FilePath = "DrawMap.hlsl";
+    PSDesc.EntryPoint = EntryPoint;
+    PSDesc.Macros = std::move(Macros);
+
+    PSOCreateInfo.pVS = Cache.GetShader(VSDesc);
+    PSOCreateInfo.pPS = Cache.GetShader(PSDesc);
+    if (PSOCreateInfo.pVS == nullptr || PSOCreateInfo.pPS == nullptr) {
+        return {};
+    }
+
+    // Textures change with every call, the constant buffers belong to the renderer and are set
+    // in its own bindings as renderers with the same color format share the pipelines
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+    ShaderResourceVariableDesc Vars[] = {
+        {SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, "cbMapConstants", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "cbPlayerConstants", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "cbLightingConstants", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "cbLightCulling", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, "cbTemporalLighting", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    // The shading texture, the history and the SDF world indirection are read with Load(), only the SDF is
+    // filtered. The coarse clipmap of the world wraps around.
+    ImmutableSamplerDesc Samplers[] = {
+        {SHADER_TYPE_PIXEL, "g_SDFMap", Sam_LinearClamp},
+        {SHADER_TYPE_PIXEL, "g_SDFAtlas", Sam_LinearClamp},
+        {SHADER_TYPE_PIXEL, "g_SDFCoarse", Sam_LinearWrap},
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers = Samplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(Samplers);
+
+    return RefCntAutoPtr<IPipelineState>(Cache.GetGraphicsPipeline(PSOCreateInfo));
+}
+
+RefCntAutoPtr<IPipelineState> CreateTemporalLightingPipeline(PipelineCache &Cache, const std::string &Name,
+                                                             MacroList Macros) {
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = Name.c_str();
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+    ShaderDesc CSDesc;
+    CSDesc.Type = SHADER_TYPE_COMPUTE;
+    CSDesc.Name = Name;
+    CSDesc.FilePath = "DrawMap.hlsl";
+    CSDesc.EntryPoint = "CSTemporalLighting";
+    CSDesc.Macros = std::move(Macros);
+    PSOCreateInfo.pCS = Cache.GetShader(CSDesc);
+    if (PSOCreateInfo.pCS == nullptr) {
+        return {};
+    }
+
+    // Bound like the map pass
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+    ShaderResourceVariableDesc Vars[] = {
+        {SHADER_TYPE_COMPUTE, "cbMapConstants", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_COMPUTE, "cbPlayerConstants", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_COMPUTE, "cbLightCulling", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_COMPUTE, "cbTemporalLighting", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    ImmutableSamplerDesc Samplers[] = {
+        {SHADER_TYPE_COMPUTE, "g_SDFMap", Sam_LinearClamp},
+        {SHADER_TYPE_COMPUTE, "g_SDFAtlas", Sam_LinearClamp},
+        {SHADER_TYPE_COMPUTE, "g_SDFCoarse", Sam_LinearWrap},
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers = Samplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(Samplers);
+
+    return RefCntAutoPtr<IPipelineState>(Cache.GetComputePipeline(PSOCreateInfo));
+}
+
+RefCntAutoPtr<IPipelineState> CreateCullLightsPipeline(PipelineCache &Cache) {
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "Cull map lights";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+    ShaderDesc CSDesc;
+    CSDesc.Type = SHADER_TYPE_COMPUTE;
+    CSDesc.Name = "Cull map lights CS";
+    CSDesc.FilePath = "CullLights.hlsl";
+    PSOCreateInfo.pCS = Cache.GetShader(CSDesc);
+    if (PSOCreateInfo.pCS == nullptr) {
+        return {};
+    }
+
+    // The light buffers are recreated when they grow
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+    ShaderResourceVariableDesc Vars[] = {
+        {SHADER_TYPE_COMPUTE, "cbMapConstants", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_COMPUTE, "cbLightCulling", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    return RefCntAutoPtr<IPipelineState>(Cache.GetComputePipeline(PSOCreateInfo));
+}
+
+RefCntAutoPtr<IBuffer> CreateStructuredBuffer(IRenderDevice *pDevice, const char *Name, Uint32 Stride,
+                                              Uint32 NumElements, BIND_FLAGS BindFlags) {
+    BufferDesc Desc;
+    Desc.Name = Name;
+    Desc.Usage = USAGE_DEFAULT;
+    Desc.BindFlags = BindFlags;
+    Desc.Mode = BUFFER_MODE_STRUCTURED;
+    Desc.ElementByteStride = Stride;
+    Desc.Size = static_cast<Uint64>(Stride) * NumElements;
+    RefCntAutoPtr<IBuffer> pBuffer;
+    pDevice->CreateBuffer(Desc, nullptr, &pBuffer);
+    return pBuffer;
+}
+
+void SetVariable(IShaderResourceBinding *pSRB, SHADER_TYPE Stage, const char *Name, IDeviceObject *pObject) {
+    // Not every permutation has every resource
+    if (auto *pVar = pSRB->GetVariableByName(Stage, Name)) {
+        pVar->Set(pObject);
+    }
+}
+
+Uint32 GetDownscale(SDFLightingResolution Resolution) {
+    return static_cast<Uint32>(Resolution);
+}
+
+// LightCullingConstants in Structures.fxh
+struct LightCullingConstants {
+    Uint32 ScreenSize[2];
+    Uint32 NumTiles[2];
+    Uint32 NumLights;
+    Uint32 Padding[3];
+};
+
+// TemporalLightingConstants in Structures.fxh
+struct TemporalLightingConstants {
+    Uint32 ScreenSize[2];
+    Uint32 Phase[2];
+};
+
+// Only what the lighting depends on, the teleport wave moves every frame
+bool IsSameLighting(const MapConstants &A, const MapConstants &B) {
+    return A.ScreenRectLR == B.ScreenRectLR && A.ScreenRectTB == B.ScreenRectTB && A.UVToMap == B.UVToMap &&
+           A.MapToUV == B.MapToUV && A.MapOrigin == B.MapOrigin && A.SDFDecodeScale == B.SDFDecodeScale &&
+           A.SDFDecodeBias == B.SDFDecodeBias;
+}
+
+bool IsSameLighting(const PlayerConstants &A, const PlayerConstants &B) {
+    return A.PlayerPos == B.PlayerPos && A.AmbientLightRadius == B.AmbientLightRadius &&
+           A.FlashLightDir == B.FlashLightDir && A.FlashLightPower == B.FlashLightPower &&
+           A.FlshLightMaxDist == B.FlshLightMaxDist;
+}
+
+template <typename T> void WriteConstants(IDeviceContext *pCtx, IBuffer *pBuffer, const T &Value) {
+    MapHelper<T> Constants(pCtx, pBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+    *Constants = Value;
+}
+
+}
+
+const char *GetSDFLightingResolutionName(SDFLightingResolution Resolution) {
+    switch (Resolution) {
+        case SDFLightingResolution::Full:
+            return "full";
+        case SDFLightingResolution::Half:
+            return "half";
+        case SDFLightingResolution::Quarter:
+            return "quarter";
+        default:
+            return "unknown";
+    }
+}
+
+const char *GetSDFShadowMethodName(SDFShadowMethod Method) {
+    switch (Method) {
+        case SDFShadowMethod::ThreeRays:
+            return "three rays";
+        case SDFShadowMethod::Cone:
+            return "cone";
+        default:
+            return "unknown";
+    }
+}
+
+SDFMapRenderer::SDFMapRenderer(IRenderDevice *Device, PipelineCache &Cache, TEXTURE_FORMAT ColorFormat)
+    : mCache(Cache), mColorFormat(ColorFormat) {
+    m_pDevice = Device;
+
+    BufferDesc CBDesc;
+    CBDesc.Usage = USAGE_DYNAMIC;
+    CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    CBDesc.Name = "Map constants CB";
+    CBDesc.Size = sizeof(MapConstants);
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pMapConstants);
+    CBDesc.Name = "Player constants CB";
+    CBDesc.Size = sizeof(PlayerConstants);
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pPlayerConstants);
+    CBDesc.Name = "Lighting constants CB";
+    CBDesc.Size = sizeof(LightingConstants);
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pLightingConstants);
+    CBDesc.Name = "Light culling constants CB";
+    CBDesc.Size = sizeof(LightCullingConstants);
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pCullingConstants);
+    CBDesc.Name = "Temporal lighting constants CB";
+    CBDesc.Size = sizeof(TemporalLightingConstants);
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pTemporalConstants);
+
+    mCullLights.Pipeline = mCache.RequestPipeline("Cull map lights", [](PipelineCache &C) {
+        return CreateCullLightsPipeline(C);
+    });
+
+    RequestPipelines(0);
+}
+
+void SDFMapRenderer::SetSDFWorld(SDFWorld *World) {
+    // Most maps fit in one SDF texture, the SDF_WORLD permutations are requested by the first world
+    if (World != nullptr && !mWorldPipelinesRequested) {
+        RequestPipelines(1);
+        mWorldPipelinesRequested = true;
+    }
+    mWorld = World;
+}
+
+void SDFMapRenderer::RequestPipelines(Uint32 World) {
+    // The builders capture copies, never this
+    const TEXTURE_FORMAT ColorFormat = mColorFormat;
+    // Must match the permutations in ShaderPack.txt for them to come from the pack. Default
+    // values are left out, like the pack does.
+    for (auto Method: {SDFShadowMethod::ThreeRays, SDFShadowMethod::Cone}) {
+        MacroList ShadowMacros;
+        if (Method != SDFShadowMethod::ThreeRays) {
+            ShadowMacros.emplace_back("SHADOW_METHOD", fmt::format("{}", static_cast<Uint32>(Method)));
+        }
+        const auto MethodIndex = static_cast<Uint32>(Method);
+
+        MacroList LightingMacros = ShadowMacros;
+        if (World != 0) {
+            LightingMacros.emplace_back("SDF_WORLD", "1");
+        }
+        const auto LightingKey = fmt::format("Draw map lighting s{} w{}", MethodIndex, World);
+        mLighting[MethodIndex][World].Pipeline = mCache.RequestPipeline(LightingKey, [=](PipelineCache &C) {
+            return CreateMapPipeline(C, "Draw map lighting PS", LightingFormat, "PSLighting", LightingMacros);
+        });
+
+        for (auto Resolution: {SDFLightingResolution::Full, SDFLightingResolution::Half,
+                               SDFLightingResolution::Quarter}) {
+            for (Uint32 MapLights = 0; MapLights < 2; ++MapLights) {
+                const Uint32 Downscale = GetDownscale(Resolution);
+                MacroList Macros;
+                if (Downscale > 1) {
+                    Macros.emplace_back("LIGHTING_DOWNSCALE", fmt::format("{}", Downscale));
+                }
+                Macros.insert(Macros.end(), ShadowMacros.begin(), ShadowMacros.end());
+                if (MapLights != 0) {
+                    Macros.emplace_back("MAP_LIGHTS", "1");
+                }
+                if (World != 0) {
+                    Macros.emplace_back("SDF_WORLD", "1");
+                }
+                const auto Key = fmt::format("Draw map {} x{} s{} l{} w{}", static_cast<Uint32>(ColorFormat),
+                                             Downscale, MethodIndex, MapLights, World);
+                mMap[MethodIndex][GetResolutionIndex(Resolution)][MapLights][World].Pipeline =
+                    mCache.RequestPipeline(Key, [=](PipelineCache &C) {
+                        return CreateMapPipeline(C, "Draw map PS", ColorFormat, "PSmain", Macros);
+                    });
+            }
+        }
+
+        for (Uint32 MapLights = 0; MapLights < 2; ++MapLights) {
+            MacroList Macros = ShadowMacros;
+            if (MapLights != 0) {
+                Macros.emplace_back("MAP_LIGHTS", "1");
+            }
+            if (World != 0) {
+                Macros.emplace_back("SDF_WORLD", "1");
+            }
+            Macros.emplace_back("TEMPORAL_LIGHTING", "1");
+            const auto Key = fmt::format("Draw map {} temporal s{} l{} w{}", static_cast<Uint32>(ColorFormat),
+                                         MethodIndex, MapLights, World);
+            mMap[MethodIndex][TemporalModeIndex][MapLights][World].Pipeline =
+                mCache.RequestPipeline(Key, [=](PipelineCache &C) {
+                    return CreateMapPipeline(C, "Draw map PS", ColorFormat, "PSmain", Macros);
+                });
+            const auto TemporalKey = fmt::format("Draw map temporal lighting s{} l{} w{}", MethodIndex, MapLights,
+                                                 World);
+            mTemporalLighting[MethodIndex][MapLights][World].Pipeline =
+                mCache.RequestPipeline(TemporalKey, [=](PipelineCache &C) {
+                    return CreateTemporalLightingPipeline(C, "Draw map temporal lighting CS", Macros);
+                });
+        }
+    }
+}
+
+Uint32 SDFMapRenderer::GetResolutionIndex(SDFLightingResolution Resolution) {
+    switch (Resolution) {
+        case SDFLightingResolution::Half:
+            return 1;
+        case SDFLightingResolution::Quarter:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+bool SDFMapRenderer::IsReady() const {
+    if (!GetMapPass().Pipeline->IsReady()) {
+        return false;
+    }
+    if (!mLights.empty() && !mCullLights.Pipeline->IsReady()) {
+        return false;
+    }
+    if (mTemporal) {
+        return GetTemporalPass().Pipeline->IsReady();
+    }
+    return mResolution == SDFLightingResolution::Full || GetLightingPass().Pipeline->IsReady();
+}
+
+bool SDFMapRenderer::IsFailed() const {
+    if (GetMapPass().Pipeline->IsFailed()) {
+        return true;
+    }
+    if (!mLights.empty() && mCullLights.Pipeline->IsFailed()) {
+        return true;
+    }
+    if (mTemporal) {
+        return GetTemporalPass().Pipeline->IsFailed();
+    }
+    return mResolution != SDFLightingResolution::Full && GetLightingPass().Pipeline->IsFailed();
+}
+
+void SDFMapRenderer::SetLights(const std::vector<MapLight> &Lights) {
+    mLights = Lights;
+    mLightsChanged = true;
+    mHistoryValid = false;
+}
+
+void SDFMapRenderer::SetTemporalLighting(bool Enabled) {
+    if (Enabled != mTemporal) {
+        mTemporal = Enabled;
+        mHistoryValid = false;
+    }
+}
+
+IShaderResourceBinding *SDFMapRenderer::GetSRB(Pass &P) {
+    if (!P.SRB) {
+        P.Pipeline->PSO->CreateShaderResourceBinding(&P.SRB, true);
+        SetVariable(P.SRB, SHADER_TYPE_VERTEX, "cbMapConstants", m_pMapConstants);
+        SetVariable(P.SRB, SHADER_TYPE_PIXEL, "cbMapConstants", m_pMapConstants);
+        SetVariable(P.SRB, SHADER_TYPE_PIXEL, "cbPlayerConstants", m_pPlayerConstants);
+        SetVariable(P.SRB, SHADER_TYPE_PIXEL, "cbLightingConstants", m_pLightingConstants);
+        SetVariable(P.SRB, SHADER_TYPE_PIXEL, "cbLightCulling", m_pCullingConstants);
+        SetVariable(P.SRB, SHADER_TYPE_PIXEL, "cbTemporalLighting", m_pTemporalConstants);
+        SetVariable(P.SRB, SHADER_TYPE_COMPUTE, "cbMapConstants", m_pMapConstants);
+        SetVariable(P.SRB, SHADER_TYPE_COMPUTE, "cbPlayerConstants", m_pPlayerConstants);
+        SetVariable(P.SRB, SHADER_TYPE_COMPUTE, "cbLightCulling", m_pCullingConstants);
+        SetVariable(P.SRB, SHADER_TYPE_COMPUTE, "cbTemporalLighting", m_pTemporalConstants);
+    }
+    return P.SRB;
+}
+
+void SDFMapRenderer::BindSDF(IShaderResourceBinding *pSRB, SHADER_TYPE Stage, ITexture *pSDF) {
+    if (mWorld == nullptr) {
+        pSRB->GetVariableByName(Stage, "g_SDFMap")->Set(pSDF->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        return;
+    }
+    pSRB->GetVariableByName(Stage, "cbSDFWorld")->Set(mWorld->GetConstants());
+    pSRB->GetVariableByName(Stage, "g_SDFAtlas")
+        ->Set(mWorld->GetAtlas()->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    pSRB->GetVariableByName(Stage, "g_SDFCoarse")
+        ->Set(mWorld->GetCoarse()->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    pSRB->GetVariableByName(Stage, "g_SDFIndirection")
+        ->Set(mWorld->GetIndirection()->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+}
+
+void SDFMapRenderer::BindLights(IShaderResourceBinding *pSRB, SHADER_TYPE Stage) {
+    if (mLights.empty()) {
+        return;
+    }
+    pSRB->GetVariableByName(Stage, "g_Lights")->Set(m_pLights->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    pSRB->GetVariableByName(Stage, "g_TileLights")->Set(m_pTileLights->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+}
+
+void SDFMapRenderer::ResizeLightingTarget(Uint32 Width, Uint32 Height) {
+    if (m_pLightingTarget && m_pLightingTarget->GetDesc().Width == Width &&
+        m_pLightingTarget->GetDesc().Height == Height) {
+        return;
+    }
+
+    TextureDesc Desc;
+    Desc.Name = "Map lighting target";
+    Desc.Type = RESOURCE_DIM_TEX_2D;
+    Desc.Width = Width;
+    Desc.Height = Height;
+    Desc.Format = LightingFormat;
+    Desc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
+    Desc.ClearValue.Format = LightingFormat;
+    Desc.ClearValue.Color[1] = NoLightingSDF;
+    m_pLightingTarget.Release();
+    m_pDevice->CreateTexture(Desc, nullptr, &m_pLightingTarget);
+}
+
+void SDFMapRenderer::CullLights(IDeviceContext *pCtx, Uint32 Width, Uint32 Height) {
+    const auto NumLights = static_cast<Uint32>(mLights.size());
+    if (mLightsChanged) {
+        if (!m_pLights || m_pLights->GetDesc().Size < sizeof(MapLight) * NumLights) {
+            // Grows in powers of two so a slowly increasing light count does not recreate it every frame
+            Uint32 Capacity = 64;
+            while (Capacity < NumLights) {
+                Capacity *= 2;
+            }
+            m_pLights = CreateStructuredBuffer(m_pDevice, "Map lights", sizeof(MapLight), Capacity,
+                                               BIND_SHADER_RESOURCE);
+        }
+        pCtx->UpdateBuffer(m_pLights, 0, sizeof(MapLight) * NumLights, mLights.data(),
+                           RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        mLightsChanged = false;
+    }
+
+    const Uint32 NumTilesX = (Width + LightTileSize - 1) / LightTileSize;
+    const Uint32 NumTilesY = (Height + LightTileSize - 1) / LightTileSize;
+    const Uint32 NumEntries = NumTilesX * NumTilesY * (MaxLightsPerTile + 1);
+    if (!m_pTileLights || m_pTileLights->GetDesc().Size < sizeof(Uint32) * NumEntries) {
+        m_pTileLights = CreateStructuredBuffer(m_pDevice, "Map tile lights", sizeof(Uint32), NumEntries,
+                                               BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS);
+    }
+    WriteConstants(pCtx, m_pCullingConstants,
+                   LightCullingConstants{{Width, Height}, {NumTilesX, NumTilesY}, NumLights, {}});
+
+    auto *pSRB = GetSRB(mCullLights);
+    pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Lights")
+        ->Set(m_pLights->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_TileLights")
+        ->Set(m_pTileLights->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+    pCtx->SetPipelineState(mCullLights.Pipeline->PSO);
+    pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    DispatchComputeAttribs Attribs;
+    Attribs.ThreadGroupCountX = NumTilesX;
+    Attribs.ThreadGroupCountY = NumTilesY;
+    pCtx->DispatchCompute(Attribs);
+}
+
+void SDFMapRenderer::UpdateHistory(IDeviceContext *pCtx, Uint32 Width, Uint32 Height, ITexture *pSDF,
+                                   const MapConstants &Map, const PlayerConstants &Player) {
+    if (!m_pHistory || m_pHistory->GetDesc().Width != Width || m_pHistory->GetDesc().Height != Height) {
+        TextureDesc Desc;
+        Desc.Name = "Map lighting history";
+        Desc.Type = RESOURCE_DIM_TEX_2D;
+        Desc.Width = Width;
+        Desc.Height = Height;
+        Desc.Format = HistoryFormat;
+        // Cleared as a render target, written by the compute pass
+        Desc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET | BIND_UNORDERED_ACCESS;
+        Desc.ClearValue.Format = HistoryFormat;
+        Desc.ClearValue.Color[3] = NoHistory;
+        m_pHistory.Release();
+        m_pDevice->CreateTexture(Desc, nullptr, &m_pHistory);
+        mHistoryValid = false;
+    }
+
+    const Uint64 WorldVersion = mWorld != nullptr ? mWorld->GetVersion() : 0;
+    if (!IsSameLighting(Map, mHistoryMap) || !IsSameLighting(Player, mHistoryPlayer) || pSDF != mHistorySDF ||
+        mWorld != mHistoryWorld || WorldVersion != mHistoryWorldVersion || mShadowMethod != mHistoryMethod) {
+        mHistoryValid = false;
+    }
+    if (!mHistoryValid) {
+        auto *pHistoryRTV = m_pHistory->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+        pCtx->SetRenderTargets(1, &pHistoryRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        const float ClearColor[] = {0.f, 0.f, 0.f, NoHistory};
+        pCtx->ClearRenderTarget(pHistoryRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        pCtx->SetRenderTargets(0, nullptr, nullptr, RESOURCE_STATE_TRANSITION_MODE_NONE);
+
+        mHistoryMap = Map;
+        mHistoryPlayer = Player;
+        mHistorySDF = pSDF;
+        mHistoryWorld = mWorld;
+        mHistoryWorldVersion = WorldVersion;
+        mHistoryMethod = mShadowMethod;
+        mHistoryFrames = 0;
+        mHistoryValid = true;
+    }
+
+    const auto &Phase = HistoryPhases[mHistoryFrames % 4];
+    ++mHistoryFrames;
+    WriteConstants(pCtx, m_pTemporalConstants, TemporalLightingConstants{{Width, Height}, {Phase[0], Phase[1]}});
+
+    auto &TemporalPass = GetTemporalPass();
+    auto *pSRB = GetSRB(TemporalPass);
+    BindSDF(pSRB, SHADER_TYPE_COMPUTE, pSDF);
+    BindLights(pSRB, SHADER_TYPE_COMPUTE);
+    pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_HistoryOut")
+        ->Set(m_pHistory->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+    pCtx->SetPipelineState(TemporalPass.Pipeline->PSO);
+    pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // A thread per 2x2 block, 8x8 threads per group
+    DispatchComputeAttribs Attribs;
+    Attribs.ThreadGroupCountX = (Width + 15) / 16;
+    Attribs.ThreadGroupCountY = (Height + 15) / 16;
+    pCtx->DispatchCompute(Attribs);
+}
+
+bool SDFMapRenderer::Render(IDeviceContext *pCtx, ITextureView *pRTV, Uint32 Width, Uint32 Height, ITexture *pSDF,
+                            const MapConstants &Map, const PlayerConstants &Player) {
+    if (!IsReady()) {
+        return false;
+    }
+
+    WriteConstants(pCtx, m_pMapConstants, Map);
+    WriteConstants(pCtx, m_pPlayerConstants, Player);
+    if (!mLights.empty()) {
+        CullLights(pCtx, Width, Height);
+    }
+
+    DrawAttribs Attribs;
+    Attribs.NumVertices = 4;
+
+    const Uint32 Downscale = mTemporal ? 1 : GetDownscale(mResolution);
+    ITextureView *pShadingView = nullptr;
+    if (mTemporal) {
+        UpdateHistory(pCtx, Width, Height, pSDF, Map, Player);
+    } else if (Downscale > 1) {
+        const Uint32 LowResWidth = (Width + Downscale - 1) / Downscale;
+        const Uint32 LowResHeight = (Height + Downscale - 1) / Downscale;
+        ResizeLightingTarget(LowResWidth, LowResHeight);
+        WriteConstants(pCtx, m_pLightingConstants,
+                       LightingConstants{float2(static_cast<float>(LowResWidth) / static_cast<float>(Width),
+                                                static_cast<float>(LowResHeight) / static_cast<float>(Height)),
+                                         mBilateralSharpness, 0.f});
+
+        auto *pLightingRTV = m_pLightingTarget->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+        pCtx->SetRenderTargets(1, &pLightingRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        const float ClearColor[] = {0.f, NoLightingSDF, 0.f, 0.f};
+        pCtx->ClearRenderTarget(pLightingRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        Viewport LowResVP;
+        LowResVP.Width = static_cast<float>(LowResWidth);
+        LowResVP.Height = static_cast<float>(LowResHeight);
+        pCtx->SetViewports(1, &LowResVP, LowResWidth, LowResHeight);
+
+        auto &LightingPass = GetLightingPass();
+        auto *pSRB = GetSRB(LightingPass);
+        BindSDF(pSRB, SHADER_TYPE_PIXEL, pSDF);
+        pCtx->SetPipelineState(LightingPass.Pipeline->PSO);
+        pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pCtx->Draw(Attribs);
+
+        pShadingView = m_pLightingTarget->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    }
+
+    pCtx->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    Viewport VP;
+    VP.Width = static_cast<float>(Width);
+    VP.Height = static_cast<float>(Height);
+    const auto &RTDesc = pRTV->GetTexture()->GetDesc();
+    pCtx->SetViewports(1, &VP, RTDesc.Width, RTDesc.Height);
+
+    auto &MapPass = GetMapPass();
+    auto *pSRB = GetSRB(MapPass);
+    BindSDF(pSRB, SHADER_TYPE_PIXEL, pSDF);
+    if (pShadingView != nullptr) {
+        pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ShadingTex")->Set(pShadingView);
+    }
+    if (mTemporal) {
+        pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_History")
+            ->Set(m_pHistory->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    }
+    BindLights(pSRB, SHADER_TYPE_PIXEL);
+    pCtx->SetPipelineState(MapPass.Pipeline->PSO);
+    pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pCtx->Draw(Attribs);
+    return true;
+}
+
+}
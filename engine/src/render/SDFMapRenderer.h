@@ -0,0 +1,237 @@
+#pragma once
+
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "BasicMath.hpp"
+#include "render/PipelineCache.h"
+#include "render/SDFWorld.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// MapConstants in Structures.fxh
+struct MapConstants {
+    float2 ScreenRectLR; // left, right in normalized device coordinates
+    float2 ScreenRectTB; // top, bottom
+    float2 UVToMap;
+    float2 MapToUV;
+    float2 TeleportPos;
+    float TeleportRadius = 0.f;
+    float TeleportWaveRadius = 0.f;
+    float2 MapOrigin; // map position at UV (0, 0)
+    // SDF texture value to map units, GetSDFDecodeScale() and GetSDFDecodeBias() of the SDFParams
+    float SDFDecodeScale = 1.f;
+    float SDFDecodeBias = 0.f;
+};
+
+// PlayerConstants in Structures.fxh
+struct PlayerConstants {
+    float2 PlayerPos;
+    float PlayerRadius = 0.f;
+    float AmbientLightRadius = 0.f;
+    float2 FlashLightDir;
+    float FlashLightPower = 0.f;
+    float FlshLightMaxDist = 0.f;
+};
+
+// MapLight in Structures.fxh
+struct MapLight {
+    float2 Pos;
+    float2 Dir; // cone axis, unused by point lights
+    float3 Color;
+    float Radius = 0.f;        // no light beyond this distance
+    float CosHalfAngle = -1.f; // of the cone, -1 for point lights
+    float Padding[3] = {};
+};
+
+// LIGHT_TILE_SIZE and MAX_LIGHTS_PER_TILE in Structures.fxh
+constexpr Uint32 LightTileSize = 16;
+constexpr Uint32 MaxLightsPerTile = 63;
+
+// Resolution the shadows of the map are traced at, the value is the downscale factor
+enum class SDFLightingResolution : Uint8 {
+    Full = 1,
+    Half = 2,
+    Quarter = 4,
+};
+
+[[nodiscard]] const char *GetSDFLightingResolutionName(SDFLightingResolution Resolution);
+
+// SHADOW_METHOD of DrawMap.hlsl, both give a penumbra of the same width
+enum class SDFShadowMethod : Uint8 {
+    // Three rays from the pixel and from two points beside it
+    ThreeRays,
+    // One ray tracking how close it passes to the walls, about a third of the cost
+    Cone,
+};
+
+[[nodiscard]] const char *GetSDFShadowMethodName(SDFShadowMethod Method);
+
+// Draws the SDF map with DrawMap.hlsl. Below full resolution the shadow rays are traced by
+// PSLighting into a smaller target, and the full resolution pass upsamples that shading with
+// weights guided by the SDF instead of tracing every pixel.
+// Map lights come on top of the player's. CullLights.hlsl bins them into screen tiles, so a
+// pixel only traces the lights reaching its tile.
+// The SDF is either one texture covering the map or an SDFWorld streamed around the player.
+// With temporal lighting the rays of one pixel of every 2x2 block are traced per frame, in turn,
+// into a history that the map pass reads, see SetTemporalLighting().
+class SDFMapRenderer {
+  public:
+    SDFMapRenderer(IRenderDevice *Device, PipelineCache &Cache, TEXTURE_FORMAT ColorFormat);
+
+    void SetLightingResolution(SDFLightingResolution Resolution) { mResolution = Resolution; }
+
+    [[nodiscard]] SDFLightingResolution GetLightingResolution() const { return mResolution; }
+
+    void SetShadowMethod(SDFShadowMethod Method) { mShadowMethod = Method; }
+
+    [[nodiscard]] SDFShadowMethod GetShadowMethod() const { return mShadowMethod; }
+
+    // Traces a quarter of the pixels per frame, the player's lights and the map lights alike, and
+    // keeps the rest from earlier frames. The history is cleared when what the lighting depends on
+    // changes: the map rect, the player, the lights, the SDF texture, the SDF world's uploads or the
+    // shadow method. Until every pixel has had its turn, 4 frames later, the others take the average
+    // of their 2x2 block, so a moving view looks like half resolution lighting at a quarter of the cost
+    // and a still one converges to full quality. Replaces the lighting resolution while on.
+    void SetTemporalLighting(bool Enabled);
+
+    [[nodiscard]] bool GetTemporalLighting() const { return mTemporal; }
+
+    // The SDF texture passed to Render() was changed in place, e.g. by SDFGenerator::GenerateRegion().
+    // Clears the lighting history on the next Render().
+    void InvalidateHistory() { mHistoryValid = false; }
+
+    // Lights drawn from the next Render() on. A tile takes the first MaxLightsPerTile lights
+    // reaching it. The map lights are always traced at full resolution.
+    void SetLights(const std::vector<MapLight> &Lights);
+
+    [[nodiscard]] Uint32 GetNumLights() const { return static_cast<Uint32>(mLights.size()); }
+
+    // Upsampling weight falloff per map unit of SDF difference, higher keeps shadow edges
+    // sharper along the walls but lets more pixels fall back to a full resolution trace
+    void SetBilateralSharpness(float Sharpness) { mBilateralSharpness = Sharpness; }
+
+    // Reads the SDF from World instead of the texture passed to Render(), nullptr to go back.
+    // The world is not updated by the renderer.
+    void SetSDFWorld(SDFWorld *World);
+
+    // Pipelines of the current lighting resolution and shadow method
+    [[nodiscard]] bool IsReady() const;
+    [[nodiscard]] bool IsFailed() const;
+
+    // Draws into the top left Width x Height pixels of pRTV, pSDF is the output of SDFGenerator
+    // and may be nullptr with an SDF world. Leaves pRTV bound. Returns false while the pipelines are still compiling.
+    bool Render(IDeviceContext *pCtx, ITextureView *pRTV, Uint32 Width, Uint32 Height, ITexture *pSDF,
+                const MapConstants &Map, const PlayerConstants &Player);
+
+  private:
+    struct Pass {
+        PipelineHandle Pipeline;
+        RefCntAutoPtr<IShaderResourceBinding> SRB;
+    };
+
+    // Map pass variant reading the lighting history, after those of the lighting resolutions
+    static constexpr Uint32 TemporalModeIndex = 3;
+
+    // Passes of the current settings. At full resolution the map pass traces the shading itself.
+    Pass &GetMapPass() {
+        return mMap[static_cast<Uint32>(mShadowMethod)][GetModeIndex()][mLights.empty() ? 0 : 1]
+                   [mWorld != nullptr ? 1 : 0];
+    }
+    Pass &GetLightingPass() { return mLighting[static_cast<Uint32>(mShadowMethod)][mWorld != nullptr ? 1 : 0]; }
+    Pass &GetTemporalPass() {
+        return mTemporalLighting[static_cast<Uint32>(mShadowMethod)][mLights.empty() ? 0 : 1]
+                                [mWorld != nullptr ? 1 : 0];
+    }
+    [[nodiscard]] const Pass &GetMapPass() const {
+        return mMap[static_cast<Uint32>(mShadowMethod)][GetModeIndex()][mLights.empty() ? 0 : 1]
+                   [mWorld != nullptr ? 1 : 0];
+    }
+    [[nodiscard]] const Pass &GetLightingPass() const {
+        return mLighting[static_cast<Uint32>(mShadowMethod)][mWorld != nullptr ? 1 : 0];
+    }
+    [[nodiscard]] const Pass &GetTemporalPass() const {
+        return mTemporalLighting[static_cast<Uint32>(mShadowMethod)][mLights.empty() ? 0 : 1]
+                                [mWorld != nullptr ? 1 : 0];
+    }
+
+    [[nodiscard]] static Uint32 GetResolutionIndex(SDFLightingResolution Resolution);
+
+    [[nodiscard]] Uint32 GetModeIndex() const {
+        return mTemporal ? TemporalModeIndex : GetResolutionIndex(mResolution);
+    }
+
+    // Requests the map and lighting pipelines reading the SDF texture (0) or an SDF world (1)
+    void RequestPipelines(Uint32 World);
+
+    IShaderResourceBinding *GetSRB(Pass &P);
+
+    // The SDF texture, or the resources of the SDF world when there is one
+    void BindSDF(IShaderResourceBinding *pSRB, SHADER_TYPE Stage, ITexture *pSDF);
+
+    void BindLights(IShaderResourceBinding *pSRB, SHADER_TYPE Stage);
+
+    void ResizeLightingTarget(Uint32 Width, Uint32 Height);
+
+    // Uploads the lights if they changed and rebuilds the tile light lists
+    void CullLights(IDeviceContext *pCtx, Uint32 Width, Uint32 Height);
+
+    // Clears the history if the lighting changed since the last frame, then traces this frame's
+    // pixels into it
+    void UpdateHistory(IDeviceContext *pCtx, Uint32 Width, Uint32 Height, ITexture *pSDF, const MapConstants &Map,
+                       const PlayerConstants &Player);
+
+  private:
+    PipelineCache &mCache;
+    TEXTURE_FORMAT mColorFormat;
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<IBuffer> m_pMapConstants;
+    RefCntAutoPtr<IBuffer> m_pPlayerConstants;
+    RefCntAutoPtr<IBuffer> m_pLightingConstants;
+    RefCntAutoPtr<IBuffer> m_pCullingConstants;
+    RefCntAutoPtr<IBuffer> m_pTemporalConstants;
+    // r - shading, g - SDF of the pixel
+    RefCntAutoPtr<ITexture> m_pLightingTarget;
+    // Full resolution, rgb - light of the map lights, a - shading of the player's lights
+    RefCntAutoPtr<ITexture> m_pHistory;
+    RefCntAutoPtr<IBuffer> m_pLights;
+    // Per tile the number of lights followed by MaxLightsPerTile light indices
+    RefCntAutoPtr<IBuffer> m_pTileLights;
+
+    std::vector<MapLight> mLights;
+    bool mLightsChanged = false;
+
+    SDFLightingResolution mResolution = SDFLightingResolution::Full;
+    SDFShadowMethod mShadowMethod = SDFShadowMethod::ThreeRays;
+    float mBilateralSharpness = 4.f;
+    SDFWorld *mWorld = nullptr;
+    bool mWorldPipelinesRequested = false;
+
+    bool mTemporal = false;
+    bool mHistoryValid = false;
+    // Frames traced into the history since it was cleared
+    Uint32 mHistoryFrames = 0;
+    // What the history was traced with, compared every frame. The SDF texture is only compared by
+    // its address.
+    MapConstants mHistoryMap;
+    PlayerConstants mHistoryPlayer;
+    const ITexture *mHistorySDF = nullptr;
+    const SDFWorld *mHistoryWorld = nullptr;
+    Uint64 mHistoryWorldVersion = 0;
+    SDFShadowMethod mHistoryMethod = SDFShadowMethod::ThreeRays;
+
+    // Indexed by SDFShadowMethod, then by GetModeIndex(), then by whether there are map lights,
+    // last by whether the SDF comes from an SDF world. The temporal passes have no mode index.
+    Pass mLighting[2][2];
+    Pass mMap[2][4][2][2];
+    Pass mTemporalLighting[2][2][2];
+    Pass mCullLights;
+};
+
+}
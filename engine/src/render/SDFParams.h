@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BasicTypes.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// How SDFGenerator stores distances, SDF_UNORM8 of its shaders
+enum class SDFEncoding : Uint8 {
+    // R16F, distances in map units
+    Float16,
+    // R8_UNORM, [-Radius, Radius] * DistScale mapped to [0, 1]. Half the bandwidth of every
+    // sample the lighting takes, steps of Radius * DistScale / 127.5.
+    Unorm8,
+};
+
+// Shared by the GPU generator and the CPU baker. The generator compiles them into its shaders as
+// RADIUS, DIST_SCALE and SDF_UNORM8, the shader pack holds the defaults.
+struct SDFParams {
+    // Texels beyond which distances are clamped
+    Uint32 Radius = 32;
+    // Map units per texel, distances are stored in map units
+    float DistScale = 0.125f;
+    // Only the GPU generator encodes, the CPU baker always writes floats
+    SDFEncoding Encoding = SDFEncoding::Float16;
+};
+
+// DrawMap.hlsl turns a value read from the SDF texture into map units with
+// Value * SDFDecodeScale + SDFDecodeBias of its MapConstants
+[[nodiscard]] inline float GetSDFDecodeScale(const SDFParams &Params) {
+    return Params.Encoding == SDFEncoding::Unorm8 ? 2.f * static_cast<float>(Params.Radius) * Params.DistScale : 1.f;
+}
+
+[[nodiscard]] inline float GetSDFDecodeBias(const SDFParams &Params) {
+    return Params.Encoding == SDFEncoding::Unorm8 ? -static_cast<float>(Params.Radius) * Params.DistScale : 0.f;
+}
+
+}
@@ -0,0 +1,290 @@
+#include "SDFQuery.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#    define BT_SDF_QUERY_AVX2 1
+#    include <immintrin.h>
+#endif
+
+namespace bt {
+
+namespace {
+
+// Fraction of a texel the march treats as touching a surface, also its smallest step
+constexpr float HitDistanceTexels = 0.25f;
+
+#if BT_SDF_QUERY_AVX2
+struct FieldAVX2 {
+    const float *pSDF;
+    __m256 InvDistScale;
+    __m256 MaxX;
+    __m256 MaxY;
+    __m256i LastX;
+    __m256i LastY;
+    __m256i Width;
+};
+
+FieldAVX2 MakeFieldAVX2(const float *pSDF, Uint32 Width, Uint32 Height, float InvDistScale) {
+    return {pSDF,
+            _mm256_set1_ps(InvDistScale),
+            _mm256_set1_ps(static_cast<float>(Width - 1)),
+            _mm256_set1_ps(static_cast<float>(Height - 1)),
+            _mm256_set1_epi32(static_cast<int>(Width - 1)),
+            _mm256_set1_epi32(static_cast<int>(Height - 1)),
+            _mm256_set1_epi32(static_cast<int>(Width))};
+}
+
+// Same arithmetic as SDFQuery::Sample()
+__m256 SampleAVX2(const FieldAVX2 &F, __m256 X, __m256 Y) {
+    const __m256 Half = _mm256_set1_ps(0.5f);
+    const __m256 Zero = _mm256_setzero_ps();
+    const __m256 FX = _mm256_max_ps(_mm256_min_ps(_mm256_fmsub_ps(X, F.InvDistScale, Half), F.MaxX), Zero);
+    const __m256 FY = _mm256_max_ps(_mm256_min_ps(_mm256_fmsub_ps(Y, F.InvDistScale, Half), F.MaxY), Zero);
+    const __m256 X0F = _mm256_floor_ps(FX);
+    const __m256 Y0F = _mm256_floor_ps(FY);
+    const __m256 WX = _mm256_sub_ps(FX, X0F);
+    const __m256 WY = _mm256_sub_ps(FY, Y0F);
+
+    const __m256i One = _mm256_set1_epi32(1);
+    const __m256i X0 = _mm256_cvttps_epi32(X0F);
+    const __m256i Y0 = _mm256_cvttps_epi32(Y0F);
+    const __m256i X1 = _mm256_min_epi32(_mm256_add_epi32(X0, One), F.LastX);
+    const __m256i Y1 = _mm256_min_epi32(_mm256_add_epi32(Y0, One), F.LastY);
+    const __m256i Row0 = _mm256_mullo_epi32(Y0, F.Width);
+    const __m256i Row1 = _mm256_mullo_epi32(Y1, F.Width);
+
+    const __m256 D00 = _mm256_i32gather_ps(F.pSDF, _mm256_add_epi32(Row0, X0), 4);
+    const __m256 D10 = _mm256_i32gather_ps(F.pSDF, _mm256_add_epi32(Row0, X1), 4);
+    const __m256 D01 = _mm256_i32gather_ps(F.pSDF, _mm256_add_epi32(Row1, X0), 4);
+    const __m256 D11 = _mm256_i32gather_ps(F.pSDF, _mm256_add_epi32(Row1, X1), 4);
+    const __m256 Top = _mm256_fmadd_ps(_mm256_sub_ps(D10, D00), WX, D00);
+    const __m256 Bottom = _mm256_fmadd_ps(_mm256_sub_ps(D11, D01), WX, D01);
+    return _mm256_fmadd_ps(_mm256_sub_ps(Bottom, Top), WY, Top);
+}
+
+SDFQueryKernel ResolveKernel(SDFQueryKernel Kernel) {
+    const auto Best = GetSDFQueryKernel();
+    return static_cast<Uint8>(Kernel) > static_cast<Uint8>(Best) ? Best : Kernel;
+}
+#endif
+
+}
+
+Uint32 SDFPointsSoA::Add(float PosX, float PosY) {
+    const auto Idx = Size();
+    X.push_back(PosX);
+    Y.push_back(PosY);
+    return Idx;
+}
+
+void SDFPointsSoA::Reserve(size_t Count) {
+    X.reserve(Count);
+    Y.reserve(Count);
+}
+
+void SDFPointsSoA::Clear() {
+    X.clear();
+    Y.clear();
+}
+
+Uint32 SDFRaysSoA::Add(float OX, float OY, float DX, float DY, float RayLength, float RayRadius) {
+    const auto Idx = Size();
+    OriginX.push_back(OX);
+    OriginY.push_back(OY);
+    DirX.push_back(DX);
+    DirY.push_back(DY);
+    Length.push_back(RayLength);
+    Radius.push_back(RayRadius);
+    return Idx;
+}
+
+Uint32 SDFRaysSoA::AddSegment(float AX, float AY, float BX, float BY, float RayRadius) {
+    const float DX = BX - AX;
+    const float DY = BY - AY;
+    const float Len = std::sqrt(DX * DX + DY * DY);
+    const float InvLen = Len > 0.f ? 1.f / Len : 0.f;
+    return Add(AX, AY, DX * InvLen, DY * InvLen, Len, RayRadius);
+}
+
+void SDFRaysSoA::Reserve(size_t Count) {
+    OriginX.reserve(Count);
+    OriginY.reserve(Count);
+    DirX.reserve(Count);
+    DirY.reserve(Count);
+    Length.reserve(Count);
+    Radius.reserve(Count);
+}
+
+void SDFRaysSoA::Clear() {
+    OriginX.clear();
+    OriginY.clear();
+    DirX.clear();
+    DirY.clear();
+    Length.clear();
+    Radius.clear();
+}
+
+SDFQueryKernel GetSDFQueryKernel() {
+#if BT_SDF_QUERY_AVX2
+    return SDFQueryKernel::AVX2;
+#else
+    return SDFQueryKernel::Scalar;
+#endif
+}
+
+const char *GetSDFQueryKernelName(SDFQueryKernel Kernel) {
+    switch (Kernel) {
+        case SDFQueryKernel::Scalar:
+            return "scalar";
+        case SDFQueryKernel::AVX2:
+            return "AVX2";
+        default:
+            return "unknown";
+    }
+}
+
+SDFQuery::SDFQuery(const float *pSDF, Uint32 Width, Uint32 Height, const SDFParams &Params)
+    : mSDF(pSDF), mWidth(Width), mHeight(Height), mInvDistScale(1.f / Params.DistScale),
+      mHitDistance(HitDistanceTexels * Params.DistScale) {}
+
+float SDFQuery::Sample(float X, float Y) const {
+    // Texel centers are at (i + 0.5) * DistScale like on the GPU
+    const float FX = std::max(std::min(X * mInvDistScale - 0.5f, static_cast<float>(mWidth - 1)), 0.f);
+    const float FY = std::max(std::min(Y * mInvDistScale - 0.5f, static_cast<float>(mHeight - 1)), 0.f);
+    const float X0F = std::floor(FX);
+    const float Y0F = std::floor(FY);
+    const float WX = FX - X0F;
+    const float WY = FY - Y0F;
+    const auto X0 = static_cast<Uint32>(X0F);
+    const auto Y0 = static_cast<Uint32>(Y0F);
+    const Uint32 X1 = std::min(X0 + 1, mWidth - 1);
+    const Uint32 Y1 = std::min(Y0 + 1, mHeight - 1);
+    const float *pRow0 = mSDF + static_cast<size_t>(Y0) * mWidth;
+    const float *pRow1 = mSDF + static_cast<size_t>(Y1) * mWidth;
+    const float Top = pRow0[X0] + (pRow0[X1] - pRow0[X0]) * WX;
+    const float Bottom = pRow1[X0] + (pRow1[X1] - pRow1[X0]) * WX;
+    return Top + (Bottom - Top) * WY;
+}
+
+float SDFQuery::SphereCast(float OX, float OY, float DX, float DY, float Length, float Radius) const {
+    float T = 0.f;
+    for (Uint32 Step = 0; Step < mMaxSteps; ++Step) {
+        const float Dist = Sample(OX + DX * T, OY + DY * T) - Radius;
+        if (Dist < mHitDistance) {
+            return T;
+        }
+        T += Dist;
+        if (T >= Length) {
+            return Length;
+        }
+    }
+    return T;
+}
+
+bool SDFQuery::LineOfSight(float AX, float AY, float BX, float BY) const {
+    const float DX = BX - AX;
+    const float DY = BY - AY;
+    const float Length = std::sqrt(DX * DX + DY * DY);
+    const float InvLength = Length > 0.f ? 1.f / Length : 0.f;
+    // A target right at a wall stops the march just short of it
+    return SphereCast(AX, AY, DX * InvLength, DY * InvLength, Length) + mHitDistance >= Length;
+}
+
+void SDFQuery::Sample(const SDFPointsSoA &Points, Uint32 First, Uint32 Count, float *pOutDist) const {
+    Sample(GetSDFQueryKernel(), Points, First, Count, pOutDist);
+}
+
+void SDFQuery::SphereCast(const SDFRaysSoA &Rays, Uint32 First, Uint32 Count, float *pOutT) const {
+    SphereCast(GetSDFQueryKernel(), Rays, First, Count, pOutT);
+}
+
+Uint32 SDFQuery::LineOfSight(const SDFRaysSoA &Rays, Uint32 First, Uint32 Count, Uint8 *pOutVisible) const {
+    return LineOfSight(GetSDFQueryKernel(), Rays, First, Count, pOutVisible);
+}
+
+void SDFQuery::Sample(SDFQueryKernel Kernel, const SDFPointsSoA &Points, Uint32 First, Uint32 Count,
+                      float *pOutDist) const {
+    Uint32 i = 0;
+#if BT_SDF_QUERY_AVX2
+    if (ResolveKernel(Kernel) == SDFQueryKernel::AVX2) {
+        const FieldAVX2 F = MakeFieldAVX2(mSDF, mWidth, mHeight, mInvDistScale);
+        for (; i + 8 <= Count; i += 8) {
+            const __m256 X = _mm256_loadu_ps(&Points.X[First + i]);
+            const __m256 Y = _mm256_loadu_ps(&Points.Y[First + i]);
+            _mm256_storeu_ps(pOutDist + i, SampleAVX2(F, X, Y));
+        }
+    }
+#else
+    (void)Kernel;
+#endif
+    for (; i < Count; ++i) {
+        pOutDist[i] = Sample(Points.X[First + i], Points.Y[First + i]);
+    }
+}
+
+void SDFQuery::SphereCast(SDFQueryKernel Kernel, const SDFRaysSoA &Rays, Uint32 First, Uint32 Count,
+                          float *pOutT) const {
+    Uint32 i = 0;
+#if BT_SDF_QUERY_AVX2
+    if (ResolveKernel(Kernel) == SDFQueryKernel::AVX2) {
+        const FieldAVX2 F = MakeFieldAVX2(mSDF, mWidth, mHeight, mInvDistScale);
+        const __m256 HitDistance = _mm256_set1_ps(mHitDistance);
+        for (; i + 8 <= Count; i += 8) {
+            const Uint32 Idx = First + i;
+            const __m256 OX = _mm256_loadu_ps(&Rays.OriginX[Idx]);
+            const __m256 OY = _mm256_loadu_ps(&Rays.OriginY[Idx]);
+            const __m256 DX = _mm256_loadu_ps(&Rays.DirX[Idx]);
+            const __m256 DY = _mm256_loadu_ps(&Rays.DirY[Idx]);
+            const __m256 Length = _mm256_loadu_ps(&Rays.Length[Idx]);
+            const __m256 Radius = _mm256_loadu_ps(&Rays.Radius[Idx]);
+
+            // Lanes leave the march when they hit or pass their length, like the scalar loop
+            __m256 T = _mm256_setzero_ps();
+            __m256 Active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (Uint32 Step = 0; Step < mMaxSteps; ++Step) {
+                const __m256 PX = _mm256_fmadd_ps(DX, T, OX);
+                const __m256 PY = _mm256_fmadd_ps(DY, T, OY);
+                const __m256 Dist = _mm256_sub_ps(SampleAVX2(F, PX, PY), Radius);
+                Active = _mm256_andnot_ps(_mm256_cmp_ps(Dist, HitDistance, _CMP_LT_OQ), Active);
+                T = _mm256_add_ps(T, _mm256_and_ps(Active, Dist));
+                const __m256 Passed = _mm256_and_ps(Active, _mm256_cmp_ps(T, Length, _CMP_GE_OQ));
+                T = _mm256_blendv_ps(T, Length, Passed);
+                Active = _mm256_andnot_ps(Passed, Active);
+                if (_mm256_movemask_ps(Active) == 0) {
+                    break;
+                }
+            }
+            _mm256_storeu_ps(pOutT + i, T);
+        }
+    }
+#else
+    (void)Kernel;
+#endif
+    for (; i < Count; ++i) {
+        const Uint32 Idx = First + i;
+        pOutT[i] = SphereCast(Rays.OriginX[Idx], Rays.OriginY[Idx], Rays.DirX[Idx], Rays.DirY[Idx], Rays.Length[Idx],
+                              Rays.Radius[Idx]);
+    }
+}
+
+Uint32 SDFQuery::LineOfSight(SDFQueryKernel Kernel, const SDFRaysSoA &Rays, Uint32 First, Uint32 Count,
+                             Uint8 *pOutVisible) const {
+    // The distances go through a small buffer that stays in cache
+    constexpr Uint32 BatchSize = 256;
+    float T[BatchSize];
+    Uint32 NumVisible = 0;
+    for (Uint32 Batch = 0; Batch < Count; Batch += BatchSize) {
+        const Uint32 BatchCount = std::min(BatchSize, Count - Batch);
+        SphereCast(Kernel, Rays, First + Batch, BatchCount, T);
+        for (Uint32 i = 0; i < BatchCount; ++i) {
+            const bool Visible = T[i] + mHitDistance >= Rays.Length[First + Batch + i];
+            pOutVisible[Batch + i] = Visible ? 1 : 0;
+            NumVisible += Visible ? 1 : 0;
+        }
+    }
+    return NumVisible;
+}
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "render/SDFParams.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Points in map units stored as structure of arrays, so the query kernels load 8 per register
+struct SDFPointsSoA {
+    std::vector<float> X;
+    std::vector<float> Y;
+
+    [[nodiscard]] Uint32 Size() const { return static_cast<Uint32>(X.size()); }
+
+    Uint32 Add(float PosX, float PosY);
+
+    void Reserve(size_t Count);
+
+    void Clear();
+};
+
+// Rays from Origin along the normalized Dir up to Length, swept by a circle of Radius (0 for a
+// thin ray). All in map units.
+struct SDFRaysSoA {
+    std::vector<float> OriginX;
+    std::vector<float> OriginY;
+    std::vector<float> DirX;
+    std::vector<float> DirY;
+    std::vector<float> Length;
+    std::vector<float> Radius;
+
+    [[nodiscard]] Uint32 Size() const { return static_cast<Uint32>(OriginX.size()); }
+
+    Uint32 Add(float OX, float OY, float DX, float DY, float RayLength, float RayRadius = 0.f);
+
+    // Ray from A to B
+    Uint32 AddSegment(float AX, float AY, float BX, float BY, float RayRadius = 0.f);
+
+    void Reserve(size_t Count);
+
+    void Clear();
+};
+
+enum class SDFQueryKernel : Uint8 {
+    Scalar,
+    // 8 queries per register with gathered texel reads. There is no SSE kernel, without gathers
+    // the four texel fetches per sample dominate and it does not beat the scalar one.
+    AVX2,
+};
+
+// Best kernel this binary was compiled with (see ENGINE_ENABLE_AVX2 in CMakeLists.txt)
+[[nodiscard]] SDFQueryKernel GetSDFQueryKernel();
+
+[[nodiscard]] const char *GetSDFQueryKernelName(SDFQueryKernel Kernel);
+
+// Gameplay questions to the SDF that DrawMap.hlsl marches, answered on the CPU from the output
+// of SDFBaker: distances at points, sphere casts and line of sight. Samples are bilinear and
+// clamp to the map edge like the shader's sampler, so the answers agree with what is drawn.
+// Only reads the field, so one query object can serve many threads at once; the batched calls
+// take a [First, First + Count) slice to split the work.
+class SDFQuery {
+  public:
+    // Most sphere tracing steps per ray, as in DrawMap.hlsl
+    static constexpr Uint32 DefaultMaxSteps = 128;
+
+    SDFQuery() = default;
+
+    // Does not copy the field, pSDF must stay alive. Rebaking regions of it in place is fine
+    // between queries.
+    SDFQuery(const float *pSDF, Uint32 Width, Uint32 Height, const SDFParams &Params);
+
+    void SetMaxSteps(Uint32 MaxSteps) { mMaxSteps = MaxSteps; }
+
+    // Signed distance in map units, negative inside walls
+    [[nodiscard]] float Sample(float X, float Y) const;
+
+    [[nodiscard]] bool IsInsideWall(float X, float Y) const { return Sample(X, Y) < 0.f; }
+
+    // Distance the circle moves along the ray before touching a wall, the ray's Length if it
+    // never does. A march that runs out of steps counts as a hit where it stopped.
+    [[nodiscard]] float SphereCast(float OX, float OY, float DX, float DY, float Length, float Radius = 0.f) const;
+
+    [[nodiscard]] bool LineOfSight(float AX, float AY, float BX, float BY) const;
+
+    // pOut* must have room for Count results
+    void Sample(const SDFPointsSoA &Points, Uint32 First, Uint32 Count, float *pOutDist) const;
+
+    void SphereCast(const SDFRaysSoA &Rays, Uint32 First, Uint32 Count, float *pOutT) const;
+
+    // Writes 1 for rays reaching their end, returns how many do
+    Uint32 LineOfSight(const SDFRaysSoA &Rays, Uint32 First, Uint32 Count, Uint8 *pOutVisible) const;
+
+    // Same as above with explicitly selected kernel, used by the benchmark to compare code paths.
+    // Requesting a kernel that is not compiled in falls back to the best available one.
+    void Sample(SDFQueryKernel Kernel, const SDFPointsSoA &Points, Uint32 First, Uint32 Count, float *pOutDist) const;
+
+    void SphereCast(SDFQueryKernel Kernel, const SDFRaysSoA &Rays, Uint32 First, Uint32 Count, float *pOutT) const;
+
+    Uint32 LineOfSight(SDFQueryKernel Kernel, const SDFRaysSoA &Rays, Uint32 First, Uint32 Count,
+                       Uint8 *pOutVisible) const;
+
+  private:
+    const float *mSDF = nullptr;
+    Uint32 mWidth = 0;
+    Uint32 mHeight = 0;
+    float mInvDistScale = 1.f;
+    // The march stops this close to a surface and never steps less
+    float mHitDistance = 0.f;
+    Uint32 mMaxSteps = DefaultMaxSteps;
+};
+
+}
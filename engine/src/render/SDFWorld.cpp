@@ -0,0 +1,416 @@
+#include "SDFWorld.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "core/Logging.h"
+#include "core/ThreadPool.h"
+#include "fmt/core.h"
+#include "render/SDFBaker.h"
+
+namespace bt {
+
+namespace {
+
+constexpr Uint16 CoarseValidBit = 0x8000;
+
+// SDFWorldConstants in Structures.fxh
+struct SDFWorldConstants {
+    float AtlasTexelSize[2];
+    float InvDistScale;
+    float ChunkTexels;
+    Int32 Window[4];
+    Int32 WindowChunks;
+    Int32 AtlasSlotsPerRow;
+    float InvCoarseExtent;
+    float FarDistance;
+};
+
+// Round to nearest, values too small for a normal half become 0
+Uint16 FloatToHalf(float Value) {
+    Uint32 Bits;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
+    const auto Sign = static_cast<Uint16>((Bits >> 16) & 0x8000);
+    const Int32 Exponent = static_cast<Int32>((Bits >> 23) & 0xFF) - 127 + 15;
+    const Uint32 Mantissa = Bits & 0x7FFFFF;
+    if (Exponent <= 0) {
+        return Sign;
+    }
+    if (Exponent >= 31) {
+        return static_cast<Uint16>(Sign | 0x7C00);
+    }
+    Uint32 Half = (static_cast<Uint32>(Exponent) << 10) | (Mantissa >> 13);
+    // A carry out of the mantissa correctly bumps the exponent
+    Half += (Mantissa >> 12) & 1;
+    return static_cast<Uint16>(Sign | Half);
+}
+
+Int32 PositiveMod(Int32 A, Int32 B) {
+    return ((A % B) + B) % B;
+}
+
+RefCntAutoPtr<ITexture> CreateTexture(IRenderDevice *pDevice, const char *Name, Uint32 Size, TEXTURE_FORMAT Format) {
+    TextureDesc Desc;
+    Desc.Name = Name;
+    Desc.Type = RESOURCE_DIM_TEX_2D;
+    Desc.Width = Size;
+    Desc.Height = Size;
+    Desc.Format = Format;
+    Desc.Usage = USAGE_DEFAULT;
+    Desc.BindFlags = BIND_SHADER_RESOURCE;
+    RefCntAutoPtr<ITexture> pTexture;
+    pDevice->CreateTexture(Desc, nullptr, &pTexture);
+    return pTexture;
+}
+
+}
+
+struct SDFWorld::ChunkResult {
+    Int32 X = 0;
+    Int32 Y = 0;
+    bool Fine = false;
+    Uint32 Generation = 0;
+    // R16F texels, ChunkTexels + 2 square for fine chunks, ChunkTexels / CoarseDownscale for coarse ones
+    std::vector<Uint16> Texels;
+};
+
+struct SDFWorld::SharedState {
+    SDFChunkSource Source;
+    std::atomic<bool> Cancelled{false};
+    std::mutex Mutex;
+    std::vector<ChunkResult> Finished;
+};
+
+SDFWorld::SDFWorld(IRenderDevice *Device, ThreadPool &Workers, SDFChunkSource Source, const SDFWorldDesc &Desc)
+    : mWorkers(Workers), mDesc(Desc) {
+    m_pDevice = Device;
+
+    if (mDesc.CoarseDownscale == 0 || mDesc.ChunkTexels % mDesc.CoarseDownscale != 0) {
+        log::Error(fmt::format("SDF world: coarse downscale {} does not divide the chunk size {}",
+                               mDesc.CoarseDownscale, mDesc.ChunkTexels));
+        mDesc.CoarseDownscale = 1;
+    }
+    const Uint32 MaxWindow = 2 * static_cast<Uint32>(GetFineRadius()) + 1;
+    if (mDesc.WindowChunks < MaxWindow) {
+        log::Error(fmt::format("SDF world: a window of {} chunks is smaller than the fine area", mDesc.WindowChunks));
+        mDesc.WindowChunks = MaxWindow;
+    }
+
+    mShared = std::make_shared<SharedState>();
+    mShared->Source = std::move(Source);
+
+    const Uint32 NumSlots = mDesc.AtlasChunks * mDesc.AtlasChunks;
+    mFreeSlots.reserve(NumSlots);
+    for (Uint32 i = NumSlots; i > 0; --i) {
+        mFreeSlots.push_back(i - 1);
+    }
+    const Uint32 W = mDesc.WindowChunks;
+    mCells.resize(static_cast<size_t>(W) * W);
+    mIndirection.assign(mCells.size(), static_cast<Uint16>(NoSlot));
+
+    m_pAtlas = CreateTexture(m_pDevice, "SDF world atlas", mDesc.AtlasChunks * (mDesc.ChunkTexels + 2),
+                             TEX_FORMAT_R16_FLOAT);
+    m_pCoarse = CreateTexture(m_pDevice, "SDF world coarse clipmap", W * mDesc.ChunkTexels / mDesc.CoarseDownscale,
+                              TEX_FORMAT_R16_FLOAT);
+    m_pIndirection = CreateTexture(m_pDevice, "SDF world indirection", W, TEX_FORMAT_R16_UINT);
+
+    BufferDesc CBDesc;
+    CBDesc.Name = "SDF world constants CB";
+    CBDesc.Usage = USAGE_DEFAULT;
+    CBDesc.BindFlags = BIND_UNIFORM_BUFFER;
+    CBDesc.Size = sizeof(SDFWorldConstants);
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pConstants);
+}
+
+SDFWorld::~SDFWorld() {
+    mShared->Cancelled = true;
+}
+
+Int32 SDFWorld::GetFineRadius() const {
+    // (2 * R + 1)^2 chunks around the focus always fit the atlas
+    return static_cast<Int32>(std::max(mDesc.AtlasChunks, 1u) - 1) / 2;
+}
+
+SDFWorld::Cell &SDFWorld::GetCell(Int32 X, Int32 Y) {
+    const auto W = static_cast<Int32>(mDesc.WindowChunks);
+    return mCells[static_cast<size_t>(PositiveMod(Y, W)) * W + PositiveMod(X, W)];
+}
+
+SDFWorld::Cell &SDFWorld::AssignCell(Int32 X, Int32 Y) {
+    Cell &C = GetCell(X, Y);
+    if (C.Assigned && C.X == X && C.Y == Y) {
+        return C;
+    }
+    if (C.FineSlot != NoSlot) {
+        mFreeSlots.push_back(C.FineSlot);
+    }
+    // Jobs still running for the old chunk are dropped by the generation check
+    const Uint32 Generation = C.Generation + 1;
+    C = Cell{};
+    C.X = X;
+    C.Y = Y;
+    C.Assigned = true;
+    C.Generation = Generation;
+    WriteIndirection(C);
+    return C;
+}
+
+void SDFWorld::WriteIndirection(const Cell &C) {
+    const auto W = static_cast<Int32>(mDesc.WindowChunks);
+    const auto Value = static_cast<Uint16>(C.FineSlot | (C.CoarseValid ? CoarseValidBit : 0));
+    Uint16 &Entry = mIndirection[static_cast<size_t>(PositiveMod(C.Y, W)) * W + PositiveMod(C.X, W)];
+    if (Entry != Value) {
+        Entry = Value;
+        mIndirectionDirty = true;
+    }
+}
+
+void SDFWorld::QueueJob(Cell &C, bool Fine) {
+    (Fine ? C.FinePending : C.CoarsePending) = true;
+    ++mNumPending;
+
+    // The coarse level is a regular SDF of the downscaled walls with texels Downscale times larger
+    const Uint32 Downscale = Fine ? 1 : mDesc.CoarseDownscale;
+    const SDFParams Params{std::max(mDesc.Params.Radius / Downscale, 1u), mDesc.Params.DistScale * Downscale};
+    // Fine chunks keep a border texel on each side so filtering does not bleed into atlas neighbours
+    const Uint32 Border = Fine ? 1 : 0;
+    const Uint32 Size = mDesc.ChunkTexels / Downscale + 2 * Border;
+    // Walls within the radius of the chunk decide its distances
+    const Uint32 Halo = Params.Radius;
+    const Uint32 SourceSize = Size + 2 * Halo;
+    const auto Offset = static_cast<Int32>((Border + Halo) * Downscale);
+    const Int32 SourceX = C.X * static_cast<Int32>(mDesc.ChunkTexels) - Offset;
+    const Int32 SourceY = C.Y * static_cast<Int32>(mDesc.ChunkTexels) - Offset;
+
+    mWorkers.Enqueue([Shared = mShared, X = C.X, Y = C.Y, Generation = C.Generation, Fine, Downscale, Params, Size,
+                      Halo, SourceSize, SourceX, SourceY]() {
+        if (Shared->Cancelled) {
+            return;
+        }
+        const size_t NumSourceTexels = static_cast<size_t>(SourceSize) * SourceSize;
+        std::vector<Uint8> Walls(NumSourceTexels);
+        Shared->Source(SourceX, SourceY, SourceSize, SourceSize, Downscale, Walls.data());
+
+        std::vector<float> SDF(NumSourceTexels);
+        SDFBaker Baker(Params);
+        Baker.BakeRegion(Walls.data(), SourceSize, SourceSize, SDFRect{Halo, Halo, Halo + Size, Halo + Size},
+                         SDF.data());
+
+        ChunkResult Result{X, Y, Fine, Generation, {}};
+        Result.Texels.resize(static_cast<size_t>(Size) * Size);
+        for (Uint32 y = 0; y < Size; ++y) {
+            const float *pRow = &SDF[static_cast<size_t>(y + Halo) * SourceSize + Halo];
+            for (Uint32 x = 0; x < Size; ++x) {
+                Result.Texels[static_cast<size_t>(y) * Size + x] = FloatToHalf(pRow[x]);
+            }
+        }
+
+        std::lock_guard<std::mutex> Lock(Shared->Mutex);
+        Shared->Finished.push_back(std::move(Result));
+    });
+}
+
+bool SDFWorld::EvictFineChunk() {
+    const Int32 FineRadius = GetFineRadius();
+    Cell *pFarthest = nullptr;
+    Int32 FarthestDist = FineRadius;
+    for (auto &C: mCells) {
+        if (C.FineSlot == NoSlot) {
+            continue;
+        }
+        const Int32 Dist = std::max(std::abs(C.X - mFocusX), std::abs(C.Y - mFocusY));
+        if (Dist > FarthestDist) {
+            FarthestDist = Dist;
+            pFarthest = &C;
+        }
+    }
+    if (pFarthest == nullptr) {
+        return false;
+    }
+    mFreeSlots.push_back(pFarthest->FineSlot);
+    pFarthest->FineSlot = NoSlot;
+    pFarthest->FineStale = false;
+    WriteIndirection(*pFarthest);
+    return true;
+}
+
+void SDFWorld::UploadResult(IDeviceContext *pCtx, const ChunkResult &Result) {
+    Cell &C = GetCell(Result.X, Result.Y);
+    if (Result.Fine) {
+        const Uint32 Size = mDesc.ChunkTexels + 2;
+        const Uint32 X0 = C.FineSlot % mDesc.AtlasChunks * Size;
+        const Uint32 Y0 = C.FineSlot / mDesc.AtlasChunks * Size;
+        const Box Region{X0, X0 + Size, Y0, Y0 + Size};
+        const TextureSubResData SubRes{Result.Texels.data(), Size * sizeof(Uint16)};
+        pCtx->UpdateTexture(m_pAtlas, 0, 0, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                            RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    } else {
+        const Uint32 Size = mDesc.ChunkTexels / mDesc.CoarseDownscale;
+        const auto W = static_cast<Int32>(mDesc.WindowChunks);
+        const Uint32 X0 = static_cast<Uint32>(PositiveMod(Result.X, W)) * Size;
+        const Uint32 Y0 = static_cast<Uint32>(PositiveMod(Result.Y, W)) * Size;
+        const Box Region{X0, X0 + Size, Y0, Y0 + Size};
+        const TextureSubResData SubRes{Result.Texels.data(), Size * sizeof(Uint16)};
+        pCtx->UpdateTexture(m_pCoarse, 0, 0, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                            RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+}
+
+void SDFWorld::Update(IDeviceContext *pCtx, const float2 &Focus) {
+    const auto ChunkTexels = static_cast<Int32>(mDesc.ChunkTexels);
+    const auto W = static_cast<Int32>(mDesc.WindowChunks);
+    const float ChunkSize = static_cast<float>(ChunkTexels) * mDesc.Params.DistScale;
+    mFocusX = static_cast<Int32>(std::floor(Focus.x / ChunkSize));
+    mFocusY = static_cast<Int32>(std::floor(Focus.y / ChunkSize));
+
+    // Move the window, the cells of chunks that left it take the chunks that came in
+    const Int32 WindowX = mFocusX - W / 2;
+    const Int32 WindowY = mFocusY - W / 2;
+    if (!mHasWindow || WindowX != mWindowX || WindowY != mWindowY) {
+        mHasWindow = true;
+        mWindowX = WindowX;
+        mWindowY = WindowY;
+        for (Int32 y = WindowY; y < WindowY + W; ++y) {
+            for (Int32 x = WindowX; x < WindowX + W; ++x) {
+                AssignCell(x, y);
+            }
+        }
+        mConstantsDirty = true;
+    }
+
+    std::vector<ChunkResult> Finished;
+    {
+        std::lock_guard<std::mutex> Lock(mShared->Mutex);
+        Finished.swap(mShared->Finished);
+    }
+    const Int32 FineRadius = GetFineRadius();
+    for (const auto &Result: Finished) {
+        --mNumPending;
+        Cell &C = GetCell(Result.X, Result.Y);
+        if (!C.Assigned || C.X != Result.X || C.Y != Result.Y || C.Generation != Result.Generation) {
+            continue;
+        }
+        if (Result.Fine) {
+            C.FinePending = false;
+            // The focus moved on while the chunk was baked
+            if (std::max(std::abs(C.X - mFocusX), std::abs(C.Y - mFocusY)) > FineRadius) {
+                continue;
+            }
+            if (C.FineSlot == NoSlot) {
+                if (mFreeSlots.empty() && !EvictFineChunk()) {
+                    continue;
+                }
+                C.FineSlot = mFreeSlots.back();
+                mFreeSlots.pop_back();
+            }
+            C.FineStale = false;
+        } else {
+            C.CoarsePending = false;
+            C.CoarseValid = true;
+            C.CoarseStale = false;
+        }
+        UploadResult(pCtx, Result);
+        WriteIndirection(C);
+        ++mVersion;
+    }
+
+    // Queue what is missing from the focus outwards, fine before coarse at the same distance
+    for (Int32 Ring = 0; Ring <= W / 2 && mNumPending < mDesc.MaxJobsInFlight; ++Ring) {
+        for (Int32 y = mFocusY - Ring; y <= mFocusY + Ring && mNumPending < mDesc.MaxJobsInFlight; ++y) {
+            const bool Edge = y == mFocusY - Ring || y == mFocusY + Ring;
+            for (Int32 x = mFocusX - Ring; x <= mFocusX + Ring && mNumPending < mDesc.MaxJobsInFlight;
+                 x += Edge ? 1 : 2 * Ring) {
+                if (x < mWindowX || x >= mWindowX + W || y < mWindowY || y >= mWindowY + W) {
+                    continue;
+                }
+                Cell &C = GetCell(x, y);
+                if (Ring <= FineRadius && (C.FineSlot == NoSlot || C.FineStale) && !C.FinePending) {
+                    QueueJob(C, true);
+                }
+                if ((!C.CoarseValid || C.CoarseStale) && !C.CoarsePending &&
+                    mNumPending < mDesc.MaxJobsInFlight) {
+                    QueueJob(C, false);
+                }
+            }
+        }
+    }
+
+    if (mIndirectionDirty) {
+        const Box Region{0, mDesc.WindowChunks, 0, mDesc.WindowChunks};
+        const TextureSubResData SubRes{mIndirection.data(), mDesc.WindowChunks * sizeof(Uint16)};
+        pCtx->UpdateTexture(m_pIndirection, 0, 0, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                            RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        mIndirectionDirty = false;
+        ++mVersion;
+    }
+
+    if (mConstantsDirty) {
+        const float AtlasSize = static_cast<float>(mDesc.AtlasChunks * (mDesc.ChunkTexels + 2));
+        SDFWorldConstants Constants{};
+        Constants.AtlasTexelSize[0] = 1.f / AtlasSize;
+        Constants.AtlasTexelSize[1] = 1.f / AtlasSize;
+        Constants.InvDistScale = 1.f / mDesc.Params.DistScale;
+        Constants.ChunkTexels = static_cast<float>(mDesc.ChunkTexels);
+        Constants.Window[0] = mWindowX;
+        Constants.Window[1] = mWindowY;
+        Constants.Window[2] = mWindowX + W;
+        Constants.Window[3] = mWindowY + W;
+        Constants.WindowChunks = W;
+        Constants.AtlasSlotsPerRow = static_cast<Int32>(mDesc.AtlasChunks);
+        Constants.InvCoarseExtent = 1.f / (static_cast<float>(W) * ChunkSize);
+        Constants.FarDistance = static_cast<float>(mDesc.Params.Radius) * mDesc.Params.DistScale;
+        pCtx->UpdateBuffer(m_pConstants, 0, sizeof(Constants), &Constants, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        mConstantsDirty = false;
+        ++mVersion;
+    }
+}
+
+void SDFWorld::Invalidate(const float2 &Min, const float2 &Max) {
+    if (!mHasWindow) {
+        return;
+    }
+    // Distances change up to the radius around the edit
+    const float Margin = static_cast<float>(mDesc.Params.Radius) * mDesc.Params.DistScale;
+    const float ChunkSize = static_cast<float>(mDesc.ChunkTexels) * mDesc.Params.DistScale;
+    const auto W = static_cast<Int32>(mDesc.WindowChunks);
+    const Int32 X0 = std::max(static_cast<Int32>(std::floor((Min.x - Margin) / ChunkSize)), mWindowX);
+    const Int32 Y0 = std::max(static_cast<Int32>(std::floor((Min.y - Margin) / ChunkSize)), mWindowY);
+    const Int32 X1 = std::min(static_cast<Int32>(std::floor((Max.x + Margin) / ChunkSize)), mWindowX + W - 1);
+    const Int32 Y1 = std::min(static_cast<Int32>(std::floor((Max.y + Margin) / ChunkSize)), mWindowY + W - 1);
+    const Int32 FineRadius = GetFineRadius();
+    for (Int32 y = Y0; y <= Y1; ++y) {
+        for (Int32 x = X0; x <= X1; ++x) {
+            Cell &C = GetCell(x, y);
+            ++C.Generation;
+            C.FinePending = false;
+            C.CoarsePending = false;
+            // Fine chunks outside the fine area would not be baked again
+            if (C.FineSlot != NoSlot && std::max(std::abs(x - mFocusX), std::abs(y - mFocusY)) > FineRadius) {
+                mFreeSlots.push_back(C.FineSlot);
+                C.FineSlot = NoSlot;
+                WriteIndirection(C);
+            }
+            C.FineStale = C.FineSlot != NoSlot;
+            C.CoarseStale = C.CoarseValid;
+        }
+    }
+}
+
+Uint32 SDFWorld::GetNumFineChunks() const {
+    return mDesc.AtlasChunks * mDesc.AtlasChunks - static_cast<Uint32>(mFreeSlots.size());
+}
+
+Uint64 SDFWorld::GetMemoryUsage() const {
+    const Uint64 AtlasSize = mDesc.AtlasChunks * (mDesc.ChunkTexels + 2);
+    const Uint64 CoarseSize = mDesc.WindowChunks * mDesc.ChunkTexels / mDesc.CoarseDownscale;
+    const Uint64 WindowSize = mDesc.WindowChunks;
+    return (AtlasSize * AtlasSize + CoarseSize * CoarseSize + WindowSize * WindowSize) * sizeof(Uint16) +
+           sizeof(SDFWorldConstants);
+}
+
+}
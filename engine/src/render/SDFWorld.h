@@ -0,0 +1,156 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "BasicMath.hpp"
+#include "render/SDFParams.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+class ThreadPool;
+
+struct SDFWorldDesc {
+    // Radius and texel size of the fine level. The encoding is ignored, chunks are always R16F.
+    SDFParams Params;
+    // Fine texels per chunk side
+    Uint32 ChunkTexels = 128;
+    // The atlas holds AtlasChunks x AtlasChunks fine chunks
+    Uint32 AtlasChunks = 8;
+    // Side in chunks of the window around the focus that has coarse data, and of the
+    // indirection table. Must leave room for the fine chunks, which are at most
+    // AtlasChunks / 2 chunks from the focus.
+    Uint32 WindowChunks = 32;
+    // Fine texels per coarse texel, must divide ChunkTexels
+    Uint32 CoarseDownscale = 8;
+    // Chunks generated at the same time
+    Uint32 MaxJobsInFlight = 8;
+};
+
+// Fills Width x Height wall bytes (above 127 is a wall) starting at fine texel (X, Y), where a
+// byte covers Downscale x Downscale fine texels: 1 for fine chunks, CoarseDownscale for coarse
+// ones. Coordinates may be negative or past any map bounds, the world has none.
+// Called from worker threads, possibly several at once.
+using SDFChunkSource =
+    std::function<void(Int32 X, Int32 Y, Uint32 Width, Uint32 Height, Uint32 Downscale, Uint8 *pWalls)>;
+
+// Signed distance field of a world of any size, split into square chunks that are generated
+// around a focus point, e.g. the player, and dropped again behind it. Chunks near the focus are
+// fine and live in an atlas of fixed slots; every chunk of a larger window around it has a coarse
+// version in a clipmap that wraps around as the window moves. An indirection table per window
+// chunk tells DrawMap.hlsl (SDF_WORLD) which one to read. Memory does not depend on the world
+// size, only on the descriptor.
+// Chunks are made by the source and baked by SDFBaker on the worker threads, and uploaded by
+// Update() when done. Until then the shader reads the coarse version, or empty space if that is
+// missing too.
+class SDFWorld {
+  public:
+    SDFWorld(IRenderDevice *Device, ThreadPool &Workers, SDFChunkSource Source, const SDFWorldDesc &Desc = {});
+
+    // Chunks still being generated are dropped when done
+    ~SDFWorld();
+
+    SDFWorld(const SDFWorld &) = delete;
+    SDFWorld &operator=(const SDFWorld &) = delete;
+
+    // Once per frame on the main thread, Focus in map units. Moves the window, queues the
+    // chunks missing around Focus and uploads the finished ones.
+    void Update(IDeviceContext *pCtx, const float2 &Focus);
+
+    // The walls within the map rect changed, its chunks are generated again. The old data stays
+    // visible until the new data arrives.
+    void Invalidate(const float2 &Min, const float2 &Max);
+
+    [[nodiscard]] ITexture *GetAtlas() const { return m_pAtlas; }
+    [[nodiscard]] ITexture *GetCoarse() const { return m_pCoarse; }
+    [[nodiscard]] ITexture *GetIndirection() const { return m_pIndirection; }
+    // SDFWorldConstants of Structures.fxh
+    [[nodiscard]] IBuffer *GetConstants() const { return m_pConstants; }
+    // Changes whenever Update() uploads anything, so what was drawn from the SDF may have changed
+    [[nodiscard]] Uint64 GetVersion() const { return mVersion; }
+
+    [[nodiscard]] const SDFWorldDesc &GetDesc() const { return mDesc; }
+    [[nodiscard]] Uint32 GetNumFineChunks() const;
+    [[nodiscard]] Uint32 GetNumPendingChunks() const { return mNumPending; }
+    // Bytes of all the GPU resources, fixed at creation
+    [[nodiscard]] Uint64 GetMemoryUsage() const;
+
+  private:
+    struct ChunkResult;
+    struct SharedState;
+
+    // Indirection value of a cell without a fine chunk, NoChunkSlot in DrawMap.hlsl
+    static constexpr Uint32 NoSlot = 0x7FFF;
+
+    // What a window cell holds, cells are indexed by chunk coordinates modulo WindowChunks
+    struct Cell {
+        Int32 X = 0;
+        Int32 Y = 0;
+        bool Assigned = false;
+        // Bumped when the cell changes chunks and by Invalidate(), so results of older jobs are dropped
+        Uint32 Generation = 0;
+        Uint32 FineSlot = NoSlot;
+        bool CoarseValid = false;
+        bool FinePending = false;
+        bool CoarsePending = false;
+        // The data is older than the last Invalidate() and is being replaced
+        bool FineStale = false;
+        bool CoarseStale = false;
+    };
+
+    Cell &GetCell(Int32 X, Int32 Y);
+
+    // Points the cell at chunk (X, Y) and drops what it held for another chunk
+    Cell &AssignCell(Int32 X, Int32 Y);
+
+    void QueueJob(Cell &C, bool Fine);
+
+    void UploadResult(IDeviceContext *pCtx, const ChunkResult &Result);
+
+    // Chebyshev distance in chunks within which chunks are fine
+    [[nodiscard]] Int32 GetFineRadius() const;
+
+    // Frees the slot of the fine chunk farthest from the focus outside the fine area
+    bool EvictFineChunk();
+
+    void WriteIndirection(const Cell &C);
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<ITexture> m_pAtlas;
+    RefCntAutoPtr<ITexture> m_pCoarse;
+    RefCntAutoPtr<ITexture> m_pIndirection;
+    RefCntAutoPtr<IBuffer> m_pConstants;
+
+    ThreadPool &mWorkers;
+    SDFWorldDesc mDesc;
+    // Lives on in jobs still running after the world is destroyed
+    std::shared_ptr<SharedState> mShared;
+
+    std::vector<Cell> mCells;
+    std::vector<Uint32> mFreeSlots;
+    // Indirection table as uploaded, see WriteIndirection()
+    std::vector<Uint16> mIndirection;
+    bool mIndirectionDirty = true;
+    bool mConstantsDirty = true;
+    // Chunk the focus was in at the last Update()
+    Int32 mFocusX = 0;
+    Int32 mFocusY = 0;
+
+    // First chunk of the window
+    Int32 mWindowX = 0;
+    Int32 mWindowY = 0;
+    bool mHasWindow = false;
+    Uint32 mNumPending = 0;
+    Uint64 mVersion = 0;
+};
+
+}
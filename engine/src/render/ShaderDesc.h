@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Shader.h"
+#include "core/Hash.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// HLSL shader as the cache sees it. Either FilePath (relative to the assets directory)
+// or inline Source must be set.
+struct ShaderDesc {
+    SHADER_TYPE Type = SHADER_TYPE_UNKNOWN;
+    std::string Name;
+    std::string FilePath;
+    std::string Source;
+    std::string EntryPoint = "main";
+    std::vector<std::pair<std::string, std::string>> Macros;
+};
+
+// Identifies a permutation of a file shader. Unlike the runtime cache key it does not cover the
+// source text: the offline pack is rebuilt whenever a source changes, and release builds may ship without sources.
+inline Uint64 GetShaderPermutationHash(const ShaderDesc &Desc) {
+    uint64_t Hash = HashSeed;
+    HashValue(Hash, Desc.Type);
+    HashString(Hash, Desc.FilePath);
+    HashString(Hash, Desc.EntryPoint);
+    for (const auto &Macro: Desc.Macros) {
+        HashString(Hash, Macro.first);
+        HashString(Hash, Macro.second);
+    }
+    return Hash;
+}
+
+// Name the permutation is stored under in the shader pack
+inline std::string GetShaderPackName(const ShaderDesc &Desc) {
+    char Name[17];
+    std::snprintf(Name, sizeof(Name), "%016llx", static_cast<unsigned long long>(GetShaderPermutationHash(Desc)));
+    return Name;
+}
+
+}
@@ -0,0 +1,78 @@
+#include "TextureReadback.h"
+
+#include <cstring>
+
+#include "GraphicsAccessories.hpp"
+#include "core/Logging.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+TextureReadback::TextureReadback(IRenderDevice *Device) {
+    m_pDevice = Device;
+}
+
+void TextureReadback::Copy(IDeviceContext *pCtx, ITexture *pSrc, Uint32 Width, Uint32 Height) {
+    const auto &SrcDesc = pSrc->GetDesc();
+    if (!m_pStaging || mWidth != Width || mHeight != Height || mFormat != SrcDesc.Format) {
+        TextureDesc Desc;
+        Desc.Name = "Readback staging texture";
+        Desc.Type = RESOURCE_DIM_TEX_2D;
+        Desc.Width = Width;
+        Desc.Height = Height;
+        Desc.MipLevels = 1;
+        Desc.Format = SrcDesc.Format;
+        Desc.Usage = USAGE_STAGING;
+        Desc.CPUAccessFlags = CPU_ACCESS_READ;
+        m_pStaging.Release();
+        m_pDevice->CreateTexture(Desc, nullptr, &m_pStaging);
+        if (!m_pStaging) {
+            log::Error("Failed to create the readback staging texture");
+            return;
+        }
+        mWidth = Width;
+        mHeight = Height;
+        mFormat = SrcDesc.Format;
+    }
+
+    Box SrcBox;
+    SrcBox.MaxX = Width;
+    SrcBox.MaxY = Height;
+
+    CopyTextureAttribs CopyAttribs;
+    CopyAttribs.pSrcTexture = pSrc;
+    CopyAttribs.pSrcBox = &SrcBox;
+    CopyAttribs.SrcTextureTransitionMode = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+    CopyAttribs.pDstTexture = m_pStaging;
+    CopyAttribs.DstTextureTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    pCtx->CopyTexture(CopyAttribs);
+    mHasData = true;
+}
+
+bool TextureReadback::Read(IDeviceContext *pCtx, std::vector<Uint8> &OutData) {
+    if (!mHasData) {
+        return false;
+    }
+
+    pCtx->WaitForIdle();
+
+    MappedTextureSubresource Mapped;
+    pCtx->MapTextureSubresource(m_pStaging, 0, 0, MAP_READ, MAP_FLAG_NONE, nullptr, Mapped);
+    if (Mapped.pData == nullptr) {
+        log::Error("Failed to map the readback staging texture");
+        return false;
+    }
+
+    const auto &FmtAttribs = GetTextureFormatAttribs(mFormat);
+    const size_t RowSize = static_cast<size_t>(mWidth) * FmtAttribs.ComponentSize * FmtAttribs.NumComponents;
+    OutData.resize(RowSize * mHeight);
+    for (Uint32 y = 0; y < mHeight; ++y) {
+        std::memcpy(&OutData[y * RowSize], static_cast<const Uint8 *>(Mapped.pData) + y * Mapped.Stride, RowSize);
+    }
+
+    pCtx->UnmapTextureSubresource(m_pStaging, 0, 0);
+    mHasData = false;
+    return true;
+}
+
+}
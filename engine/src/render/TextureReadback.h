@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Texture.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Copies a region of a texture into a CPU-readable staging texture. Read() waits for the GPU,
+// so this is meant for captures and image tests, not for per-frame use.
+class TextureReadback {
+  public:
+    explicit TextureReadback(IRenderDevice *Device);
+
+    // Copies the top left Width x Height texels of mip 0. The source must already be in
+    // RESOURCE_STATE_COPY_SOURCE.
+    void Copy(IDeviceContext *pCtx, ITexture *pSrc, Uint32 Width, Uint32 Height);
+
+    [[nodiscard]] bool HasData() const { return mHasData; }
+
+    // Waits for the copy and returns tightly packed texels in the source format
+    bool Read(IDeviceContext *pCtx, std::vector<Uint8> &OutData);
+
+    [[nodiscard]] Uint32 GetWidth() const { return mWidth; }
+    [[nodiscard]] Uint32 GetHeight() const { return mHeight; }
+    [[nodiscard]] TEXTURE_FORMAT GetFormat() const { return mFormat; }
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<ITexture> m_pStaging;
+
+    Uint32 mWidth = 0;
+    Uint32 mHeight = 0;
+    TEXTURE_FORMAT mFormat = TEX_FORMAT_UNKNOWN;
+    bool mHasData = false;
+};
+
+}
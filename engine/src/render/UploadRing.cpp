@@ -0,0 +1,122 @@
+#include "UploadRing.h"
+
+#include <algorithm>
+
+#include "core/Logging.h"
+#include "fmt/core.h"
+
+namespace bt {
+
+UploadRing::UploadRing(IRenderDevice *Device, IDeviceContext *Context, FrameSync &Sync, const char *Name,
+                       BIND_FLAGS BindFlags, Uint64 FrameSize)
+    : mSync(Sync), mName(Name), mBindFlags(BindFlags), mFrameSize(FrameSize),
+      mNumSlices(Sync.GetNumFramesInFlight()) {
+    m_pDevice = Device;
+    m_pContext = Context;
+
+    const auto DeviceType = m_pDevice->GetDeviceInfo().Type;
+    const auto &Memory = m_pDevice->GetAdapterInfo().Memory;
+    mPersistent = (DeviceType == RENDER_DEVICE_TYPE_D3D12 || DeviceType == RENDER_DEVICE_TYPE_VULKAN) &&
+                  (Memory.UnifiedMemoryCPUAccess & CPU_ACCESS_WRITE) != 0;
+
+    CreateBuffer();
+}
+
+UploadRing::~UploadRing() {
+    ReleaseBuffer();
+}
+
+void UploadRing::CreateBuffer() {
+    BufferDesc Desc;
+    Desc.Name = mName;
+    Desc.BindFlags = mBindFlags;
+    Desc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    if (mPersistent) {
+        Desc.Usage = USAGE_UNIFIED;
+        Desc.Size = mFrameSize * mNumSlices;
+    } else {
+        Desc.Usage = USAGE_DYNAMIC;
+        Desc.Size = mFrameSize;
+    }
+    m_pDevice->CreateBuffer(Desc, nullptr, &m_pBuffer);
+
+    if (mPersistent) {
+        PVoid pData = nullptr;
+        m_pContext->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_NONE, pData);
+        mMappedData = static_cast<Uint8 *>(pData);
+    }
+}
+
+void UploadRing::ReleaseBuffer() {
+    if (mMappedData != nullptr) {
+        m_pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+        mMappedData = nullptr;
+    }
+    m_pBuffer.Release();
+}
+
+Uint64 UploadRing::GrowFrameSize(Uint64 MinSize) const {
+    // Slices start at multiples of the frame size, keep them aligned for any binding
+    constexpr Uint64 SliceAlignment = 256;
+    const auto Size = std::max(mFrameSize * 2, MinSize);
+    return (Size + SliceAlignment - 1) / SliceAlignment * SliceAlignment;
+}
+
+void UploadRing::BeginFrame() {
+    mOffset = 0;
+    Unmap();
+}
+
+void UploadRing::EndFrame() {
+    Unmap();
+}
+
+void *UploadRing::Allocate(Uint64 Size, Uint32 Alignment, Uint64 &OutOffset) {
+    Uint64 Start = (mOffset + Alignment - 1) / Alignment * Alignment;
+
+    if (Start + Size > mFrameSize) {
+        if (mPersistent) {
+            // Frames in flight, this one included, may still read the old buffer
+            log::Warning(fmt::format("{} exhausted ({} bytes per frame), growing", mName, mFrameSize));
+            mSync.DeferRelease(m_pBuffer);
+            ReleaseBuffer();
+            mFrameSize = GrowFrameSize(Size);
+            CreateBuffer();
+        } else {
+            // Discarding gives fresh memory while draws issued earlier keep the old contents
+            Unmap();
+            if (Size > mFrameSize) {
+                ReleaseBuffer();
+                mFrameSize = GrowFrameSize(Size);
+                CreateBuffer();
+            }
+            mOffset = 0;
+        }
+        Start = 0;
+    }
+
+    if (mPersistent) {
+        OutOffset = mSync.GetFrameSlot() * mFrameSize + Start;
+    } else {
+        if (mMappedData == nullptr) {
+            // First mapping of the frame discards, the rest append
+            const auto Flags = mOffset == 0 ? MAP_FLAG_DISCARD : MAP_FLAG_NO_OVERWRITE;
+            PVoid pData = nullptr;
+            m_pContext->MapBuffer(m_pBuffer, MAP_WRITE, Flags, pData);
+            mMappedData = static_cast<Uint8 *>(pData);
+        }
+        OutOffset = Start;
+    }
+
+    mOffset = Start + Size;
+    return mMappedData + OutOffset;
+}
+
+void UploadRing::Unmap() {
+    if (!mPersistent && mMappedData != nullptr) {
+        m_pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+        mMappedData = nullptr;
+    }
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "render/FrameSync.h"
+
+namespace bt {
+
+using namespace Diligent;
+
+// Linear allocator for per-frame vertex, index and instance data. Users bump-allocate
+// aligned ranges and bind the ring buffer at the returned offsets.
+//
+// Where the adapter exposes CPU-writable unified memory (D3D12, Vulkan) the ring is one buffer
+// with a slice per frame in flight, mapped once for its whole lifetime; FrameSync keeps the CPU
+// from overwriting a slice the GPU still reads. Elsewhere the ring is a dynamic buffer that is
+// discarded on the first allocation of a frame and mapped with NO_OVERWRITE after that.
+class UploadRing {
+  public:
+    UploadRing(IRenderDevice *Device, IDeviceContext *Context, FrameSync &Sync, const char *Name,
+               BIND_FLAGS BindFlags, Uint64 FrameSize);
+
+    ~UploadRing();
+
+    // Called after FrameSync::BeginFrame(), which guarantees the GPU is done with this frame's slice
+    void BeginFrame();
+
+    void EndFrame();
+
+    // Returns a CPU pointer for Size bytes; OutOffset is where they start in GetBuffer().
+    // Allocations made between two Unmap() calls share one mapping.
+    void *Allocate(Uint64 Size, Uint32 Alignment, Uint64 &OutOffset);
+
+    // Must be called before draws read the allocated data
+    void Unmap();
+
+    [[nodiscard]] IBuffer *GetBuffer() { return m_pBuffer; }
+
+    [[nodiscard]] bool IsPersistent() const { return mPersistent; }
+
+    // Bytes allocated in the current frame
+    [[nodiscard]] Uint64 GetUsedSize() const { return mOffset; }
+
+    [[nodiscard]] Uint64 GetFrameSize() const { return mFrameSize; }
+
+  private:
+    void CreateBuffer();
+
+    void ReleaseBuffer();
+
+    [[nodiscard]] Uint64 GrowFrameSize(Uint64 MinSize) const;
+
+  private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<IDeviceContext> m_pContext;
+    RefCntAutoPtr<IBuffer> m_pBuffer;
+    FrameSync &mSync;
+
+    const char *mName;
+    BIND_FLAGS mBindFlags;
+    Uint64 mFrameSize;
+    Uint32 mNumSlices;
+    bool mPersistent = false;
+
+    Uint8 *mMappedData = nullptr;
+    Uint64 mOffset = 0;
+};
+
+}
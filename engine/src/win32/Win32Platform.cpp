@@ -0,0 +1,125 @@
+#include <Windows.h>
+#include <memory>
+#include <string>
+
+#include "Application.h"
+#include "ImGuiImplWin32.hpp"
+#include "platform/Platform.h"
+
+namespace bt {
+
+namespace {
+
+LRESULT CALLBACK MessageProc(HWND wnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+class Win32Platform final : public Platform {
+  public:
+    [[nodiscard]] PlatformType GetType() const override { return PlatformType::Win32; }
+
+    bool CreateMainWindow(const WindowDesc &Desc) override {
+        const std::wstring WindowClass(L"BorschWindow");
+        const std::wstring WindowTitle(Desc.Title.begin(), Desc.Title.end());
+
+        // Register our window class
+        WNDCLASSEX wcex = {
+                sizeof(WNDCLASSEX), CS_CLASSDC, MessageProc,
+                0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, WindowClass.c_str(), nullptr
+        };
+        RegisterClassEx(&wcex);
+
+        // Create a window
+        RECT Rc = {0, 0, static_cast<LONG>(Desc.Width), static_cast<LONG>(Desc.Height)};
+        AdjustWindowRect(&Rc, WS_OVERLAPPEDWINDOW, FALSE);
+        mWnd = CreateWindow(WindowClass.c_str(), WindowTitle.c_str(),
+                            WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
+                            Rc.right - Rc.left, Rc.bottom - Rc.top, nullptr, nullptr, wcex.hInstance, nullptr);
+        if (!mWnd) {
+            MessageBox(nullptr, L"Cannot create window", L"Error", MB_OK | MB_ICONERROR);
+            return false;
+        }
+        // MessageProc finds the platform through the window
+        SetWindowLongPtr(mWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+        ShowWindow(mWnd, SW_SHOWDEFAULT);
+        UpdateWindow(mWnd);
+        return true;
+    }
+
+    bool PumpEvents() override {
+        MSG msg = {0};
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                return false;
+            }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        return true;
+    }
+
+    bool GetNativeWindow(NativeWindow &OutWindow) const override {
+        OutWindow = Win32NativeWindow{mWnd};
+        return mWnd != nullptr;
+    }
+
+    std::unique_ptr<ImGuiImpl> CreateImGui(IRenderDevice *pDevice, TEXTURE_FORMAT BackBufferFmt,
+                                           TEXTURE_FORMAT DepthBufferFmt) override {
+        return std::make_unique<ImGuiImplWin32>(mWnd, pDevice, BackBufferFmt, DepthBufferFmt);
+    }
+
+    void OnResize(Uint32 Width, Uint32 Height) { NotifyResize(Width, Height); }
+
+  private:
+    HWND mWnd = nullptr;
+};
+
+// Called every time the window receives a message
+LRESULT CALLBACK MessageProc(HWND wnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    if (bt::gTheApp) {
+        auto res = bt::gTheApp->HandleWin32Message(wnd, message, wParam, lParam);
+        if (res != 0)
+            return res;
+    }
+
+    switch (message) {
+        case WM_PAINT: {
+            PAINTSTRUCT ps;
+            BeginPaint(wnd, &ps);
+            EndPaint(wnd, &ps);
+            return 0;
+        }
+        case WM_SIZE: // Window size has been changed
+            if (auto *pPlatform = reinterpret_cast<Win32Platform *>(GetWindowLongPtr(wnd, GWLP_USERDATA))) {
+                pPlatform->OnResize(LOWORD(lParam), HIWORD(lParam));
+            }
+            return 0;
+
+        case WM_CHAR:
+            if (wParam == VK_ESCAPE)
+                PostQuitMessage(0);
+            return 0;
+
+        case WM_DESTROY:
+            PostQuitMessage(0);
+            return 0;
+
+        case WM_GETMINMAXINFO: {
+            LPMINMAXINFO lpMMI = (LPMINMAXINFO) lParam;
+
+            lpMMI->ptMinTrackSize.x = 320;
+            lpMMI->ptMinTrackSize.y = 240;
+            return 0;
+        }
+
+        default:
+            return DefWindowProc(wnd, message, wParam, lParam);
+    }
+}
+
+}
+
+std::unique_ptr<Platform> CreateWin32Platform() {
+    return std::make_unique<Win32Platform>();
+}
+
+}
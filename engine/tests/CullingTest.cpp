@@ -0,0 +1,107 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "render/FrustumCulling.h"
+
+using namespace bt;
+
+namespace {
+
+// Kernels sum the plane terms in different orders (and AVX2 uses FMA), so a volume that
+// touches a plane within rounding error may legitimately land on either side. Such volumes
+// are left out, everything else must produce the same visible list in every kernel.
+constexpr double PlaneMargin = 1.0e-3;
+
+bool IsNearPlane(const Frustum &ViewFrustum, const Vector &Center, const Vector &Extent, double Radius) {
+    for (const auto &P: ViewFrustum.Planes) {
+        const double Dist = P.Nx * Center.x + P.Ny * Center.y + P.Nz * Center.z + P.D;
+        const double R = std::fabs(P.Nx) * Extent.x + std::fabs(P.Ny) * Extent.y + std::fabs(P.Nz) * Extent.z + Radius;
+        if (std::fabs(Dist + R) < PlaneMargin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int NumFailures = 0;
+
+void Expect(bool Condition, const char *What, const char *KernelName) {
+    if (!Condition) {
+        std::printf("FAILED: %s (%s kernel)\n", What, KernelName);
+        ++NumFailures;
+    }
+}
+
+void TestFrustum(const Frustum &ViewFrustum, Uint32 Seed) {
+    // Odd count so the scalar tail after the last full register is exercised as well
+    constexpr Uint32 NumVolumes = 100003;
+
+    std::mt19937 Rng(Seed);
+    std::uniform_real_distribution<double> Pos(-200.0, 200.0);
+    std::uniform_real_distribution<double> Size(0.1, 8.0);
+
+    BoundingBoxesSoA Boxes;
+    BoundingSpheresSoA Spheres;
+    while (Boxes.Size() < NumVolumes) {
+        const Vector Center(static_cast<float>(Pos(Rng)), static_cast<float>(Pos(Rng)), static_cast<float>(Pos(Rng)));
+        const Vector Extent(static_cast<float>(Size(Rng)), static_cast<float>(Size(Rng)),
+                            static_cast<float>(Size(Rng)));
+        const float Radius = static_cast<float>(glm::length(Extent));
+        if (IsNearPlane(ViewFrustum, Center, Extent, 0.0) || IsNearPlane(ViewFrustum, Center, Vector(0.0), Radius)) {
+            continue;
+        }
+        Boxes.Add(Center, Extent);
+        Spheres.Add(Center, Radius);
+    }
+
+    std::vector<Uint32> ScalarBoxes, ScalarSpheres;
+    CullBoxes(CullingKernel::Scalar, ViewFrustum, Boxes, ScalarBoxes);
+    CullSpheres(CullingKernel::Scalar, ViewFrustum, Spheres, ScalarSpheres);
+    Expect(!ScalarBoxes.empty() && ScalarBoxes.size() < NumVolumes, "boxes are partially visible", "scalar");
+
+    for (auto Kernel: {CullingKernel::SSE, CullingKernel::AVX2}) {
+        if (static_cast<Uint8>(Kernel) > static_cast<Uint8>(GetCullingKernel()))
+            continue;
+        const char *Name = GetCullingKernelName(Kernel);
+
+        std::vector<Uint32> Visible;
+        CullBoxes(Kernel, ViewFrustum, Boxes, Visible);
+        Expect(Visible == ScalarBoxes, "boxes match the scalar kernel", Name);
+        CullSpheres(Kernel, ViewFrustum, Spheres, Visible);
+        Expect(Visible == ScalarSpheres, "spheres match the scalar kernel", Name);
+
+        // A slice that starts off the register width must return the matching part of the full list
+        constexpr Uint32 First = 13;
+        constexpr Uint32 Count = 50021;
+        std::vector<Uint32> Slice(Count);
+        Slice.resize(CullBoxes(Kernel, ViewFrustum, Boxes, First, Count, Slice.data()));
+        std::vector<Uint32> Expected;
+        for (Uint32 Idx: ScalarBoxes) {
+            if (Idx >= First && Idx < First + Count) {
+                Expected.push_back(Idx);
+            }
+        }
+        Expect(Slice == Expected, "box slice matches the scalar kernel", Name);
+    }
+}
+
+}
+
+// Checks that every compiled SIMD culling kernel produces exactly the scalar visible lists.
+// Returns 0 when they all match.
+int main() {
+    std::printf("best kernel: %s\n", GetCullingKernelName(GetCullingKernel()));
+
+    const Matrix Proj = glm::perspective(glm::radians(70.0), 16.0 / 9.0, 0.1, 150.0);
+    TestFrustum(ExtractFrustum(Proj * glm::lookAt(Vector(0.0), Vector(0.0, 0.0, 1.0), Vector(0.0, 1.0, 0.0))), 723);
+    TestFrustum(ExtractFrustum(Proj * glm::lookAt(Vector(10.0, 20.0, -30.0), Vector(-40.0, 0.0, 25.0),
+                                                  Vector(0.0, 1.0, 0.0))),
+                1337);
+
+    if (NumFailures == 0) {
+        std::printf("all kernels match the scalar kernel\n");
+    }
+    return NumFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ArchiverFactory.h"
+#include "ArchiverFactoryLoader.h"
+#include "DataBlob.h"
+#include "RefCntAutoPtr.hpp"
+#include "ShaderMacroHelper.hpp"
+
+#include "render/ShaderDesc.h"
+
+using namespace Diligent;
+using namespace bt;
+
+static bool ParseStage(const std::string &Stage, SHADER_TYPE &OutType) {
+    static const std::pair<const char *, SHADER_TYPE> Stages[] = {
+        {"vertex", SHADER_TYPE_VERTEX},
+        {"pixel", SHADER_TYPE_PIXEL},
+        {"geometry", SHADER_TYPE_GEOMETRY},
+        {"hull", SHADER_TYPE_HULL},
+        {"domain", SHADER_TYPE_DOMAIN},
+        {"compute", SHADER_TYPE_COMPUTE},
+    };
+    for (const auto &Entry: Stages) {
+        if (Stage == Entry.first) {
+            OutType = Entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Manifest lines: <stage> <file> <entry point> [MACRO=VALUE ...], '#' starts a comment
+static bool ReadManifest(const char *Path, std::vector<ShaderDesc> &OutShaders) {
+    std::ifstream File(Path);
+    if (!File) {
+        std::fprintf(stderr, "Can not open manifest %s\n", Path);
+        return false;
+    }
+
+    std::string Line;
+    for (Uint32 LineNo = 1; std::getline(File, Line); ++LineNo) {
+        Line = Line.substr(0, Line.find('#'));
+        std::istringstream Tokens(Line);
+
+        std::string Stage;
+        if (!(Tokens >> Stage)) {
+            continue;
+        }
+
+        ShaderDesc Desc;
+        if (!ParseStage(Stage, Desc.Type) || !(Tokens >> Desc.FilePath >> Desc.EntryPoint)) {
+            std::fprintf(stderr, "%s(%u): expected <stage> <file> <entry point>\n", Path, LineNo);
+            return false;
+        }
+
+        std::string Macro;
+        while (Tokens >> Macro) {
+            const auto Eq = Macro.find('=');
+            if (Eq == std::string::npos) {
+                Desc.Macros.emplace_back(Macro, "1");
+            } else {
+                Desc.Macros.emplace_back(Macro.substr(0, Eq), Macro.substr(Eq + 1));
+            }
+        }
+
+        Desc.Name = Desc.FilePath + ":" + Desc.EntryPoint;
+        OutShaders.push_back(std::move(Desc));
+    }
+    return true;
+}
+
+// Compiles every permutation listed in the manifest to SPIR-V and GLSL (plus DXBC/DXIL on Windows)
+// and writes them into one Diligent archive. Each shader is stored under GetShaderPackName(), which
+// is what PipelineCache looks up at runtime.
+// Usage: shader_packer <assets dir> <manifest> <output pack>
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::fprintf(stderr, "Usage: shader_packer <assets dir> <manifest> <output pack>\n");
+        return 1;
+    }
+
+    std::vector<ShaderDesc> Shaders;
+    if (!ReadManifest(argv[2], Shaders)) {
+        return 1;
+    }
+
+    auto *pArchiverFactory = LoadAndGetArchiverFactory();
+    if (pArchiverFactory == nullptr) {
+        std::fprintf(stderr, "Failed to load the archiver\n");
+        return 1;
+    }
+
+    SerializationDeviceCreateInfo DeviceCI;
+    RefCntAutoPtr<ISerializationDevice> pDevice;
+    pArchiverFactory->CreateSerializationDevice(DeviceCI, &pDevice);
+
+    RefCntAutoPtr<IArchiver> pArchiver;
+    pArchiverFactory->CreateArchiver(pDevice, &pArchiver);
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pSourceFactory;
+    pArchiverFactory->CreateDefaultShaderSourceStreamFactory(argv[1], &pSourceFactory);
+    if (!pDevice || !pArchiver || !pSourceFactory) {
+        std::fprintf(stderr, "Failed to initialize the archiver\n");
+        return 1;
+    }
+
+    ShaderArchiveInfo ArchiveInfo;
+    ArchiveInfo.DeviceFlags = ARCHIVE_DEVICE_DATA_FLAG_VULKAN | ARCHIVE_DEVICE_DATA_FLAG_GL;
+#if PLATFORM_WIN32
+    ArchiveInfo.DeviceFlags |= ARCHIVE_DEVICE_DATA_FLAG_D3D11 | ARCHIVE_DEVICE_DATA_FLAG_D3D12;
+#endif
+
+    for (const auto &Desc: Shaders) {
+        const auto PackName = GetShaderPackName(Desc);
+
+        // Must match the runtime compilation settings in PipelineCache::GetShader()
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.UseCombinedTextureSamplers = true;
+        ShaderCI.pShaderSourceStreamFactory = pSourceFactory;
+        ShaderCI.Desc.ShaderType = Desc.Type;
+        ShaderCI.Desc.Name = PackName.c_str();
+        ShaderCI.FilePath = Desc.FilePath.c_str();
+        ShaderCI.EntryPoint = Desc.EntryPoint.c_str();
+
+        ShaderMacroHelper Macros;
+        for (const auto &Macro: Desc.Macros) {
+            Macros.AddShaderMacro(Macro.first.c_str(), Macro.second.c_str());
+        }
+        if (!Desc.Macros.empty()) {
+            ShaderCI.Macros = Macros;
+        }
+
+        RefCntAutoPtr<IShader> pShader;
+        pDevice->CreateShader(ShaderCI, ArchiveInfo, &pShader);
+        if (!pShader || !pArchiver->AddShader(pShader)) {
+            std::fprintf(stderr, "Failed to compile %s\n", Desc.Name.c_str());
+            return 1;
+        }
+        std::printf("%s -> %s\n", Desc.Name.c_str(), PackName.c_str());
+    }
+
+    RefCntAutoPtr<IDataBlob> pPack;
+    pArchiver->SerializeToBlob(&pPack);
+    if (!pPack) {
+        std::fprintf(stderr, "Failed to serialize the shader pack\n");
+        return 1;
+    }
+
+    std::ofstream Output(argv[3], std::ios::binary | std::ios::trunc);
+    Output.write(static_cast<const char *>(pPack->GetConstDataPtr()), static_cast<std::streamsize>(pPack->GetSize()));
+    if (!Output) {
+        std::fprintf(stderr, "Failed to write %s\n", argv[3]);
+        return 1;
+    }
+
+    std::printf("Packed %zu shaders into %s\n", Shaders.size(), argv[3]);
+    return 0;
+}